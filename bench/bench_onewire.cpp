@@ -0,0 +1,181 @@
+// =============================================================================
+// bench_onewire.cpp - 1-Wire standard vs overdrive timing for LED Cube Hub
+// =============================================================================
+// Times the cube bus operations at standard speed and at overdrive with up to
+// MAX_CUBES DS2431 cubes: a full enumeration (search only, cubes already
+// known), reading all 128 bytes of every cube, one verify poll, and
+// programming page 0 with one changed byte (the writer rewrites that row and
+// the CRC row, each with a 15 ms tPROG wait) or with unchanged contents.
+//
+// Builds in place of main.cpp:
+//   pio run -e bench_onewire -t upload -t monitor     (on device, cubes attached)
+//   pio run -e bench_onewire_native && .pio/build/bench_onewire_native/program
+// The host run attaches MAX_CUBES simulated cubes and reports modeled bus time.
+// =============================================================================
+
+#include "hardware.h"
+
+#ifdef HOST_SIM
+#include "sim.h"
+#endif
+
+// =============================================================================
+// Benchmark Configuration
+// =============================================================================
+#define BENCH_RUNS  10
+
+enum BenchOp {
+    OP_ENUMERATE,
+    OP_READ_ALL,
+    OP_VERIFY,
+    OP_PROGRAM,
+    OP_PROGRAM_SAME
+};
+
+static const char* const benchOpNames[] = { "enumerate", "read all", "verify", "program", "prog same" };
+
+#define BENCH_OP_COUNT (sizeof(benchOpNames) / sizeof(benchOpNames[0]))
+
+// =============================================================================
+// Operations
+// =============================================================================
+static uint8_t benchToggle = 0;
+
+static void benchRun(BenchOp op) {
+    uint8_t addr[8];
+    CubeMemory mem;
+    CubeConfig config;
+
+    switch (op) {
+        case OP_ENUMERATE:
+            scanOneWireBus();
+            break;
+
+        case OP_READ_ALL:
+            for (int i = 0; i < cubeCount; i++) {
+                idToAddress(cubes[i].romId, addr);
+                readCubeMemory(addr, &mem);
+            }
+            break;
+
+        case OP_VERIFY:
+            // Within ONEWIRE_FULL_SCAN_MS of the last enumeration this is a verify pass
+            oneWireHotPlug = false;
+            beginOneWirePoll();
+            while (oneWireScanBusy()) stepOneWireScan(UINT32_MAX);
+            break;
+
+        case OP_PROGRAM:
+            // Toggle cube 0's brightness between two values
+            idToAddress(cubes[0].romId, addr);
+            mem.config = cubes[0].config;
+            mem.config.brightness = ++benchToggle & 1 ? 129 : 128;
+            cubeMemorySeal(&mem);
+            ds2431WritePage(addr, 0, (uint8_t*)&mem.config);
+            break;
+
+        case OP_PROGRAM_SAME:
+            idToAddress(cubes[0].romId, addr);
+            config = cubes[0].config;
+            ds2431WritePage(addr, 0, (uint8_t*)&config);
+            break;
+    }
+}
+
+// Average microseconds per run; the enumeration is repeated first so every
+// run below is a search at the selected speed.
+static double benchTime(BenchOp op, bool overdrive) {
+    oneWireOverdrive = overdrive;
+    scanOneWireBus();
+
+    uint32_t total = 0;
+    for (int i = 0; i < BENCH_RUNS; i++) {
+        uint32_t start = micros();
+        benchRun(op);
+        total += micros() - start;
+    }
+    return (double)total / BENCH_RUNS;
+}
+
+// =============================================================================
+// Report
+// =============================================================================
+static void printPadded(const char* s, int width) {
+    Serial.print(s);
+    for (int i = strlen(s); i < width; i++) Serial.print(' ');
+}
+
+static void printNumber(double v, int digits, int width) {
+    char buf[24];
+    snprintf(buf, sizeof(buf), "%*.*f", width, digits, v);
+    Serial.print(buf);
+}
+
+static void runBenchmarks() {
+    Serial.println(F("\n=== 1-Wire Benchmark ==="));
+
+    // First pass at standard speed picks up every cube (and adds them)
+    oneWireOverdrive = false;
+    scanOneWireBus();
+    Serial.print(F("Cubes: "));
+    Serial.print(cubeCount);
+    Serial.print(F(", "));
+    Serial.print(BENCH_RUNS);
+    Serial.println(F(" runs per case"));
+    if (cubeCount == 0) {
+        Serial.println(F("No cubes found"));
+        return;
+    }
+
+    Serial.println(F("operation  standard us  overdrive us  speedup"));
+    for (size_t op = 0; op < BENCH_OP_COUNT; op++) {
+        double standard = benchTime((BenchOp)op, false);
+        double overdrive = benchTime((BenchOp)op, true);
+        printPadded(benchOpNames[op], 10);
+        printNumber(standard, 0, 12);
+        printNumber(overdrive, 0, 14);
+        printNumber(standard / overdrive, 2, 8);
+        Serial.println(F("x"));
+    }
+
+    oneWireOverdrive = true;
+#ifndef HOST_SIM
+    Serial.println(F("\nSend any character to run again"));
+#endif
+}
+
+// =============================================================================
+// Entry Points
+// =============================================================================
+void setup() {
+    Serial.begin(115200);
+#ifndef HOST_SIM
+    delay(2000);
+    ledOutputBegin();
+    ledOutputClear();
+#endif
+    runBenchmarks();
+}
+
+void loop() {
+    if (Serial.available()) {
+        while (Serial.available()) Serial.read();
+        runBenchmarks();
+    }
+}
+
+#ifdef HOST_SIM
+int main() {
+    // MAX_CUBES programmed cubes of 25 LEDs each
+    for (int i = 0; i < MAX_CUBES; i++) {
+        uint8_t image[SIM_DS2431_MEM_SIZE];
+        memset(image, 0xFF, sizeof(image));
+        CubeMemory mem;
+        cubeMemoryDefaults(&mem, 1, 25);
+        memcpy(image, &mem, sizeof(mem));
+        simOneWireAttach(0x1000 + i, image);
+    }
+    setup();
+    return 0;
+}
+#endif
@@ -0,0 +1,411 @@
+// =============================================================================
+// bench_render.cpp - Per-effect render benchmark for LED Cube Hub
+// =============================================================================
+// Times every registered effect (and accelerometer mode) at 50, 150 and
+// MAX_TOTAL_LEDS LEDs and reports us/frame, cycles/LED and the headroom left
+// in the ANIMATION_MS frame budget.
+//
+// Builds in place of main.cpp:
+//   pio run -e bench -t upload -t monitor     (on device, CPU cycle counter)
+//   pio run -e bench_native && .pio/build/bench_native/program   (host)
+// On the device the LED output cost for each LED count is reported too: the
+// time ledOutputShow() holds the caller, and the time until the frame is out.
+// Then each pixel_ops kernel is checked byte for byte against the FastLED
+// code it replaces and both are timed at MAX_TOTAL_LEDS.
+// =============================================================================
+
+#include "hardware.h"
+
+#ifdef HOST_SIM
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#endif
+
+// =============================================================================
+// Benchmark Configuration
+// =============================================================================
+#define BENCH_WARMUP_FRAMES  20
+#define BENCH_FRAMES         200
+
+struct BenchEffect {
+    const char* name;
+    uint8_t animation;
+    bool accel;
+};
+
+// Every effect in the registry, then accelerometer mode
+static BenchEffect benchEffectAt(size_t index) {
+    if (index < effectCount()) return { effectAt(index)->name, (uint8_t)index, false };
+    return { "accel", 0, true };
+}
+
+static const int benchLedCounts[] = { 50, 150, MAX_TOTAL_LEDS };
+
+#define BENCH_EFFECT_COUNT ((size_t)effectCount() + 1)
+#define BENCH_SIZE_COUNT   (sizeof(benchLedCounts) / sizeof(benchLedCounts[0]))
+
+// =============================================================================
+// Clock Sources
+// =============================================================================
+// Device: CPU cycle counter, converted to ns at the core clock.
+// Host:   CLOCK_MONOTONIC for time, TSC for cycles where the CPU has one.
+
+struct BenchSample {
+    uint64_t ns;
+    uint64_t cycles;
+};
+
+static inline BenchSample benchNow() {
+    BenchSample s;
+#ifdef HOST_SIM
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    s.ns = (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#if defined(__x86_64__) || defined(__i386__)
+    s.cycles = __rdtsc();
+#else
+    s.cycles = 0;
+#endif
+#else
+    s.cycles = ESP.getCycleCount();
+    s.ns = s.cycles * 1000ULL / ESP.getCpuFreqMHz();
+#endif
+    return s;
+}
+
+// Elapsed between two samples; the device counter is 32-bit and wraps.
+static inline BenchSample benchElapsed(const BenchSample& a, const BenchSample& b) {
+    BenchSample d;
+#ifdef HOST_SIM
+    d.ns = b.ns - a.ns;
+    d.cycles = b.cycles - a.cycles;
+#else
+    d.cycles = (uint32_t)(b.cycles - a.cycles);
+    d.ns = d.cycles * 1000ULL / ESP.getCpuFreqMHz();
+#endif
+    return d;
+}
+
+// =============================================================================
+// Measurement
+// =============================================================================
+struct BenchResult {
+    double avgUs;
+    double maxUs;
+    double cyclesPerLed;
+};
+
+static void benchPrepare(const BenchEffect& effect, int ledCount) {
+    totalLeds = ledCount;
+    currentAnimation = effect.animation;
+    accelMode = effect.accel;
+    animationRunning = true;
+    ledsEnabled = true;
+    effectArena.active = EFFECT_NONE;     // Each case starts from a fresh effect state
+    accelR = 40;
+    accelG = 120;
+    accelB = 250;
+    fill_solid(leds, MAX_TOTAL_LEDS, CRGB::Black);
+}
+
+static BenchResult benchEffect(const BenchEffect& effect, int ledCount) {
+    benchPrepare(effect, ledCount);
+    for (int i = 0; i < BENCH_WARMUP_FRAMES; i++) runAnimation();
+
+    uint64_t totalNs = 0;
+    uint64_t maxNs = 0;
+    uint64_t totalCycles = 0;
+    for (int i = 0; i < BENCH_FRAMES; i++) {
+        BenchSample start = benchNow();
+        runAnimation();
+        BenchSample d = benchElapsed(start, benchNow());
+        totalNs += d.ns;
+        totalCycles += d.cycles;
+        if (d.ns > maxNs) maxNs = d.ns;
+    }
+
+    BenchResult r;
+    r.avgUs = totalNs / 1000.0 / BENCH_FRAMES;
+    r.maxUs = maxNs / 1000.0;
+    r.cyclesPerLed = (double)totalCycles / BENCH_FRAMES / ledCount;
+    return r;
+}
+
+#ifndef HOST_SIM
+// ledOutputShow() cost; 'wait' includes the transfer itself
+static BenchResult benchShow(int ledCount, bool wait) {
+    fill_solid(leds, ledCount, CRGB(8, 8, 8));
+
+    // Split evenly over the outputs, like cubes chained on each of them
+    RenderLayout layout = {};
+    layout.totalLeds = ledCount;
+    layout.segmentCount = LED_CHANNEL_COUNT;
+    for (int ch = 0; ch < LED_CHANNEL_COUNT; ch++) {
+        RenderSegment* seg = &layout.segments[ch];
+        seg->start = ledCount * ch / LED_CHANNEL_COUNT;
+        seg->count = ledCount * (ch + 1) / LED_CHANNEL_COUNT - seg->start;
+        seg->output = ch;
+    }
+
+    uint64_t totalNs = 0;
+    uint64_t maxNs = 0;
+    uint64_t totalCycles = 0;
+    const int frames = 50;
+    for (int i = 0; i < frames; i++) {
+        ledOutputWait();
+        BenchSample start = benchNow();
+        ledOutputShow(leds, &layout, LED_BRIGHTNESS, LED_ALL_SEGMENTS);
+        if (wait) ledOutputWait();
+        BenchSample d = benchElapsed(start, benchNow());
+        totalNs += d.ns;
+        totalCycles += d.cycles;
+        if (d.ns > maxNs) maxNs = d.ns;
+    }
+
+    BenchResult r;
+    r.avgUs = totalNs / 1000.0 / frames;
+    r.maxUs = maxNs / 1000.0;
+    r.cyclesPerLed = (double)totalCycles / frames / ledCount;
+    return r;
+}
+#endif
+
+// =============================================================================
+// Pixel Kernels
+// =============================================================================
+// Reference and kernel behind one signature: other is the blend target, and
+// other[0] the color for fill and add; arg is the scale, fade, blend amount
+// or start hue.
+
+typedef void (*KernelFn)(CRGB* px, const CRGB* other, int count, uint8_t arg);
+
+struct BenchKernel {
+    const char* name;
+    KernelFn reference;
+    KernelFn kernel;
+    uint8_t arg;            // For the timing runs
+};
+
+static void refFill(CRGB* px, const CRGB* other, int count, uint8_t arg) { fill_solid(px, count, other[0]); }
+static void swarFill(CRGB* px, const CRGB* other, int count, uint8_t arg) { pixelFill(px, count, other[0]); }
+static void refScale(CRGB* px, const CRGB* other, int count, uint8_t arg) { nscale8(px, count, arg); }
+static void swarScale(CRGB* px, const CRGB* other, int count, uint8_t arg) { pixelScale(px, count, arg); }
+static void refFade(CRGB* px, const CRGB* other, int count, uint8_t arg) { fadeToBlackBy(px, count, arg); }
+static void swarFade(CRGB* px, const CRGB* other, int count, uint8_t arg) { pixelFade(px, count, arg); }
+
+static void refAdd(CRGB* px, const CRGB* other, int count, uint8_t arg) {
+    for (int i = 0; i < count; i++) px[i] += other[0];
+}
+
+static void swarAdd(CRGB* px, const CRGB* other, int count, uint8_t arg) { pixelAdd(px, count, other[0]); }
+
+static void refLerp(CRGB* px, const CRGB* other, int count, uint8_t arg) {
+    for (int i = 0; i < count; i++) {
+        for (int c = 0; c < 3; c++) px[i].raw[c] = lerp8by8(px[i].raw[c], other[i].raw[c], arg);
+    }
+}
+
+static void swarLerp(CRGB* px, const CRGB* other, int count, uint8_t arg) { pixelLerp(px, other, count, arg); }
+
+// The rainbow effect's ramp
+static void refHue(CRGB* px, const CRGB* other, int count, uint8_t arg) {
+    for (int i = 0; i < count; i++) px[i] = CHSV((arg + i * 10) % 256, 255, 200);
+}
+
+static void swarHue(CRGB* px, const CRGB* other, int count, uint8_t arg) {
+    pixelFillHue(px, count, arg, 10, 255, 200);
+}
+
+static const BenchKernel benchKernels[] = {
+    { "fill",  refFill,  swarFill,  0   },
+    { "scale", refScale, swarScale, 200 },
+    { "fade",  refFade,  swarFade,  50  },
+    { "add",   refAdd,   swarAdd,   0   },
+    { "lerp",  refLerp,  swarLerp,  128 },
+    { "hue",   refHue,   swarHue,   0   },
+};
+
+#define BENCH_KERNEL_COUNT (sizeof(benchKernels) / sizeof(benchKernels[0]))
+
+// Room for a start offset of up to 3 pixels (every word alignment)
+alignas(4) static CRGB kernelRef[MAX_TOTAL_LEDS + 4];
+alignas(4) static CRGB kernelOut[MAX_TOTAL_LEDS + 4];
+alignas(4) static CRGB kernelOther[MAX_TOTAL_LEDS + 4];
+static uint32_t kernelSeed;
+
+static void kernelRandomFill(CRGB* px, int count) {
+    for (int i = 0; i < count; i++) {
+        for (int c = 0; c < 3; c++) {
+            kernelSeed = kernelSeed * 1664525 + 1013904223;
+            px[i].raw[c] = kernelSeed >> 24;
+        }
+    }
+}
+
+// Cases (argument x alignment x length) where any byte of the buffer differs,
+// including bytes outside the range that must not be touched
+static uint32_t checkKernel(const BenchKernel& k) {
+    static const uint8_t args[] = { 0, 1, 2, 64, 127, 128, 129, 200, 254, 255 };
+    uint32_t mismatches = 0;
+    kernelSeed = 1;
+    for (size_t a = 0; a < sizeof(args); a++) {
+        for (int offset = 0; offset < 4; offset++) {
+            for (int count = 0; count <= 40 + 1; count++) {
+                int n = (count > 40) ? MAX_TOTAL_LEDS : count;
+                int otherOffset = (offset + count) % 4;     // Equal and unequal alignment
+                kernelRandomFill(kernelRef, MAX_TOTAL_LEDS + 4);
+                kernelRandomFill(kernelOther, MAX_TOTAL_LEDS + 4);
+                memcpy(kernelOut, kernelRef, sizeof(kernelOut));
+                k.reference(&kernelRef[offset], &kernelOther[otherOffset], n, args[a]);
+                k.kernel(&kernelOut[offset], &kernelOther[otherOffset], n, args[a]);
+                if (memcmp(kernelRef, kernelOut, sizeof(kernelOut)) != 0) mismatches++;
+            }
+        }
+    }
+    return mismatches;
+}
+
+static BenchResult benchKernelFn(KernelFn fn, uint8_t arg) {
+    kernelSeed = 1;
+    kernelRandomFill(kernelOut, MAX_TOTAL_LEDS);
+    kernelRandomFill(kernelOther, MAX_TOTAL_LEDS);
+    for (int i = 0; i < BENCH_WARMUP_FRAMES; i++) fn(kernelOut, kernelOther, MAX_TOTAL_LEDS, arg);
+
+    uint64_t totalNs = 0;
+    uint64_t maxNs = 0;
+    uint64_t totalCycles = 0;
+    for (int i = 0; i < BENCH_FRAMES; i++) {
+        BenchSample start = benchNow();
+        fn(kernelOut, kernelOther, MAX_TOTAL_LEDS, arg);
+        BenchSample d = benchElapsed(start, benchNow());
+        totalNs += d.ns;
+        totalCycles += d.cycles;
+        if (d.ns > maxNs) maxNs = d.ns;
+    }
+
+    BenchResult r;
+    r.avgUs = totalNs / 1000.0 / BENCH_FRAMES;
+    r.maxUs = maxNs / 1000.0;
+    r.cyclesPerLed = (double)totalCycles / BENCH_FRAMES / MAX_TOTAL_LEDS;
+    return r;
+}
+
+// =============================================================================
+// Report
+// =============================================================================
+static void printPadded(const char* s, int width) {
+    Serial.print(s);
+    for (int i = strlen(s); i < width; i++) Serial.print(' ');
+}
+
+static void printNumber(double v, int digits, int width) {
+    char buf[24];
+    snprintf(buf, sizeof(buf), "%*.*f", width, digits, v);
+    Serial.print(buf);
+}
+
+static void printRow(const char* name, int ledCount, const BenchResult& r) {
+    const double budgetUs = ANIMATION_MS * 1000.0;
+    printPadded(name, 10);
+    printNumber(ledCount, 0, 5);
+    printNumber(r.avgUs, 2, 11);
+    printNumber(r.maxUs, 2, 11);
+    printNumber(r.cyclesPerLed, 1, 12);
+    printNumber((budgetUs - r.avgUs) * 100.0 / budgetUs, 2, 10);
+    Serial.println(F("%"));
+}
+
+static void runKernelBenchmarks() {
+    Serial.print(F("\n=== Pixel Kernels ("));
+    Serial.print(MAX_TOTAL_LEDS);
+    Serial.println(F(" LEDs) ==="));
+    Serial.println(F("kernel    check          ref us   swar us  ref c/LED swar c/LED  speedup"));
+    for (size_t i = 0; i < BENCH_KERNEL_COUNT; i++) {
+        const BenchKernel& k = benchKernels[i];
+        uint32_t mismatches = checkKernel(k);
+        BenchResult ref = benchKernelFn(k.reference, k.arg);
+        BenchResult swar = benchKernelFn(k.kernel, k.arg);
+        
+        printPadded(k.name, 10);
+        if (mismatches == 0) {
+            printPadded("exact", 10);
+        } else {
+            char buf[16];
+            snprintf(buf, sizeof(buf), "%lu BAD", (unsigned long)mismatches);
+            printPadded(buf, 10);
+        }
+        printNumber(ref.avgUs, 2, 11);
+        printNumber(swar.avgUs, 2, 10);
+        printNumber(ref.cyclesPerLed, 1, 11);
+        printNumber(swar.cyclesPerLed, 1, 11);
+        printNumber(swar.avgUs > 0 ? ref.avgUs / swar.avgUs : 0, 2, 8);
+        Serial.println(F("x"));
+    }
+}
+
+static void runBenchmarks() {
+    Serial.println(F("\n=== Render Benchmark ==="));
+#ifdef HOST_SIM
+    Serial.println(F("Target: host (CLOCK_MONOTONIC, TSC cycles)"));
+#else
+    Serial.print(F("Target: device @ "));
+    Serial.print(ESP.getCpuFreqMHz());
+    Serial.println(F(" MHz (CPU cycle counter)"));
+#endif
+    Serial.print(F("Budget: "));
+    Serial.print(ANIMATION_MS);
+    Serial.print(F(" ms/frame, "));
+    Serial.print(BENCH_FRAMES);
+    Serial.println(F(" frames per case"));
+    Serial.println(F("effect     leds   us/frame     max us  cycles/LED  headroom"));
+
+    for (size_t s = 0; s < BENCH_SIZE_COUNT; s++) {
+        for (size_t e = 0; e < BENCH_EFFECT_COUNT; e++) {
+            BenchEffect effect = benchEffectAt(e);
+            BenchResult r = benchEffect(effect, benchLedCounts[s]);
+            printRow(effect.name, benchLedCounts[s], r);
+        }
+#ifndef HOST_SIM
+        printRow("show", benchLedCounts[s], benchShow(benchLedCounts[s], false));
+        printRow("show+wait", benchLedCounts[s], benchShow(benchLedCounts[s], true));
+#endif
+    }
+
+    runKernelBenchmarks();
+    
+    totalLeds = 0;
+    fill_solid(leds, MAX_TOTAL_LEDS, CRGB::Black);
+#ifndef HOST_SIM
+    ledOutputClear();
+    Serial.println(F("\nSend any character to run again"));
+#endif
+}
+
+// =============================================================================
+// Entry Points
+// =============================================================================
+void setup() {
+    Serial.begin(115200);
+#ifndef HOST_SIM
+    delay(2000);
+    ledOutputBegin();
+    ledOutputClear();
+#endif
+    runBenchmarks();
+}
+
+void loop() {
+    if (Serial.available()) {
+        while (Serial.available()) Serial.read();
+        runBenchmarks();
+    }
+}
+
+#ifdef HOST_SIM
+int main() {
+    setup();
+    return 0;
+}
+#endif
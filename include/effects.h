@@ -0,0 +1,45 @@
+// =============================================================================
+// effects.h - Effect registry for LED Cube Hub
+// =============================================================================
+// Every animation is one entry in the table in effects.cpp: a name, the size
+// of its state and its init/render/teardown functions. Only one effect runs
+// at a time, so they all keep their state in one statically sized arena;
+// the build fails if an effect's state does not fit. Adding an effect only
+// touches effects.cpp - "next", "status" and the benchmark walk the table.
+// =============================================================================
+
+#ifndef EFFECTS_H
+#define EFFECTS_H
+
+#include <Arduino.h>
+#include <FastLED.h>
+
+#define EFFECT_ARENA_BYTES  16      // Largest effect state (kept over deep sleep)
+#define EFFECT_NONE         0xFF
+
+struct Effect {
+    const char* name;
+    uint16_t stateSize;
+    void (*init)(void* state);                              // Optional; state starts zeroed
+    void (*render)(void* state, CRGB* frame, int count);    // Draws over the last frame
+    void (*teardown)(void* state);                          // Optional
+};
+
+// State of the running effect; switching effects tears it down and
+// initializes the new one's in the same bytes
+struct EffectArena {
+    uint8_t active;                     // Effect the state belongs to, or EFFECT_NONE
+    alignas(8) uint8_t state[EFFECT_ARENA_BYTES];
+};
+
+extern EffectArena effectArena;
+
+uint8_t effectCount();
+const Effect* effectAt(uint8_t index);
+uint16_t effectArenaUsed();             // Largest stateSize in the table
+
+// Render context only: switches the arena over first if index is not the
+// effect it holds (out-of-range indexes run effect 0)
+void renderEffectFrame(uint8_t index, CRGB* frame, int count);
+
+#endif // EFFECTS_H
@@ -14,7 +14,12 @@
 #include <Wire.h>
 #include <Adafruit_LIS3DH.h>
 #include <Adafruit_Sensor.h>
+#include <Preferences.h>
 #include "esp_sleep.h"
+#include "driver/rmt.h"
+#include "perf.h"
+#include "pixel_ops.h"
+#include "effects.h"
 
 // =============================================================================
 // Version Information
@@ -27,6 +32,7 @@
 // Pin Definitions (XIAO ESP32-C3)
 // =============================================================================
 #define PIN_LED_DATA    D3   // WS2812 data (GPIO4)
+#define PIN_LED_DATA2   D2   // WS2812 data, second LED output (LED_CHANNEL_COUNT 2)
 #define PIN_ONEWIRE     D10  // DS2431 1-Wire bus (GPIO21)
 #define PIN_I2C_SDA     D4   // LIS3DH I2C SDA (GPIO6)
 #define PIN_I2C_SCL     D5   // LIS3DH I2C SCL (GPIO7)
@@ -35,20 +41,77 @@
 // =============================================================================
 // Configuration Constants
 // =============================================================================
+// Capacities can be raised from the build flags (see env:seeed_xiao_esp32c3_dual)
+#ifndef MAX_CUBES
 #define MAX_CUBES       8
-#define MAX_TOTAL_LEDS  300
+#endif
+#ifndef MAX_TOTAL_LEDS
+#define MAX_TOTAL_LEDS  300         // Across all LED outputs
+#endif
 #define DS2431_FAMILY   0x2D
+#define DS2431_PAGE_SIZE 32
+#define DS2431_MEMORY_SIZE 128      // 4 pages, read in one Read Memory command
+#define CUBE_CACHE_SIZE 16          // Cube memory images remembered in NVS
+#define CUBE_CACHE_FLUSH_MS 2000    // Changed cache entries reach NVS at most this often
 
 // Timing
 #define ONEWIRE_POLL_MS     1000
+// Max 1-Wire bus time per loop() pass while scanning. The longest scan step
+// is one standard-speed reset (~960 us), so the budget must be at least that.
+#define ONEWIRE_SCAN_BUDGET_US 1000
+// Full enumeration at least this often (else verify only). A hot-plugged cube
+// is still found on the next poll: an edge during our own bus traffic may hide
+// its presence pulse, so that poll enumerates instead of verifying.
+#define ONEWIRE_FULL_SCAN_MS 5000
+#define ONEWIRE_STANDARD_SCAN_MS 30000  // Standard-speed enumeration for non-overdrive devices
 #define ANIMATION_MS        33
+#define CUBE_FLASH_MS       200      // Green identify flash when a cube is added
+#define DS2431_PROG_MS      15       // Copy scratchpad programming wait (tPROG 10 ms max)
 #define ACCEL_UPDATE_MS     50
-#define ORIENTATION_CHECK_MS 100
 
 // Sleep Configuration
 #define FLIP_DETECT_WINDOW_MS  2000  // 2 second window for double flip
 #define SLEEP_FADE_MS          1000  // 1 second fade to black before sleep
 
+// Render Task
+#define RENDER_TASK_PRIORITY 2       // Above loop() (1), so bus I/O cannot delay frames
+#define RENDER_TASK_STACK    4096
+
+// LED Output (WS2812 through the RMT peripheral, sent in the background).
+// Each output is its own data line and RMT channel; all are sent in parallel.
+#ifndef LED_CHANNEL_COUNT
+#define LED_CHANNEL_COUNT 1          // 1-2: the ESP32-C3 has two RMT TX channels
+#endif
+#define LED_BRIGHTNESS   100         // Global brightness (0-255) applied on output
+#define LED_KEEPALIVE_MS 1000        // Resend an unchanged frame this often, 0 = never
+#define LED_DITHER_REFRESH 32        // Static cubes are resent while dithering a channel below this level
+#define WS2812_LED_US    30          // Wire time per LED: 24 bits at 1.25 us
+
+// Frame Streaming (binary "stream" mode, see the Frame Streaming section)
+#define STREAM_SYNC0        0xA5
+#define STREAM_SYNC1        0x5A
+#define STREAM_PIXELS       0x01     // target: first LED index
+#define STREAM_CUBE         0x02     // target: cube slot (as listed by "status")
+#define STREAM_END          0x03     // Back to the command console
+#define STREAM_FLAG_SHOW    0x01     // Show the frame once this packet is in
+#define STREAM_IDLE_MS      2000     // No data for this long ends streaming
+#define SERIAL_RX_BUFFER    2048     // Room for a full frame while loop() is busy
+
+// LIS3DH FIFO and sample cache
+#define ACCEL_I2C_HZ        400000   // LIS3DH fast mode
+#define ACCEL_FIFO_WATERMARK 10      // Samples per FIFO drain (100 ms at 100 Hz)
+#define ACCEL_CACHE_SIZE    64       // Recent samples kept for consumers (power of 2)
+#define ACCEL_BURST_MAX     16       // Samples per I2C read (Wire buffer is 128 bytes)
+#define ACCEL_LSB_PER_G     16380    // Raw counts per g at +/-2 g
+
+// ISR -> loop() event queue
+#define ISR_EVENT_QUEUE_SIZE 16      // Timestamped edges waiting for loop() (power of 2)
+
+// Accelerometer Telemetry ("telem" command, sent as stream packets)
+#define STREAM_TELEMETRY    0x10     // Hub -> host; target: sequence number of the first sample
+#define ACCEL_DATA_RATE_HZ  100      // LIS3DH rate outside telemetry (gesture timing is set for it)
+#define TELEMETRY_BATCH_MAX 8        // Samples per packet
+
 // LIS3DH I2C Address
 #define LIS3DH_ADDRESS    0x18
 
@@ -56,50 +119,188 @@
 // Data Structures
 // =============================================================================
 
-// Cube Configuration Structure (stored in DS2431 EEPROM)
+// DS2431 EEPROM layout: one 32-byte structure per page. From layout 1 on,
+// the last two bytes of every page hold the inverted CRC16 of the other 30
+// (cubeMemorySeal()). Layout 0 cubes only have page 0, without a CRC.
+#define CUBE_LAYOUT_LEGACY  0
+#define CUBE_LAYOUT_CRC     1
+
+// Page 0 colorOrder: channel order the cube's LEDs expect on the wire
+#define CUBE_ORDER_GRB      0       // WS2812B
+#define CUBE_ORDER_RGB      1
+#define CUBE_ORDER_BRG      2
+#define CUBE_ORDER_RBG      3
+#define CUBE_ORDER_GBR      4
+#define CUBE_ORDER_BGR      5
+
+// Page 0: Cube Configuration
 struct CubeConfig {
     uint8_t  cubeType;
     uint16_t ledCount;
-    uint8_t  colorOrder;
-    uint8_t  brightness;
+    uint8_t  colorOrder;        // CUBE_ORDER_*
+    uint8_t  brightness;        // Relative to LED_BRIGHTNESS: 128 = as is, 0 = unset
+    uint8_t  layout;            // CUBE_LAYOUT_*
+    uint8_t  output;            // LED output (data line) the cube is chained on
+    uint8_t  reserved[22];
+    uint16_t crc;
+};
+
+// Page 1: LED orientation map
+#define CUBE_MAP_REVERSE     0x01   // Chain runs from the last LED to the first
+#define CUBE_MAP_SERPENTINE  0x02   // Alternate rows run backwards
+
+struct CubeLedMap {
+    uint8_t  flags;             // CUBE_MAP_*
+    uint8_t  rowLength;         // LEDs per row (serpentine wiring)
+    uint8_t  rotation;          // Quarter turns of the face
+    uint8_t  reserved[27];
+    uint16_t crc;
+};
+
+// Page 2: Color calibration
+struct CubeGamma {
+    uint8_t  gamma[3];          // R, G, B gamma x10 (22 = 2.2), 0 = linear
+    uint8_t  scale[3];          // White balance, 255 = unity
+    uint8_t  reserved[24];
+    uint16_t crc;
+};
+
+// Page 3: Power
+struct CubePower {
+    uint16_t maxMilliamps;      // Current limit for this cube, 0 = none
+    uint8_t  ledMilliamps;      // Per channel at full brightness
     uint8_t  reserved[27];
+    uint16_t crc;
+};
+
+// Whole DS2431 memory
+struct CubeMemory {
+    CubeConfig config;
+    CubeLedMap ledMap;
+    CubeGamma  gamma;
+    CubePower  power;
+};
+
+static_assert(sizeof(CubeConfig) == DS2431_PAGE_SIZE, "CubeConfig must fill one page");
+static_assert(sizeof(CubeMemory) == DS2431_MEMORY_SIZE, "CubeMemory must match the DS2431");
+
+// Outcome of the last beginDs2431Write() job
+struct Ds2431WriteResult {
+    uint64_t romId;
+    bool ok;
+    uint8_t rowsWritten;
+    uint8_t rowsSkipped;            // Already held the target bytes
+    uint32_t elapsedMs;
+    const __FlashStringHelper* error;   // Set when !ok
+};
+
+// Result of validating a CubeMemory image
+enum CubeMemoryStatus {
+    CUBE_MEM_OK,                // Valid config (calibration pages checked separately)
+    CUBE_MEM_BLANK,             // Unprogrammed (or nothing answered)
+    CUBE_MEM_INVALID,           // Programmed, but the config is unusable
+    CUBE_MEM_CORRUPT,           // Page 0 CRC mismatch
+    CUBE_MEM_ABSENT             // No presence pulse
 };
 
 // Cube Instance (runtime tracking)
 struct Cube {
     uint64_t romId;
     CubeConfig config;
+    CubeLedMap ledMap;
+    CubeGamma gamma;
+    CubePower power;
     uint16_t ledStart;
     uint16_t ledCount;
+    uint8_t output;             // config.output, or 0 if out of range
+    uint32_t flashUntil;        // millis() until which the identify flash shows
     bool active;
 };
 
+struct LedCalibration;
+
+// What the render task and LED output need to know about one active cube:
+// where its pixels sit in the frame, which output they are sent on and how
+struct RenderSegment {
+    uint16_t start;
+    uint16_t count;
+    uint32_t flashUntil;
+    const LedCalibration* calibration;  // Output LUTs, nullptr = uncorrected
+    uint8_t output;
+    uint8_t colorOrder;                 // CUBE_ORDER_*
+};
+
+struct RenderLayout {
+    uint32_t generation;                // Build count, tells which calibration tables it uses
+    int totalLeds;
+    uint8_t segmentCount;               // Active cubes, in frame order
+    RenderSegment segments[MAX_CUBES];
+};
+
+#define LED_ALL_SEGMENTS 0xFFFFFFFFu    // ledOutputShow() segment mask: whole frame
+
+static_assert(MAX_CUBES <= 32, "ledOutputShow() takes a 32-bit segment mask");
+
+// Render task output counters since boot; skipped LEDs were unchanged and
+// not resent (whole frames, or the cubes past the last change on an output)
+struct RenderStats {
+    uint32_t framesSent;
+    uint32_t framesSkipped;
+    uint32_t ledsSent;
+    uint32_t ledsSkipped;
+};
+
+// An interrupt edge, queued by the ISR and handled by serviceIsrEvents()
+enum IsrEventType : uint8_t {
+    ISR_EVENT_ACCEL,        // INT1 rose: click, 6D change or FIFO watermark
+    ISR_EVENT_ONEWIRE,      // 1-Wire bus pulled low: presence pulse or our own slot
+};
+
+struct IsrEvent {
+    uint32_t us;            // micros() in the ISR
+    IsrEventType type;
+};
+
+// One LIS3DH sample from the FIFO (see serviceAccelFifo())
+struct AccelSample {
+    uint32_t us;            // Sample time, estimated from the drain time and rate
+    int16_t x;              // Raw, left-justified 12 bit (ACCEL_LSB_PER_G)
+    int16_t y;
+    int16_t z;
+};
+
 // =============================================================================
 // Global Hardware Objects (extern declarations)
 // =============================================================================
 extern OneWire oneWire;
-extern CRGB leds[];
-extern Adafruit_LIS3DH lis3dh;
+extern CRGB* leds;               // Front buffer (last frame sent to the LEDs)
 
 // =============================================================================
 // Global State Variables (extern declarations)
 // =============================================================================
 extern Cube cubes[];
-extern int cubeCount;
-extern int totalLeds;
+extern int cubeCount;                   // Slots in use (one past the highest active)
+extern int totalLeds;                   // LEDs of the active cubes, packed from 0
 
 extern uint32_t lastPoll;
-extern uint32_t lastAnim;
 extern uint32_t lastAccel;
-extern uint32_t lastOrientationCheck;
-extern uint8_t animFrame;
 extern uint8_t currentAnimation;
 extern bool animationRunning;
 extern bool accelMode;
 extern bool lis3dhFound;
 extern bool ledsEnabled;
+extern bool oneWireOverdrive;
+
+extern bool accelIntPending;              // INT1 rose (click, 6D or FIFO watermark)
+extern bool doubleTapDetected;            // INT1 may hold a click to read
+extern bool oneWireHotPlug;
+
+extern volatile uint32_t isrEventsDropped;  // Edges that found the queue full
+extern uint8_t isrEventPeak;                // Most events seen waiting at once
+
+extern uint32_t accelFifoOverruns;
 
-extern volatile bool doubleTapDetected;
+extern RenderStats renderStats;
 
 extern uint8_t accelR;
 extern uint8_t accelG;
@@ -115,44 +316,115 @@ extern bool sleepRequested;
 // Hardware Function Declarations
 // =============================================================================
 
-// I2C Register Functions
+// I2C Register Functions (LIS3DH)
 void writeReg(uint8_t reg, uint8_t val);
 uint8_t readReg(uint8_t reg);
+void writeRegs(uint8_t reg, const uint8_t* vals, uint8_t count);
+bool readRegs(uint8_t reg, uint8_t* buf, uint8_t count);
 
-// Interrupt Handler
-void IRAM_ATTR onDoubleTap();
+// Interrupt Handlers (queue timestamped events for loop())
+void IRAM_ATTR onAccelInt();
+void IRAM_ATTR onOneWireEdge();
+void serviceIsrEvents();
 
 // Utility Functions
 int freeRam();
 
 // LIS3DH Functions
-bool initLIS3DH();
+bool initLIS3DH(bool verbose);
 void handleDoubleTap();
+void setAccelDataRate(uint16_t hz);
+bool serviceAccelFifo();
+const AccelSample* accelLatest();
+uint32_t accelSampleCount();
+bool accelGetSample(uint32_t seq, AccelSample* sample);
 void updateAccelerometer();
 void printAccelData();
 
-// Sleep Functions
+// Sleep Functions (cube table and animation state survive in RTC memory)
 void enterDeepSleep();
+void saveRetainedState();
+bool restoreRetainedState();
 void checkOrientation();
 
+// 1-Wire Transport (overdrive with standard-speed fallback)
+void owResetSearch();
+bool owSearch(uint8_t* addr);
+
 // DS2431 Functions
 uint64_t addressToId(uint8_t* addr);
 void idToAddress(uint64_t id, uint8_t* addr);
 bool isDS2431(uint8_t* addr);
-bool ds2431ReadPage(uint8_t* addr, uint8_t page, uint8_t* buffer);
-bool ds2431Write8(uint8_t* addr, uint8_t offset, uint8_t* data);
+bool ds2431ReadMemory(uint8_t* addr, uint8_t* buffer);
 bool ds2431WritePage(uint8_t* addr, uint8_t page, uint8_t* data);
 
+// DS2431 Write Pipeline (one bus step per call; ds2431WritePage() blocks)
+bool beginDs2431Write(uint8_t* addr, uint8_t start, const uint8_t* data, uint8_t len);
+bool stepDs2431Write();
+bool ds2431WriteBusy();
+const Ds2431WriteResult& ds2431LastWrite();
+
+// Cube Memory Functions
+void cubeMemoryDefaults(CubeMemory* mem, uint8_t cubeType, uint16_t ledCount);
+void cubeMemoryReprogram(CubeMemory* mem, CubeMemoryStatus status, uint8_t cubeType, uint16_t ledCount);
+void cubeMemorySeal(CubeMemory* mem);
+CubeMemoryStatus cubeMemoryCheck(const CubeMemory* mem);
+CubeMemoryStatus readCubeMemory(uint8_t* addr, CubeMemory* mem);
+bool findOneWireDevice(int index, uint8_t* addr);
+
+// Cube Config Cache (NVS, keyed by ROM ID)
+void initCubeCache();
+bool cubeCacheLookup(uint64_t romId, CubeMemory* mem);
+bool cubeCacheStore(uint64_t romId, const CubeMemory* mem);
+void cubeCacheForget(uint64_t romId);
+void serviceCubeCache();                // loop(): writes a changed cache once the bus is idle
+void cubeCacheFlush();                  // Writes a changed cache now (before deep sleep)
+void cubeCacheClear();
+void printCubeCache();
+
 // Cube Management Functions
 int findCube(uint64_t romId);
-bool addCube(uint64_t romId, CubeConfig* config);
+int activeCubeCount();
+bool addCube(uint64_t romId, CubeMemory* mem);
 void removeCube(uint64_t romId);
-void scanOneWireBus();
+
+// 1-Wire Scanning (incremental; scanOneWireBus() runs a full pass blocking)
+void beginOneWireScan();
+void beginOneWirePoll();
+bool stepOneWireScan(uint32_t budgetUs);
+bool oneWireScanBusy();
+void cancelOneWireScan();
+bool scanOneWireBus();                  // false while a DS2431 write is in progress
 
 // Animation Functions
 void runAnimation();
 
+// LED Output (ledOutputShow() returns while the frame is still being sent)
+bool ledOutputBegin();
+int ledOutputShow(const CRGB* frame, const RenderLayout* layout, uint8_t brightness, uint32_t segments);
+uint32_t ledOutputDithering();          // Segments to keep sending for their dither
+void ledOutputClear();
+void ledOutputWait();
+
+// Render Task (double-buffered; owns the LEDs once started)
+void buildRenderLayout(RenderLayout* layout);
+void publishRenderLayout();
+void startRenderTask();
+void stopRenderTask();
+
+// Frame Streaming (render task paused while active)
+void beginFrameStream();
+bool frameStreamActive();
+void pollFrameStream();
+void endFrameStream();
+
+// Accelerometer Telemetry
+bool beginTelemetry(uint16_t hz);
+bool telemetryActive();
+void serviceTelemetry();
+void endTelemetry();
+
 // Hardware Initialization
-void initializeHardware();
+void initializeHardware(bool resume);
 
 #endif // HARDWARE_H
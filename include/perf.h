@@ -0,0 +1,64 @@
+// =============================================================================
+// perf.h - Hot-path timing for LED Cube Hub
+// =============================================================================
+// perfStart()/perfEnd() bracket a piece of code and add its duration in CPU
+// cycles to that timing point's histogram: count, min, avg, max and a
+// log-linear bucket table (4 buckets per power of two) for the p99. The
+// latency points take perfRecordUs(): interrupt edge to its handler. Build
+// with -DPERF_ENABLED=0 and the calls compile to nothing.
+// =============================================================================
+
+#ifndef PERF_H
+#define PERF_H
+
+#include <Arduino.h>
+
+#ifndef PERF_ENABLED
+#define PERF_ENABLED 1
+#endif
+
+// Timing points, in "perf" and "perf dump" order
+enum PerfPoint {
+    PERF_LOOP,              // Whole loop() pass
+    PERF_DOUBLE_TAP,        // handleDoubleTap()
+    PERF_SERIAL,            // processSerial()
+    PERF_ACCEL,             // FIFO drain, updateAccelerometer(), telemetry
+    PERF_ORIENTATION,       // checkOrientation()
+    PERF_ONEWIRE,           // Write pipeline step + incremental bus scan
+    PERF_RENDER,            // Effect + overlay into the back buffer (render task)
+    PERF_SHOW,              // ledOutputShow(): fence + pack + start (render task)
+    PERF_TAP_LATENCY,       // INT1 edge to the click read in handleDoubleTap()
+    PERF_6D_LATENCY,        // INT1 edge to the 6D read in checkOrientation()
+    PERF_FIFO_LATENCY,      // INT1 watermark edge to the FIFO drained
+    PERF_CALIBRATION,       // One cube output table built (buildRenderLayout(), loop())
+    PERF_POINT_COUNT
+};
+
+#define PERF_DUMP_VERSION 1
+
+#if PERF_ENABLED
+void perfRecord(PerfPoint point, uint32_t cycles);
+
+static inline uint32_t perfStart() {
+    return ESP.getCycleCount();
+}
+
+// The cycle counter is 32-bit; differences stay right across a wrap
+static inline void perfEnd(PerfPoint point, uint32_t start) {
+    perfRecord(point, ESP.getCycleCount() - start);
+}
+
+static inline void perfRecordUs(PerfPoint point, uint32_t us) {
+    perfRecord(point, us * ESP.getCpuFreqMHz());
+}
+#else
+static inline uint32_t perfStart() { return 0; }
+static inline void perfEnd(PerfPoint point, uint32_t start) { (void)point; (void)start; }
+static inline void perfRecordUs(PerfPoint point, uint32_t us) { (void)point; (void)us; }
+#endif
+
+void perfPrint();       // Table in us
+void perfDump();        // Binary summary (see README)
+void perfReset();
+
+#endif // PERF_H
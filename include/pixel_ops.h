@@ -0,0 +1,30 @@
+// =============================================================================
+// pixel_ops.h - Packed-pixel kernels for LED Cube Hub effects
+// =============================================================================
+// The ESP32-C3 has no SIMD, so these work on 32-bit words instead: four
+// channel bytes per load and store, with the per-byte math done on two
+// 16-bit lanes at a time (SWAR). CRGB arrays are 3-byte pixels, so a word
+// spans pixel boundaries; the fill and add kernels repeat the color over a
+// 12-byte (3-word) pattern. Unaligned ends are done a byte at a time.
+//
+// Every kernel gives exactly what the FastLED function named next to it
+// does; bench_render checks that before timing them against it.
+// =============================================================================
+
+#ifndef PIXEL_OPS_H
+#define PIXEL_OPS_H
+
+#include <Arduino.h>
+#include <FastLED.h>
+
+void pixelFill(CRGB* px, int count, CRGB color);                    // fill_solid()
+void pixelScale(CRGB* px, int count, uint8_t scale);                // nscale8()
+void pixelFade(CRGB* px, int count, uint8_t fadeBy);                // fadeToBlackBy()
+void pixelAdd(CRGB* px, int count, CRGB color);                     // px[i] += color
+void pixelLerp(CRGB* px, const CRGB* to, int count, fract8 frac);   // lerp8by8() per channel
+
+// px[i] = CHSV(hue + i * step, sat, val), from a 256-entry table that is
+// rebuilt only when sat or val change
+void pixelFillHue(CRGB* px, int count, uint8_t hue, uint8_t step, uint8_t sat, uint8_t val);
+
+#endif // PIXEL_OPS_H
@@ -0,0 +1,70 @@
+// =============================================================================
+// Adafruit_LIS3DH.h - Host stand-in for Adafruit LIS3DH 1.2.x (native build)
+// =============================================================================
+// Talks to the simulated sensor over the Wire stand-in using the same
+// register sequence as the real driver, so I2C traffic is accounted for.
+// =============================================================================
+
+#ifndef SIM_ADAFRUIT_LIS3DH_H
+#define SIM_ADAFRUIT_LIS3DH_H
+
+#include "Arduino.h"
+#include "Adafruit_Sensor.h"
+#include "Wire.h"
+
+#define LIS3DH_DEFAULT_ADDRESS (0x18)
+
+#define LIS3DH_REG_WHOAMI    0x0F
+#define LIS3DH_REG_TEMPCFG   0x1F
+#define LIS3DH_REG_CTRL1     0x20
+#define LIS3DH_REG_CTRL3     0x22
+#define LIS3DH_REG_CTRL4     0x23
+#define LIS3DH_REG_OUT_X_L   0x28
+
+typedef enum {
+    LIS3DH_RANGE_16_G = 0b11,
+    LIS3DH_RANGE_8_G  = 0b10,
+    LIS3DH_RANGE_4_G  = 0b01,
+    LIS3DH_RANGE_2_G  = 0b00
+} lis3dh_range_t;
+
+typedef enum {
+    LIS3DH_DATARATE_400_HZ       = 0b0111,
+    LIS3DH_DATARATE_200_HZ       = 0b0110,
+    LIS3DH_DATARATE_100_HZ       = 0b0101,
+    LIS3DH_DATARATE_50_HZ        = 0b0100,
+    LIS3DH_DATARATE_25_HZ        = 0b0011,
+    LIS3DH_DATARATE_10_HZ        = 0b0010,
+    LIS3DH_DATARATE_1_HZ         = 0b0001,
+    LIS3DH_DATARATE_POWERDOWN    = 0,
+    LIS3DH_DATARATE_LOWPOWER_1K6HZ = 0b1000,
+    LIS3DH_DATARATE_LOWPOWER_5KHZ  = 0b1001
+} lis3dh_dataRate_t;
+
+class Adafruit_LIS3DH : public Adafruit_Sensor {
+public:
+    Adafruit_LIS3DH() {}
+
+    bool begin(uint8_t addr = LIS3DH_DEFAULT_ADDRESS, uint8_t nWAI = 0x33);
+
+    void read();
+
+    void setRange(lis3dh_range_t range);
+    lis3dh_range_t getRange();
+
+    void setDataRate(lis3dh_dataRate_t dataRate);
+    lis3dh_dataRate_t getDataRate();
+
+    bool getEvent(sensors_event_t* event) override;
+
+    int16_t x, y, z;
+    float x_g, y_g, z_g;
+
+private:
+    void writeRegister8(uint8_t reg, uint8_t value);
+    uint8_t readRegister8(uint8_t reg);
+
+    uint8_t _i2caddr = LIS3DH_DEFAULT_ADDRESS;
+};
+
+#endif // SIM_ADAFRUIT_LIS3DH_H
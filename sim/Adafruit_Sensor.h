@@ -0,0 +1,47 @@
+// =============================================================================
+// Adafruit_Sensor.h - Host stand-in for the Adafruit Unified Sensor types
+// =============================================================================
+
+#ifndef SIM_ADAFRUIT_SENSOR_H
+#define SIM_ADAFRUIT_SENSOR_H
+
+#include "Arduino.h"
+
+#define SENSORS_GRAVITY_STANDARD (9.80665F)
+
+typedef enum {
+    SENSOR_TYPE_ACCELEROMETER = (1)
+} sensors_type_t;
+
+typedef struct {
+    union {
+        float v[3];
+        struct {
+            float x;
+            float y;
+            float z;
+        };
+    };
+    int8_t status;
+    uint8_t reserved[3];
+} sensors_vec_t;
+
+typedef struct {
+    int32_t version;
+    int32_t sensor_id;
+    int32_t type;
+    int32_t reserved0;
+    int32_t timestamp;
+    union {
+        float data[4];
+        sensors_vec_t acceleration;
+    };
+} sensors_event_t;
+
+class Adafruit_Sensor {
+public:
+    virtual ~Adafruit_Sensor() {}
+    virtual bool getEvent(sensors_event_t*) = 0;
+};
+
+#endif // SIM_ADAFRUIT_SENSOR_H
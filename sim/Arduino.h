@@ -0,0 +1,216 @@
+// =============================================================================
+// Arduino.h - Host stand-in for the Arduino-ESP32 core (native build only)
+// =============================================================================
+// Provides just enough of the Arduino API for hardware.cpp and main.cpp to
+// compile and run on Linux. Time is virtual: millis()/micros() read the
+// simulated clock in sim.h, and delay() advances it instead of sleeping, so
+// the firmware runs far faster than real time.
+// =============================================================================
+
+#ifndef SIM_ARDUINO_H
+#define SIM_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <string>
+
+// The ESP32 core pulls the FreeRTOS task API in through Arduino.h
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+// =============================================================================
+// Basic Types and Constants
+// =============================================================================
+typedef bool    boolean;
+typedef uint8_t byte;
+
+#define HIGH            0x1
+#define LOW             0x0
+
+#define INPUT           0x01
+#define OUTPUT          0x03
+#define INPUT_PULLUP    0x05
+#define INPUT_PULLDOWN  0x09
+
+#define RISING          0x01
+#define FALLING         0x02
+#define CHANGE          0x03
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+#define IRAM_ATTR
+#define DRAM_ATTR
+// RTC slow memory: one section, saved and restored by sim_esp_sleep.cpp
+#define RTC_DATA_ATTR   __attribute__((section("rtc_data")))
+#define RTC_NOINIT_ATTR __attribute__((section("rtc_data")))
+
+#ifndef BIT
+#define BIT(nr) (1ULL << (nr))
+#endif
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+#define digitalPinToInterrupt(p) (p)
+
+// =============================================================================
+// XIAO ESP32-C3 Pin Map (variants/XIAO_ESP32C3/pins_arduino.h)
+// =============================================================================
+static const uint8_t D0  = 2;
+static const uint8_t D1  = 3;
+static const uint8_t D2  = 4;
+static const uint8_t D3  = 5;
+static const uint8_t D4  = 6;
+static const uint8_t D5  = 7;
+static const uint8_t D6  = 21;
+static const uint8_t D7  = 20;
+static const uint8_t D8  = 8;
+static const uint8_t D9  = 9;
+static const uint8_t D10 = 10;
+
+#define SIM_GPIO_COUNT 22
+
+// =============================================================================
+// Timing and GPIO
+// =============================================================================
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+void yield();
+
+void pinMode(uint8_t pin, uint8_t mode);
+int  digitalRead(uint8_t pin);
+void digitalWrite(uint8_t pin, uint8_t val);
+void attachInterrupt(uint8_t pin, void (*isr)(void), int mode);
+void detachInterrupt(uint8_t pin);
+
+long random(long howbig);
+long random(long howsmall, long howbig);
+void randomSeed(unsigned long seed);
+
+// =============================================================================
+// Flash Strings
+// =============================================================================
+class __FlashStringHelper;
+#define F(string_literal) (reinterpret_cast<const __FlashStringHelper*>(string_literal))
+
+// =============================================================================
+// String (subset of WString.h used by the firmware)
+// =============================================================================
+class String {
+public:
+    String() {}
+    String(const char* s) : s_(s ? s : "") {}
+    String(const std::string& s) : s_(s) {}
+
+    const char* c_str() const { return s_.c_str(); }
+    unsigned int length() const { return s_.length(); }
+    char charAt(unsigned int i) const { return i < s_.length() ? s_[i] : 0; }
+    char operator[](unsigned int i) const { return charAt(i); }
+
+    void trim();
+    bool startsWith(const char* prefix) const;
+    String substring(unsigned int from) const;
+    String substring(unsigned int from, unsigned int to) const;
+    long toInt() const { return atol(s_.c_str()); }
+
+    String& operator+=(char c) { s_ += c; return *this; }
+    String& operator+=(const char* s) { s_ += s; return *this; }
+    bool operator==(const char* s) const { return s_ == s; }
+    bool operator!=(const char* s) const { return s_ != s; }
+    bool operator==(const String& s) const { return s_ == s.s_; }
+
+private:
+    std::string s_;
+};
+
+// =============================================================================
+// Print / Stream
+// =============================================================================
+class Print {
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t* buf, size_t len);
+    size_t write(const char* s) { return s ? write((const uint8_t*)s, strlen(s)) : 0; }
+
+    size_t print(const __FlashStringHelper* s);
+    size_t print(const String& s);
+    size_t print(const char* s);
+    size_t print(char c);
+    size_t print(unsigned char n, int base = DEC);
+    size_t print(int n, int base = DEC);
+    size_t print(unsigned int n, int base = DEC);
+    size_t print(long n, int base = DEC);
+    size_t print(unsigned long n, int base = DEC);
+    size_t print(long long n, int base = DEC);
+    size_t print(unsigned long long n, int base = DEC);
+    size_t print(double n, int digits = 2);
+
+    size_t println();
+    template <typename T> size_t println(T v) { size_t n = print(v); return n + println(); }
+    template <typename T> size_t println(T v, int fmt) { size_t n = print(v, fmt); return n + println(); }
+
+private:
+    size_t printNumber(unsigned long long n, uint8_t base);
+};
+
+class Stream : public Print {
+public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+
+    void setTimeout(unsigned long timeout) { timeout_ = timeout; }
+    String readStringUntil(char terminator);
+    size_t readBytes(uint8_t* buf, size_t len);
+
+protected:
+    int timedRead();
+    unsigned long timeout_ = 1000;
+};
+
+// Serial port backed by the host terminal (see sim.h for input injection).
+class SimSerial : public Stream {
+public:
+    void begin(unsigned long baud) { (void)baud; }
+    size_t setRxBufferSize(size_t size) { return size; }
+    void end() {}
+    operator bool() const { return true; }
+
+    int available() override;
+    int read() override;
+    int peek() override;
+    int availableForWrite();
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t* buf, size_t len) override;
+    using Print::write;
+    void flush();
+};
+
+extern SimSerial Serial;
+
+// =============================================================================
+// ESP Class (Esp.h subset)
+// =============================================================================
+class EspClass {
+public:
+    uint32_t getFreeHeap();
+    uint32_t getCycleCount();
+    uint32_t getCpuFreqMHz() { return 160; }
+    void restart();
+};
+
+extern EspClass ESP;
+
+// Arduino sketches provide these.
+void setup();
+void loop();
+
+#endif // SIM_ARDUINO_H
@@ -0,0 +1,294 @@
+// =============================================================================
+// FastLED.h - Host stand-in for FastLED 3.6.0 (native build only)
+// =============================================================================
+// Implements the subset of FastLED the firmware uses with the same integer
+// math as the real library (FASTLED_SCALE8_FIXED=1 lib8tion, rainbow
+// hsv2rgb, rand16), so animations render bit-identical frames on the host.
+// show() does not drive a pin: it latches the frame into the simulated wire
+// buffer and advances the virtual clock by the WS2812 transfer time.
+// =============================================================================
+
+#ifndef SIM_FASTLED_H
+#define SIM_FASTLED_H
+
+#include "Arduino.h"
+
+#define FASTLED_VERSION 3006000
+#define FASTLED_SCALE8_FIXED 1
+
+typedef uint8_t  fract8;
+typedef uint16_t fract16;
+typedef uint16_t accum88;
+
+// =============================================================================
+// lib8tion (math8.h / scale8.h / trig8.h / random8.h / lib8tion.h)
+// =============================================================================
+inline uint8_t scale8(uint8_t i, fract8 scale) {
+    return (((uint16_t)i) * (1 + (uint16_t)(scale))) >> 8;
+}
+
+inline uint8_t scale8_video(uint8_t i, fract8 scale) {
+    return (((int)i * (int)scale) >> 8) + ((i && scale) ? 1 : 0);
+}
+
+inline uint16_t scale16(uint16_t i, fract16 scale) {
+    return ((uint32_t)i * (1 + (uint32_t)scale)) / 65536;
+}
+
+inline void nscale8x3(uint8_t& r, uint8_t& g, uint8_t& b, fract8 scale) {
+    uint16_t scale_fixed = scale + 1;
+    r = (((uint16_t)r) * scale_fixed) >> 8;
+    g = (((uint16_t)g) * scale_fixed) >> 8;
+    b = (((uint16_t)b) * scale_fixed) >> 8;
+}
+
+inline uint8_t qadd8(uint8_t i, uint8_t j) {
+    unsigned int t = i + j;
+    return t > 255 ? 255 : t;
+}
+
+inline uint8_t qsub8(uint8_t i, uint8_t j) {
+    int t = i - j;
+    return t < 0 ? 0 : t;
+}
+
+inline uint8_t lerp8by8(uint8_t a, uint8_t b, fract8 frac) {
+    uint8_t result;
+    if (b > a) {
+        uint8_t delta = b - a;
+        uint8_t scaled = scale8(delta, frac);
+        result = a + scaled;
+    } else {
+        uint8_t delta = a - b;
+        uint8_t scaled = scale8(delta, frac);
+        result = a - scaled;
+    }
+    return result;
+}
+
+uint8_t sin8(uint8_t theta);
+
+extern uint16_t rand16seed;
+
+#define FASTLED_RAND16_2053  ((uint16_t)(2053))
+#define FASTLED_RAND16_13849 ((uint16_t)(13849))
+
+inline uint8_t random8() {
+    rand16seed = (rand16seed * FASTLED_RAND16_2053) + FASTLED_RAND16_13849;
+    return (uint8_t)(((uint8_t)(rand16seed & 0xFF)) + ((uint8_t)(rand16seed >> 8)));
+}
+
+inline uint8_t random8(uint8_t lim) {
+    uint8_t r = random8();
+    r = (r * lim) >> 8;
+    return r;
+}
+
+inline uint16_t random16() {
+    rand16seed = (rand16seed * FASTLED_RAND16_2053) + FASTLED_RAND16_13849;
+    return rand16seed;
+}
+
+inline uint16_t random16(uint16_t lim) {
+    uint16_t r = random16();
+    uint32_t p = (uint32_t)lim * (uint32_t)r;
+    r = p >> 16;
+    return r;
+}
+
+inline void random16_set_seed(uint16_t seed) {
+    rand16seed = seed;
+}
+
+inline uint16_t beat88(accum88 beats_per_minute_88, uint32_t timebase = 0) {
+    return (((millis()) - timebase) * beats_per_minute_88 * 280) >> 16;
+}
+
+inline uint16_t beat16(accum88 beats_per_minute, uint32_t timebase = 0) {
+    if (beats_per_minute < 256) beats_per_minute <<= 8;
+    return beat88(beats_per_minute, timebase);
+}
+
+inline uint8_t beat8(accum88 beats_per_minute, uint32_t timebase = 0) {
+    return beat16(beats_per_minute, timebase) >> 8;
+}
+
+inline uint8_t beatsin8(accum88 beats_per_minute, uint8_t lowest = 0, uint8_t highest = 255,
+                        uint32_t timebase = 0, uint8_t phase_offset = 0) {
+    uint8_t beat = beat8(beats_per_minute, timebase);
+    uint8_t beatsin = sin8(beat + phase_offset);
+    uint8_t rangewidth = highest - lowest;
+    uint8_t scaledbeat = scale8(beatsin, rangewidth);
+    uint8_t result = lowest + scaledbeat;
+    return result;
+}
+
+// =============================================================================
+// Pixel Types (pixeltypes.h)
+// =============================================================================
+struct CRGB;
+
+struct CHSV {
+    union {
+        struct {
+            union { uint8_t hue; uint8_t h; };
+            union { uint8_t saturation; uint8_t sat; uint8_t s; };
+            union { uint8_t value; uint8_t val; uint8_t v; };
+        };
+        uint8_t raw[3];
+    };
+
+    CHSV() {}
+    CHSV(uint8_t ih, uint8_t is, uint8_t iv) : h(ih), s(is), v(iv) {}
+};
+
+void hsv2rgb_rainbow(const CHSV& hsv, CRGB& rgb);
+
+struct CRGB {
+    union {
+        struct {
+            union { uint8_t r; uint8_t red; };
+            union { uint8_t g; uint8_t green; };
+            union { uint8_t b; uint8_t blue; };
+        };
+        uint8_t raw[3];
+    };
+
+    typedef enum {
+        Black  = 0x000000,
+        Blue   = 0x0000FF,
+        Green  = 0x008000,
+        Red    = 0xFF0000,
+        White  = 0xFFFFFF
+    } HTMLColorCode;
+
+    CRGB() {}
+    CRGB(uint8_t ir, uint8_t ig, uint8_t ib) : r(ir), g(ig), b(ib) {}
+    CRGB(uint32_t colorcode) : r((colorcode >> 16) & 0xFF), g((colorcode >> 8) & 0xFF), b(colorcode & 0xFF) {}
+    CRGB(HTMLColorCode colorcode) : CRGB((uint32_t)colorcode) {}
+    CRGB(const CHSV& rhs) { hsv2rgb_rainbow(rhs, *this); }
+
+    CRGB& operator=(const CHSV& rhs) { hsv2rgb_rainbow(rhs, *this); return *this; }
+    CRGB& operator=(uint32_t colorcode) {
+        r = (colorcode >> 16) & 0xFF;
+        g = (colorcode >> 8) & 0xFF;
+        b = colorcode & 0xFF;
+        return *this;
+    }
+
+    uint8_t& operator[](uint8_t x) { return raw[x]; }
+    const uint8_t& operator[](uint8_t x) const { return raw[x]; }
+
+    CRGB& nscale8(uint8_t scaledown) {
+        nscale8x3(r, g, b, scaledown);
+        return *this;
+    }
+
+    CRGB& fadeToBlackBy(uint8_t fadefactor) {
+        nscale8x3(r, g, b, 255 - fadefactor);
+        return *this;
+    }
+
+    CRGB& operator+=(const CRGB& rhs) {
+        r = qadd8(r, rhs.r);
+        g = qadd8(g, rhs.g);
+        b = qadd8(b, rhs.b);
+        return *this;
+    }
+
+    CRGB& operator|=(const CRGB& rhs) {
+        if (rhs.r > r) r = rhs.r;
+        if (rhs.g > g) g = rhs.g;
+        if (rhs.b > b) b = rhs.b;
+        return *this;
+    }
+};
+
+inline bool operator==(const CRGB& lhs, const CRGB& rhs) {
+    return (lhs.r == rhs.r) && (lhs.g == rhs.g) && (lhs.b == rhs.b);
+}
+
+inline bool operator!=(const CRGB& lhs, const CRGB& rhs) {
+    return !(lhs == rhs);
+}
+
+// =============================================================================
+// Color Utilities (colorutils.h)
+// =============================================================================
+void fill_solid(struct CRGB* leds, int numToFill, const struct CRGB& color);
+void nscale8(CRGB* leds, uint16_t num_leds, uint8_t scale);
+void fadeToBlackBy(CRGB* leds, uint16_t num_leds, uint8_t fadeBy);
+
+// =============================================================================
+// Controllers (controller.h / FastLED.h)
+// =============================================================================
+enum EOrder {
+    RGB = 0012,
+    RBG = 0021,
+    GRB = 0102,
+    GBR = 0120,
+    BRG = 0201,
+    BGR = 0210
+};
+
+template <uint8_t DATA_PIN, EOrder RGB_ORDER = GRB> class WS2812B {};
+template <uint8_t DATA_PIN, EOrder RGB_ORDER = GRB> class WS2812 {};
+
+class CLEDController {
+public:
+    CLEDController(uint8_t pin, EOrder order) : m_pin(pin), m_order(order) {}
+
+    CLEDController& setLeds(CRGB* data, int nLeds) {
+        m_Data = data;
+        m_nLeds = nLeds;
+        return *this;
+    }
+
+    // Clock the pixels out on this controller's pin (blocking).
+    void showLeds(uint8_t brightness);
+    void clearLedData() { if (m_Data) fill_solid(m_Data, m_nLeds, CRGB::Black); }
+
+    CRGB* leds() { return m_Data; }
+    int size() const { return m_nLeds; }
+    uint8_t pin() const { return m_pin; }
+    EOrder order() const { return m_order; }
+
+private:
+    CRGB* m_Data = nullptr;
+    int m_nLeds = 0;
+    uint8_t m_pin;
+    EOrder m_order;
+};
+
+#define SIM_MAX_CONTROLLERS 8
+
+class CFastLED {
+public:
+    template <template <uint8_t DATA_PIN, EOrder RGB_ORDER> class CHIPSET, uint8_t DATA_PIN, EOrder RGB_ORDER>
+    CLEDController& addLeds(CRGB* data, int nLedsOrOffset, int nLedsIfOffset = 0) {
+        int offset = (nLedsIfOffset > 0) ? nLedsOrOffset : 0;
+        int nLeds = (nLedsIfOffset > 0) ? nLedsIfOffset : nLedsOrOffset;
+        return addController(DATA_PIN, RGB_ORDER).setLeds(data + offset, nLeds);
+    }
+
+    void setBrightness(uint8_t scale) { m_Scale = scale; }
+    uint8_t getBrightness() const { return m_Scale; }
+
+    void show() { show(m_Scale); }
+    void show(uint8_t scale);
+    void clear(bool writeData = false);
+
+    int count() const { return m_nControllers; }
+    CLEDController& operator[](int x) { return *m_Controllers[x]; }
+
+private:
+    CLEDController& addController(uint8_t pin, EOrder order);
+
+    CLEDController* m_Controllers[SIM_MAX_CONTROLLERS] = {};
+    int m_nControllers = 0;
+    uint8_t m_Scale = 255;
+};
+
+extern CFastLED FastLED;
+
+#endif // SIM_FASTLED_H
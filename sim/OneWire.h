@@ -0,0 +1,57 @@
+// =============================================================================
+// OneWire.h - Host stand-in for PJRC OneWire 2.3.x (native build only)
+// =============================================================================
+// Same public API and search algorithm as the real library. Bit slots are
+// delivered to the simulated bus in sim_onewire.cpp, which runs DS2431
+// device models and charges each reset/slot to the virtual clock.
+// =============================================================================
+
+#ifndef SIM_ONEWIRE_H
+#define SIM_ONEWIRE_H
+
+#include "Arduino.h"
+
+#define ONEWIRE_SEARCH 1
+#define ONEWIRE_CRC 1
+#define ONEWIRE_CRC16 1
+
+class OneWire {
+public:
+    OneWire() {}
+    OneWire(uint8_t pin) { begin(pin); }
+    void begin(uint8_t pin);
+
+    // Perform a 1-Wire reset cycle. Returns 1 if a device responds with a
+    // presence pulse.
+    uint8_t reset(void);
+
+    // Issue a 1-Wire rom select command.
+    void select(const uint8_t rom[8]);
+
+    // Issue a 1-Wire rom skip command.
+    void skip(void);
+
+    void write(uint8_t v, uint8_t power = 0);
+    void write_bytes(const uint8_t* buf, uint16_t count, bool power = 0);
+    uint8_t read(void);
+    void read_bytes(uint8_t* buf, uint16_t count);
+    void write_bit(uint8_t v);
+    uint8_t read_bit(void);
+    void depower(void) {}
+
+    void reset_search();
+    void target_search(uint8_t family_code);
+    bool search(uint8_t* newAddr, bool search_mode = true);
+
+    static uint8_t crc8(const uint8_t* addr, uint8_t len);
+    static bool check_crc16(const uint8_t* input, uint16_t len, const uint8_t* inverted_crc, uint16_t crc = 0);
+    static uint16_t crc16(const uint8_t* input, uint16_t len, uint16_t crc = 0);
+
+private:
+    unsigned char ROM_NO[8] = {};
+    uint8_t LastDiscrepancy = 0;
+    uint8_t LastFamilyDiscrepancy = 0;
+    bool LastDeviceFlag = false;
+};
+
+#endif // SIM_ONEWIRE_H
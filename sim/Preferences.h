@@ -0,0 +1,41 @@
+// =============================================================================
+// Preferences.h - Host stand-in for the Arduino-ESP32 NVS Preferences library
+// =============================================================================
+// Keys live in an in-memory map per namespace. With simNvsSetFile() the map
+// is loaded from and saved back to a file, so NVS contents survive between
+// runs like they survive a reboot on the device. Writes are counted and
+// charged to the virtual clock.
+// =============================================================================
+
+#ifndef SIM_PREFERENCES_H
+#define SIM_PREFERENCES_H
+
+#include "Arduino.h"
+
+#include <string>
+
+class Preferences {
+public:
+    bool begin(const char* name, bool readOnly = false, const char* partition_label = nullptr);
+    void end();
+
+    bool clear();
+    bool remove(const char* key);
+    bool isKey(const char* key);
+
+    size_t putUChar(const char* key, uint8_t value);
+    uint8_t getUChar(const char* key, uint8_t defaultValue = 0);
+
+    size_t putBytes(const char* key, const void* value, size_t len);
+    size_t getBytesLength(const char* key);
+    size_t getBytes(const char* key, void* buf, size_t maxLen);
+
+private:
+    std::string path(const char* key) const;
+
+    std::string ns_;
+    bool started_ = false;
+    bool readOnly_ = false;
+};
+
+#endif // SIM_PREFERENCES_H
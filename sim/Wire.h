@@ -0,0 +1,47 @@
+// =============================================================================
+// Wire.h - Host stand-in for the Arduino-ESP32 TwoWire driver (native build)
+// =============================================================================
+// Transactions are delivered to the simulated LIS3DH register file in
+// sim_lis3dh.cpp and charged to the virtual clock at the configured SCL rate.
+// =============================================================================
+
+#ifndef SIM_WIRE_H
+#define SIM_WIRE_H
+
+#include "Arduino.h"
+
+#define SIM_I2C_BUFFER_LENGTH 128
+
+class TwoWire : public Stream {
+public:
+    bool begin(int sda = -1, int scl = -1, uint32_t frequency = 0);
+    bool setClock(uint32_t frequency) { frequency_ = frequency; return true; }
+    uint32_t getClock() const { return frequency_; }
+
+    void beginTransmission(uint8_t address);
+    uint8_t endTransmission(bool sendStop = true);
+    uint8_t requestFrom(uint8_t address, uint8_t quantity, bool sendStop = true);
+
+    size_t write(uint8_t data) override;
+    size_t write(const uint8_t* data, size_t quantity) override;
+    int available() override;
+    int read() override;
+    int peek() override;
+    void flush() {}
+
+private:
+    void chargeBusTime(size_t bytes);
+
+    uint32_t frequency_ = 100000;
+    uint8_t txAddress_ = 0;
+    uint8_t txBuffer_[SIM_I2C_BUFFER_LENGTH];
+    size_t txLength_ = 0;
+    size_t pendingWrite_ = 0;           // Bytes (with address) before a repeated start
+    uint8_t rxBuffer_[SIM_I2C_BUFFER_LENGTH];
+    size_t rxLength_ = 0;
+    size_t rxIndex_ = 0;
+};
+
+extern TwoWire Wire;
+
+#endif // SIM_WIRE_H
@@ -0,0 +1,10 @@
+// =============================================================================
+// driver/gpio.h - Host stand-in for the ESP-IDF GPIO types (native build only)
+// =============================================================================
+
+#ifndef SIM_DRIVER_GPIO_H
+#define SIM_DRIVER_GPIO_H
+
+typedef int gpio_num_t;
+
+#endif // SIM_DRIVER_GPIO_H
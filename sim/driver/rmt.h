@@ -0,0 +1,100 @@
+// =============================================================================
+// driver/rmt.h - Host stand-in for the ESP-IDF 4.4 RMT TX driver (native build only)
+// =============================================================================
+// Only the transmit path used by the WS2812 output is modeled. A write runs
+// the channel's translator over the whole buffer, decodes the resulting
+// pulses back into bytes (high longer than low = 1) and latches them into the
+// simulated LED chain. The call returns at once; the channel stays busy for
+// the summed pulse durations plus the WS2812 latch, and rmt_wait_tx_done()
+// (or the next write) blocks until then, like the driver's TX-done semaphore.
+// =============================================================================
+
+#ifndef SIM_DRIVER_RMT_H
+#define SIM_DRIVER_RMT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "driver/gpio.h"
+#include "freertos/FreeRTOS.h"
+
+#define RMT_SIM_SOURCE_CLK_HZ 80000000   // APB clock
+
+typedef enum {
+    RMT_CHANNEL_0,
+    RMT_CHANNEL_1,
+    RMT_CHANNEL_2,
+    RMT_CHANNEL_3,
+    RMT_CHANNEL_MAX
+} rmt_channel_t;
+
+typedef enum {
+    RMT_MODE_TX,
+    RMT_MODE_RX
+} rmt_mode_t;
+
+typedef enum {
+    RMT_IDLE_LEVEL_LOW,
+    RMT_IDLE_LEVEL_HIGH
+} rmt_idle_level_t;
+
+typedef struct {
+    union {
+        struct {
+            uint32_t duration0 : 15;
+            uint32_t level0 : 1;
+            uint32_t duration1 : 15;
+            uint32_t level1 : 1;
+        };
+        uint32_t val;
+    };
+} rmt_item32_t;
+
+typedef struct {
+    uint32_t carrier_freq_hz;
+    bool loop_en;
+    bool carrier_en;
+    bool idle_output_en;
+    rmt_idle_level_t idle_level;
+} rmt_tx_config_t;
+
+typedef struct {
+    rmt_mode_t rmt_mode;
+    rmt_channel_t channel;
+    gpio_num_t gpio_num;
+    uint8_t clk_div;
+    uint8_t mem_block_num;
+    uint32_t flags;
+    rmt_tx_config_t tx_config;
+} rmt_config_t;
+
+#define RMT_DEFAULT_CONFIG_TX(gpio, channel_id) \
+    {                                           \
+        .rmt_mode = RMT_MODE_TX,                \
+        .channel = channel_id,                  \
+        .gpio_num = gpio,                       \
+        .clk_div = 80,                          \
+        .mem_block_num = 1,                     \
+        .flags = 0,                             \
+        .tx_config = {                          \
+            .carrier_freq_hz = 38000,           \
+            .loop_en = false,                   \
+            .carrier_en = false,                \
+            .idle_output_en = true,             \
+            .idle_level = RMT_IDLE_LEVEL_LOW,   \
+        }                                       \
+    }
+
+typedef void (*sample_to_rmt_t)(const void* src, rmt_item32_t* dest, size_t src_size,
+                                size_t wanted_num, size_t* translated_size, size_t* item_num);
+
+esp_err_t rmt_config(const rmt_config_t* config);
+esp_err_t rmt_driver_install(rmt_channel_t channel, size_t rx_buf_size, int intr_alloc_flags);
+esp_err_t rmt_driver_uninstall(rmt_channel_t channel);
+esp_err_t rmt_translator_init(rmt_channel_t channel, sample_to_rmt_t fn);
+esp_err_t rmt_get_counter_clock(rmt_channel_t channel, uint32_t* clock_hz);
+esp_err_t rmt_write_sample(rmt_channel_t channel, const uint8_t* src, size_t src_size, bool wait_tx_done);
+esp_err_t rmt_wait_tx_done(rmt_channel_t channel, TickType_t wait_time);
+
+#endif // SIM_DRIVER_RMT_H
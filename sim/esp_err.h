@@ -0,0 +1,16 @@
+// =============================================================================
+// esp_err.h - Host stand-in for the ESP-IDF error codes (native build only)
+// =============================================================================
+
+#ifndef SIM_ESP_ERR_H
+#define SIM_ESP_ERR_H
+
+typedef int esp_err_t;
+
+#define ESP_OK                  0
+#define ESP_FAIL                -1
+#define ESP_ERR_INVALID_ARG     0x102
+#define ESP_ERR_INVALID_STATE   0x103
+#define ESP_ERR_TIMEOUT         0x107
+
+#endif // SIM_ESP_ERR_H
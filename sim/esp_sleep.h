@@ -0,0 +1,38 @@
+// =============================================================================
+// esp_sleep.h - Host stand-in for the ESP-IDF sleep API (native build only)
+// =============================================================================
+// esp_deep_sleep_start() ends the simulation, since nothing after it runs on
+// the real chip either.
+// =============================================================================
+
+#ifndef SIM_ESP_SLEEP_H
+#define SIM_ESP_SLEEP_H
+
+#include <stdint.h>
+#include "esp_err.h"
+
+typedef enum {
+    ESP_SLEEP_WAKEUP_UNDEFINED,
+    ESP_SLEEP_WAKEUP_ALL,
+    ESP_SLEEP_WAKEUP_EXT0,
+    ESP_SLEEP_WAKEUP_EXT1,
+    ESP_SLEEP_WAKEUP_TIMER,
+    ESP_SLEEP_WAKEUP_TOUCHPAD,
+    ESP_SLEEP_WAKEUP_ULP,
+    ESP_SLEEP_WAKEUP_GPIO,
+    ESP_SLEEP_WAKEUP_UART
+} esp_sleep_source_t;
+
+typedef esp_sleep_source_t esp_sleep_wakeup_cause_t;
+
+typedef enum {
+    ESP_GPIO_WAKEUP_GPIO_LOW  = 0,
+    ESP_GPIO_WAKEUP_GPIO_HIGH = 1
+} esp_deepsleep_gpio_wake_up_mode_t;
+
+
+esp_sleep_wakeup_cause_t esp_sleep_get_wakeup_cause(void);
+esp_err_t esp_deep_sleep_enable_gpio_wakeup(uint64_t gpio_pin_mask, esp_deepsleep_gpio_wake_up_mode_t mode);
+void esp_deep_sleep_start(void);
+
+#endif // SIM_ESP_SLEEP_H
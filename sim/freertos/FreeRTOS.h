@@ -0,0 +1,28 @@
+// =============================================================================
+// freertos/FreeRTOS.h - Host stand-in for the ESP-IDF FreeRTOS kernel types
+// =============================================================================
+// Tasks run as coroutines on the virtual clock (see sim_freertos.cpp). The
+// model is the ESP32-C3's single core: a task created above loop()'s
+// priority preempts it as soon as it is ready, and runs until it blocks.
+// =============================================================================
+
+#ifndef SIM_FREERTOS_H
+#define SIM_FREERTOS_H
+
+#include <stdint.h>
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+
+#define configTICK_RATE_HZ  1000
+#define portTICK_PERIOD_MS  (1000 / configTICK_RATE_HZ)
+#define portMAX_DELAY       ((TickType_t)0xFFFFFFFF)
+#define pdMS_TO_TICKS(ms)   ((TickType_t)(((uint64_t)(ms) * configTICK_RATE_HZ) / 1000))
+#define pdTRUE              1
+#define pdFALSE             0
+#define pdPASS              pdTRUE
+#define pdFAIL              pdFALSE
+#define tskNO_AFFINITY      0x7FFFFFFF
+
+#endif // SIM_FREERTOS_H
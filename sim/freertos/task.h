@@ -0,0 +1,25 @@
+// =============================================================================
+// freertos/task.h - Host stand-in for the FreeRTOS task API (subset)
+// =============================================================================
+
+#ifndef SIM_FREERTOS_TASK_H
+#define SIM_FREERTOS_TASK_H
+
+#include "freertos/FreeRTOS.h"
+
+typedef void (*TaskFunction_t)(void*);
+typedef struct SimTask* TaskHandle_t;
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char* name, uint32_t stackDepth,
+                       void* param, UBaseType_t priority, TaskHandle_t* handle);
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char* name, uint32_t stackDepth,
+                                   void* param, UBaseType_t priority, TaskHandle_t* handle,
+                                   BaseType_t core);
+void vTaskDelete(TaskHandle_t task);
+void vTaskDelay(TickType_t ticks);
+void vTaskDelayUntil(TickType_t* previousWakeTime, TickType_t increment);
+void vTaskSuspend(TaskHandle_t task);
+void vTaskResume(TaskHandle_t task);
+TickType_t xTaskGetTickCount();
+
+#endif // SIM_FREERTOS_TASK_H
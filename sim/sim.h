@@ -0,0 +1,144 @@
+// =============================================================================
+// sim.h - Host simulation control for the LED Cube Hub (native build only)
+// =============================================================================
+// The stand-in headers in this directory (Arduino.h, FastLED.h, OneWire.h,
+// Wire.h, Adafruit_LIS3DH.h, Preferences.h, esp_sleep.h, freertos/,
+// driver/rmt.h) route all hardware access into the
+// models declared here. Everything runs on a virtual microsecond clock: bus
+// transactions, LED refreshes and delay() advance it by their modeled
+// duration, so scenarios run thousands of times faster than real time while
+// still reporting how much bus/CPU time the firmware would have spent.
+// =============================================================================
+
+#ifndef SIM_H
+#define SIM_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// =============================================================================
+// Virtual Clock
+// =============================================================================
+uint64_t simMicros();
+void simAdvanceMicros(uint32_t us);     // Busy time: ready tasks preempt it
+void simWaitUntil(uint64_t us);         // Blocked time (loop()): tasks overlap it
+void simPaceRealtime();                 // Sleep until wall time catches up
+
+// =============================================================================
+// Tasks (sim_freertos.cpp)
+// =============================================================================
+uint64_t simTaskNextWakeUs();   // Earliest wake of a runnable task (none: max)
+void simTaskRunReady();         // Switch to every task that is due
+void simTaskBlockUntil(uint64_t us);    // Block the caller (task or loop()) until 'us'
+
+// =============================================================================
+// Bus / Output Accounting
+// =============================================================================
+struct SimStats {
+    uint64_t loopPasses;
+    uint32_t maxLoopUs;         // Longest single loop() pass (after setup)
+    uint64_t oneWireBusyUs;     // Time the 1-Wire bus was driven
+    uint32_t oneWireResets;
+    uint64_t i2cBusyUs;         // Time the I2C bus was driven
+    uint32_t i2cTransactions;
+    uint64_t ledBusyUs;         // Time spent clocking out WS2812 data
+    uint32_t ledShows;
+    uint64_t taskBusyUs;        // Time tasks held the CPU (preempting loop())
+    uint64_t frameGapFromUs;    // Show intervals are counted from here (after setup)
+    uint32_t frameGaps;
+    uint32_t maxFrameGapUs;     // Longest time between two shows
+    double frameGapSumUs;       // For the mean / jitter of the show interval
+    double frameGapSqSumUs;
+    uint64_t delayUs;           // Time spent inside delay()/delayMicroseconds()
+    uint32_t nvsWrites;         // Preferences puts/removes (flash wear)
+    uint64_t nvsBytes;
+};
+
+extern SimStats simStats;
+
+void simResetStats();
+void simPrintStats(uint64_t wallUs);
+
+// =============================================================================
+// GPIO
+// =============================================================================
+// Drive an input pin from the outside world; fires attached ISRs on edges.
+void simGpioSet(uint8_t pin, int level);
+int  simGpioGet(uint8_t pin);
+
+// =============================================================================
+// Serial
+// =============================================================================
+void simSerialInject(const char* text);  // Queue bytes as if typed by the host
+void simSerialSetEcho(bool enabled);     // Print firmware output to stdout
+void simPollInput();                     // Pull pending bytes from stdin (and the pty)
+const char* simSerialOpenPty();          // Serial on a new pty; returns its path
+void simSerialStallTx(uint32_t ms);      // availableForWrite() is 0 for that long
+
+// =============================================================================
+// 1-Wire Bus (DS2431 devices)
+// =============================================================================
+#define SIM_DS2431_MEM_SIZE 144          // 128 bytes EEPROM + 16 bytes registers
+
+// Attach a DS2431 with the given 48-bit serial; family and CRC are filled in.
+// 'image' may be NULL (blank, all 0xFF) or point to SIM_DS2431_MEM_SIZE bytes.
+uint64_t simOneWireAttach(uint64_t serial, const uint8_t* image);
+void simOneWireDetach(uint64_t romId);
+int  simOneWireDeviceCount();
+uint64_t simOneWireRomAt(int index);
+uint8_t* simOneWireMemory(uint64_t romId);
+
+// Devices attached after this call do (default) or do not support overdrive.
+void simOneWireSetOverdriveCapable(bool capable);
+
+// Overdrive-speed reset and slots (the PJRC library only does standard speed)
+uint8_t simOneWireResetOverdrive();
+void simOneWireWriteBitOverdrive(uint8_t v);
+uint8_t simOneWireReadBitOverdrive();
+
+// =============================================================================
+// NVS (Preferences)
+// =============================================================================
+// Load NVS contents from 'path' and save them back on every write, so a
+// second run starts with what the first one stored. Without it NVS starts
+// empty every run.
+void simNvsSetFile(const char* path);
+
+// =============================================================================
+// LIS3DH Model
+// =============================================================================
+void simLis3dhSetPresent(bool present);
+void simLis3dhSetInterruptPins(uint8_t int1Pin, uint8_t int2Pin);
+void simLis3dhSetAccelMg(int16_t x, int16_t y, int16_t z);
+void simLis3dhTap(bool doubleTap);
+void simLis3dhTick();                   // Advance the FIFO / watermark to now (each loop pass)
+
+// =============================================================================
+// LEDs
+// =============================================================================
+// WS2812 wire timing: 24 bits at 1.25 us, then a >= 50 us latch.
+#define SIM_WS2812_US_PER_LED  30
+#define SIM_WS2812_LATCH_US    50
+
+// Pixels last sent on a data pin (after global brightness), RGB order.
+const uint8_t* simLedWire(uint8_t pin, int* count);
+
+// Shared by the FastLED and RMT stand-ins: a frame starts going out now
+// (frame-interval stats), and the bytes the WS2812 chain on 'pin' received,
+// GRB order.
+void simLedFrameStarted();
+void simLedWireLatch(uint8_t pin, const uint8_t* grb, size_t len);
+
+// =============================================================================
+// Sleep
+// =============================================================================
+void simSetWakeupCause(int cause);
+
+// Save RTC_DATA_ATTR memory to 'path' on deep sleep; with 'restore', load it
+// now (call before setup(), for a run that starts as a wake from sleep).
+void simRtcSetFile(const char* path, bool restore);
+
+// End the run (deep sleep, restart): prints stats and exits the process.
+void simExit(const char* reason);
+
+#endif // SIM_H
@@ -0,0 +1,452 @@
+// =============================================================================
+// sim_arduino.cpp - Arduino core stand-in: clock, GPIO, Serial, String
+// =============================================================================
+
+#include "Arduino.h"
+#include "sim.h"
+
+#include <chrono>
+#include <deque>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+
+// =============================================================================
+// Virtual Clock
+// =============================================================================
+static uint64_t simNowUs = 0;
+static std::chrono::steady_clock::time_point wallStart = std::chrono::steady_clock::now();
+SimStats simStats;
+
+uint64_t simMicros() {
+    return simNowUs;
+}
+
+void simAdvanceMicros(uint32_t us) {
+    // A task that comes due part way through runs then; the rest of the busy
+    // work finishes after it
+    uint64_t remaining = us;
+    for (;;) {
+        uint64_t due = simTaskNextWakeUs();
+        if (due > simNowUs + remaining) break;
+        if (due > simNowUs) {
+            remaining -= due - simNowUs;
+            simNowUs = due;
+        }
+        simTaskRunReady();
+    }
+    simNowUs += remaining;
+}
+
+uint32_t millis() {
+    return (uint32_t)(simNowUs / 1000);
+}
+
+uint32_t micros() {
+    return (uint32_t)simNowUs;
+}
+
+// Blocks the caller: tasks run on time and their time overlaps the wait
+void simWaitUntil(uint64_t target) {
+    for (;;) {
+        uint64_t due = simTaskNextWakeUs();
+        if (due >= target) break;
+        if (due > simNowUs) simNowUs = due;
+        simTaskRunReady();
+    }
+    if (simNowUs < target) simNowUs = target;
+}
+
+void delay(uint32_t ms) {
+    simStats.delayUs += (uint64_t)ms * 1000;
+    simWaitUntil(simNowUs + (uint64_t)ms * 1000);
+}
+
+// Busy-waits, like the real core
+void delayMicroseconds(uint32_t us) {
+    simStats.delayUs += us;
+    simAdvanceMicros(us);
+}
+
+void yield() {
+}
+
+void simPaceRealtime() {
+    uint64_t wallUs = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - wallStart).count();
+    if (simNowUs > wallUs + 1000) usleep((useconds_t)(simNowUs - wallUs));
+}
+
+void simResetStats() {
+    memset(&simStats, 0, sizeof(simStats));
+    wallStart = std::chrono::steady_clock::now();
+}
+
+void simExit(const char* reason) {
+    fflush(stdout);
+    uint64_t wallUs = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - wallStart).count();
+    fprintf(stderr, "\nsim: %s at %.1f ms\n", reason, simNowUs / 1000.0);
+    simPrintStats(wallUs);
+    exit(0);
+}
+
+void simPrintStats(uint64_t wallUs) {
+    double simMs = simNowUs / 1000.0;
+    double wallMs = wallUs / 1000.0;
+    fprintf(stderr, "\n=== Simulation Stats ===\n");
+    fprintf(stderr, "Simulated time:   %.1f ms\n", simMs);
+    fprintf(stderr, "Wall time:        %.1f ms", wallMs);
+    if (wallUs > 0) fprintf(stderr, " (%.0fx real time)", simMs / wallMs);
+    fprintf(stderr, "\n");
+    fprintf(stderr, "Loop passes:      %llu\n", (unsigned long long)simStats.loopPasses);
+    fprintf(stderr, "Longest loop():   %.2f ms\n", simStats.maxLoopUs / 1000.0);
+    fprintf(stderr, "1-Wire busy:      %.1f ms (%u resets)\n",
+            simStats.oneWireBusyUs / 1000.0, simStats.oneWireResets);
+    fprintf(stderr, "I2C busy:         %.1f ms (%u transactions)\n",
+            simStats.i2cBusyUs / 1000.0, simStats.i2cTransactions);
+    fprintf(stderr, "LED output busy:  %.1f ms (%u shows)\n",
+            simStats.ledBusyUs / 1000.0, simStats.ledShows);
+    fprintf(stderr, "Task CPU:         %.1f ms\n", simStats.taskBusyUs / 1000.0);
+    if (simStats.frameGaps > 0) {
+        double n = simStats.frameGaps;
+        double mean = simStats.frameGapSumUs / n;
+        double var = simStats.frameGapSqSumUs / n - mean * mean;
+        fprintf(stderr, "Frame interval:   %.2f ms mean, %.2f ms jitter (sd), %.2f ms max\n",
+                mean / 1000.0, sqrt(var > 0 ? var : 0) / 1000.0, simStats.maxFrameGapUs / 1000.0);
+    }
+    fprintf(stderr, "delay():          %.1f ms\n", simStats.delayUs / 1000.0);
+    fprintf(stderr, "NVS writes:       %u (%llu bytes)\n",
+            simStats.nvsWrites, (unsigned long long)simStats.nvsBytes);
+}
+
+// =============================================================================
+// GPIO
+// =============================================================================
+static int gpioLevel[SIM_GPIO_COUNT];
+static void (*gpioIsr[SIM_GPIO_COUNT])(void);
+static int gpioIsrMode[SIM_GPIO_COUNT];
+
+void pinMode(uint8_t pin, uint8_t mode) {
+    (void)pin;
+    (void)mode;
+}
+
+int digitalRead(uint8_t pin) {
+    return pin < SIM_GPIO_COUNT ? gpioLevel[pin] : LOW;
+}
+
+void digitalWrite(uint8_t pin, uint8_t val) {
+    if (pin < SIM_GPIO_COUNT) gpioLevel[pin] = val ? HIGH : LOW;
+}
+
+void attachInterrupt(uint8_t pin, void (*isr)(void), int mode) {
+    if (pin >= SIM_GPIO_COUNT) return;
+    gpioIsr[pin] = isr;
+    gpioIsrMode[pin] = mode;
+}
+
+void detachInterrupt(uint8_t pin) {
+    if (pin < SIM_GPIO_COUNT) gpioIsr[pin] = nullptr;
+}
+
+void simGpioSet(uint8_t pin, int level) {
+    if (pin >= SIM_GPIO_COUNT) return;
+    int old = gpioLevel[pin];
+    gpioLevel[pin] = level ? HIGH : LOW;
+    if (!gpioIsr[pin] || old == gpioLevel[pin]) return;
+
+    bool rising = (gpioLevel[pin] == HIGH);
+    int mode = gpioIsrMode[pin];
+    if (mode == CHANGE || (mode == RISING && rising) || (mode == FALLING && !rising)) {
+        gpioIsr[pin]();
+    }
+}
+
+int simGpioGet(uint8_t pin) {
+    return digitalRead(pin);
+}
+
+// =============================================================================
+// Random
+// =============================================================================
+long random(long howbig) {
+    if (howbig <= 0) return 0;
+    return rand() % howbig;
+}
+
+long random(long howsmall, long howbig) {
+    if (howsmall >= howbig) return howsmall;
+    return howsmall + random(howbig - howsmall);
+}
+
+void randomSeed(unsigned long seed) {
+    srand(seed);
+}
+
+// =============================================================================
+// String
+// =============================================================================
+void String::trim() {
+    size_t begin = 0;
+    size_t end = s_.length();
+    while (begin < end && isspace((unsigned char)s_[begin])) begin++;
+    while (end > begin && isspace((unsigned char)s_[end - 1])) end--;
+    s_ = s_.substr(begin, end - begin);
+}
+
+bool String::startsWith(const char* prefix) const {
+    return s_.compare(0, strlen(prefix), prefix) == 0;
+}
+
+String String::substring(unsigned int from) const {
+    return substring(from, s_.length());
+}
+
+String String::substring(unsigned int from, unsigned int to) const {
+    if (from > to) { unsigned int t = from; from = to; to = t; }
+    if (from >= s_.length()) return String();
+    if (to > s_.length()) to = s_.length();
+    return String(s_.substr(from, to - from));
+}
+
+// =============================================================================
+// Print
+// =============================================================================
+size_t Print::write(const uint8_t* buf, size_t len) {
+    size_t n = 0;
+    while (len--) n += write(*buf++);
+    return n;
+}
+
+size_t Print::print(const __FlashStringHelper* s) {
+    return print(reinterpret_cast<const char*>(s));
+}
+
+size_t Print::print(const String& s) {
+    return write((const uint8_t*)s.c_str(), s.length());
+}
+
+size_t Print::print(const char* s) {
+    return write(s);
+}
+
+size_t Print::print(char c) {
+    return write((uint8_t)c);
+}
+
+size_t Print::print(unsigned char n, int base) {
+    return print((unsigned long)n, base);
+}
+
+size_t Print::print(int n, int base) {
+    return print((long)n, base);
+}
+
+size_t Print::print(unsigned int n, int base) {
+    return print((unsigned long)n, base);
+}
+
+size_t Print::print(long n, int base) {
+    return print((long long)n, base);
+}
+
+size_t Print::print(unsigned long n, int base) {
+    return print((unsigned long long)n, base);
+}
+
+size_t Print::print(long long n, int base) {
+    if (base == DEC && n < 0) {
+        return print('-') + printNumber((unsigned long long)(-n), DEC);
+    }
+    return printNumber((unsigned long long)n, base);
+}
+
+size_t Print::print(unsigned long long n, int base) {
+    return printNumber(n, base);
+}
+
+size_t Print::print(double n, int digits) {
+    char buf[48];
+    snprintf(buf, sizeof(buf), "%.*f", digits, n);
+    return print(buf);
+}
+
+size_t Print::println() {
+    return write((const uint8_t*)"\r\n", 2);
+}
+
+size_t Print::printNumber(unsigned long long n, uint8_t base) {
+    char buf[8 * sizeof(n) + 1];
+    char* str = &buf[sizeof(buf) - 1];
+    *str = '\0';
+    if (base < 2) base = 10;
+    do {
+        char c = n % base;
+        n /= base;
+        *--str = c < 10 ? c + '0' : c + 'A' - 10;
+    } while (n);
+    return write(str);
+}
+
+// =============================================================================
+// Stream
+// =============================================================================
+int Stream::timedRead() {
+    uint32_t start = millis();
+    do {
+        int c = read();
+        if (c >= 0) return c;
+        // Nothing buffered: the real core spins here until the timeout.
+        simPollInput();
+        if (available()) continue;
+        delay(1);
+    } while (millis() - start < timeout_);
+    return -1;
+}
+
+String Stream::readStringUntil(char terminator) {
+    String ret;
+    int c = timedRead();
+    while (c >= 0 && c != terminator) {
+        ret += (char)c;
+        c = timedRead();
+    }
+    return ret;
+}
+
+size_t Stream::readBytes(uint8_t* buf, size_t len) {
+    size_t count = 0;
+    while (count < len) {
+        int c = timedRead();
+        if (c < 0) break;
+        buf[count++] = (uint8_t)c;
+    }
+    return count;
+}
+
+// =============================================================================
+// Serial
+// =============================================================================
+SimSerial Serial;
+
+static std::deque<uint8_t> serialRx;
+static bool serialEcho = true;
+static bool stdinOpen = true;
+static int ptyFd = -1;          // Master side of the --pty port
+static uint64_t txStallUntilUs = 0;
+
+void simSerialInject(const char* text) {
+    while (*text) serialRx.push_back((uint8_t)*text++);
+}
+
+void simSerialSetEcho(bool enabled) {
+    serialEcho = enabled;
+}
+
+// Host tools open the returned path like the board's /dev/ttyACM0. The slave
+// side stays open here too, so it keeps its raw mode and the master does not
+// see a hangup between clients.
+const char* simSerialOpenPty() {
+    int fd = posix_openpt(O_RDWR | O_NOCTTY);
+    if (fd < 0 || grantpt(fd) != 0 || unlockpt(fd) != 0) return nullptr;
+    const char* path = ptsname(fd);
+    int slave = path ? open(path, O_RDWR | O_NOCTTY) : -1;
+    if (slave < 0) return nullptr;
+    struct termios t;
+    tcgetattr(slave, &t);
+    cfmakeraw(&t);
+    tcsetattr(slave, TCSANOW, &t);
+    fcntl(fd, F_SETFL, O_NONBLOCK);
+    ptyFd = fd;
+    return path;
+}
+
+static void ptyWrite(const uint8_t* buf, size_t len) {
+    // A client that is not reading loses output, like an unopened CDC port
+    if (ptyFd >= 0 && ::write(ptyFd, buf, len) < 0) return;
+}
+
+void simPollInput() {
+    if (ptyFd >= 0) {
+        uint8_t buf[4096];
+        ssize_t n;
+        while ((n = ::read(ptyFd, buf, sizeof(buf))) > 0) {
+            serialRx.insert(serialRx.end(), buf, buf + n);
+        }
+    }
+    if (!stdinOpen) return;
+    struct pollfd pfd = { STDIN_FILENO, POLLIN, 0 };
+    while (poll(&pfd, 1, 0) > 0 && (pfd.revents & (POLLIN | POLLHUP))) {
+        uint8_t buf[256];
+        ssize_t n = ::read(STDIN_FILENO, buf, sizeof(buf));
+        if (n <= 0) {
+            stdinOpen = false;
+            return;
+        }
+        for (ssize_t i = 0; i < n; i++) serialRx.push_back(buf[i]);
+    }
+}
+
+void simSerialStallTx(uint32_t ms) {
+    txStallUntilUs = simMicros() + (uint64_t)ms * 1000;
+}
+
+int SimSerial::available() {
+    return (int)serialRx.size();
+}
+
+int SimSerial::read() {
+    if (serialRx.empty()) return -1;
+    uint8_t c = serialRx.front();
+    serialRx.pop_front();
+    return c;
+}
+
+int SimSerial::peek() {
+    return serialRx.empty() ? -1 : serialRx.front();
+}
+
+// Free space in the USB CDC TX buffer; 0 while the host is not reading
+int SimSerial::availableForWrite() {
+    return simMicros() < txStallUntilUs ? 0 : 64;
+}
+
+size_t SimSerial::write(uint8_t c) {
+    ptyWrite(&c, 1);
+    if (serialEcho && c != '\r') fputc(c, stdout);
+    return 1;
+}
+
+size_t SimSerial::write(const uint8_t* buf, size_t len) {
+    ptyWrite(buf, len);
+    if (serialEcho) {
+        for (size_t i = 0; i < len; i++) {
+            if (buf[i] != '\r') fputc(buf[i], stdout);
+        }
+    }
+    return len;
+}
+
+void SimSerial::flush() {
+    fflush(stdout);
+}
+
+// =============================================================================
+// ESP
+// =============================================================================
+EspClass ESP;
+
+uint32_t EspClass::getFreeHeap() {
+    return 280000;
+}
+
+uint32_t EspClass::getCycleCount() {
+    return (uint32_t)(simNowUs * getCpuFreqMHz());
+}
+
+void EspClass::restart() {
+    fflush(stdout);
+    exit(0);
+}
@@ -0,0 +1,62 @@
+// =============================================================================
+// sim_esp_sleep.cpp - ESP-IDF sleep API stand-in
+// =============================================================================
+// RTC_DATA_ATTR variables are collected in the "rtc_data" section. With an
+// RTC file, deep sleep writes that section out and a run started with a
+// wake cause reads it back before setup(), like RTC slow memory surviving
+// deep sleep while everything else is reset.
+// =============================================================================
+
+#include "esp_sleep.h"
+#include "sim.h"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+static esp_sleep_wakeup_cause_t wakeupCause = ESP_SLEEP_WAKEUP_UNDEFINED;
+static std::string rtcFile;
+
+// Linker-provided bounds of the section (null when nothing is retained)
+extern char __start_rtc_data[] __attribute__((weak));
+extern char __stop_rtc_data[] __attribute__((weak));
+
+static size_t rtcSize() {
+    return (__start_rtc_data && __stop_rtc_data) ? (size_t)(__stop_rtc_data - __start_rtc_data) : 0;
+}
+
+void simRtcSetFile(const char* path, bool restore) {
+    rtcFile = path;
+    if (!restore || !rtcSize()) return;
+    FILE* f = fopen(path, "rb");
+    if (!f) return;
+    if (fread(__start_rtc_data, 1, rtcSize(), f) != rtcSize()) {
+        memset(__start_rtc_data, 0, rtcSize());     // Different build: start clean
+    }
+    fclose(f);
+}
+
+void simSetWakeupCause(int cause) {
+    wakeupCause = (esp_sleep_wakeup_cause_t)cause;
+}
+
+esp_sleep_wakeup_cause_t esp_sleep_get_wakeup_cause(void) {
+    return wakeupCause;
+}
+
+esp_err_t esp_deep_sleep_enable_gpio_wakeup(uint64_t gpio_pin_mask, esp_deepsleep_gpio_wake_up_mode_t mode) {
+    (void)gpio_pin_mask;
+    (void)mode;
+    return ESP_OK;
+}
+
+void esp_deep_sleep_start(void) {
+    if (!rtcFile.empty() && rtcSize()) {
+        FILE* f = fopen(rtcFile.c_str(), "wb");
+        if (f) {
+            fwrite(__start_rtc_data, 1, rtcSize(), f);
+            fclose(f);
+        }
+    }
+    simExit("deep sleep");
+}
@@ -0,0 +1,258 @@
+// =============================================================================
+// sim_fastled.cpp - FastLED stand-in: color math and simulated WS2812 output
+// =============================================================================
+
+#include "FastLED.h"
+#include "sim.h"
+
+#include <map>
+#include <vector>
+
+CFastLED FastLED;
+uint16_t rand16seed = 1337;
+
+// =============================================================================
+// trig8.h
+// =============================================================================
+static const uint8_t b_m16_interleave[] = { 0, 49, 49, 41, 90, 27, 117, 10 };
+
+uint8_t sin8(uint8_t theta) {
+    uint8_t offset = theta;
+    if (theta & 0x40) {
+        offset = (uint8_t)255 - offset;
+    }
+    offset &= 0x3F;
+
+    uint8_t secoffset = offset & 0x0F;
+    if (theta & 0x40) ++secoffset;
+
+    uint8_t section = offset >> 4;
+    uint8_t s2 = section * 2;
+    const uint8_t* p = b_m16_interleave;
+    p += s2;
+    uint8_t b = *p;
+    ++p;
+    uint8_t m16 = *p;
+
+    uint8_t mx = (m16 * secoffset) >> 4;
+
+    int8_t y = mx + b;
+    if (theta & 0x80) y = -y;
+
+    y += 128;
+
+    return y;
+}
+
+// =============================================================================
+// hsv2rgb.cpp (rainbow spectrum, Y1 yellow boost, no green scaling)
+// =============================================================================
+#define K255 255
+#define K171 171
+#define K170 170
+#define K85  85
+
+void hsv2rgb_rainbow(const CHSV& hsv, CRGB& rgb) {
+    uint8_t hue = hsv.hue;
+    uint8_t sat = hsv.sat;
+    uint8_t val = hsv.val;
+
+    uint8_t offset = hue & 0x1F;
+    uint8_t offset8 = offset << 3;
+    uint8_t third = scale8(offset8, (256 / 3));
+
+    uint8_t r, g, b;
+
+    if (!(hue & 0x80)) {
+        if (!(hue & 0x40)) {
+            if (!(hue & 0x20)) {
+                // R -> O
+                r = K255 - third;
+                g = third;
+                b = 0;
+            } else {
+                // O -> Y
+                r = K171;
+                g = K85 + third;
+                b = 0;
+            }
+        } else {
+            if (!(hue & 0x20)) {
+                // Y -> G
+                uint8_t twothirds = scale8(offset8, ((256 * 2) / 3));
+                r = K171 - twothirds;
+                g = K170 + third;
+                b = 0;
+            } else {
+                // G -> A
+                r = 0;
+                g = K255 - third;
+                b = third;
+            }
+        }
+    } else {
+        if (!(hue & 0x40)) {
+            if (!(hue & 0x20)) {
+                // A -> B
+                r = 0;
+                uint8_t twothirds = scale8(offset8, ((256 * 2) / 3));
+                g = K171 - twothirds;
+                b = K85 + twothirds;
+            } else {
+                // B -> P
+                r = third;
+                g = 0;
+                b = K255 - third;
+            }
+        } else {
+            if (!(hue & 0x20)) {
+                // P -> K
+                r = K85 + third;
+                g = 0;
+                b = K171 - third;
+            } else {
+                // K -> R
+                r = K170 + third;
+                g = 0;
+                b = K85 - third;
+            }
+        }
+    }
+
+    if (sat != 255) {
+        if (sat == 0) {
+            r = 255; b = 255; g = 255;
+        } else {
+            uint8_t desat = 255 - sat;
+            desat = scale8_video(desat, desat);
+
+            uint8_t satscale = 255 - desat;
+            r = scale8(r, satscale);
+            g = scale8(g, satscale);
+            b = scale8(b, satscale);
+
+            uint8_t brightness_floor = desat;
+            r += brightness_floor;
+            g += brightness_floor;
+            b += brightness_floor;
+        }
+    }
+
+    if (val != 255) {
+        val = scale8_video(val, val);
+        if (val == 0) {
+            r = 0; g = 0; b = 0;
+        } else {
+            r = scale8(r, val);
+            g = scale8(g, val);
+            b = scale8(b, val);
+        }
+    }
+
+    rgb.r = r;
+    rgb.g = g;
+    rgb.b = b;
+}
+
+// =============================================================================
+// colorutils.cpp
+// =============================================================================
+void fill_solid(struct CRGB* leds, int numToFill, const struct CRGB& color) {
+    for (int i = 0; i < numToFill; ++i) {
+        leds[i] = color;
+    }
+}
+
+void nscale8(CRGB* leds, uint16_t num_leds, uint8_t scale) {
+    for (uint16_t i = 0; i < num_leds; ++i) {
+        leds[i].nscale8(scale);
+    }
+}
+
+void fadeToBlackBy(CRGB* leds, uint16_t num_leds, uint8_t fadeBy) {
+    nscale8(leds, num_leds, 255 - fadeBy);
+}
+
+// =============================================================================
+// Simulated Output
+// =============================================================================
+// Last frame per data pin as it would appear on the wire, RGB order, with
+// global brightness applied (temporal dithering is not modeled).
+static std::map<uint8_t, std::vector<uint8_t>> wireFrames;
+
+void CLEDController::showLeds(uint8_t brightness) {
+    if (!m_Data) return;
+
+    std::vector<uint8_t>& wire = wireFrames[m_pin];
+    wire.resize(m_nLeds * 3);
+    for (int i = 0; i < m_nLeds; i++) {
+        wire[i * 3 + 0] = scale8(m_Data[i].r, brightness);
+        wire[i * 3 + 1] = scale8(m_Data[i].g, brightness);
+        wire[i * 3 + 2] = scale8(m_Data[i].b, brightness);
+    }
+
+    uint32_t us = m_nLeds * SIM_WS2812_US_PER_LED + SIM_WS2812_LATCH_US;
+    simStats.ledBusyUs += us;
+    simAdvanceMicros(us);
+}
+
+CLEDController& CFastLED::addController(uint8_t pin, EOrder order) {
+    if (m_nControllers >= SIM_MAX_CONTROLLERS) {
+        fprintf(stderr, "sim: too many LED controllers\n");
+        abort();
+    }
+    CLEDController* c = new CLEDController(pin, order);
+    m_Controllers[m_nControllers++] = c;
+    return *c;
+}
+
+void CFastLED::show(uint8_t scale) {
+    simLedFrameStarted();
+    for (int i = 0; i < m_nControllers; i++) {
+        m_Controllers[i]->showLeds(scale);
+    }
+    simStats.ledShows++;
+}
+
+void CFastLED::clear(bool writeData) {
+    for (int i = 0; i < m_nControllers; i++) {
+        m_Controllers[i]->clearLedData();
+    }
+    if (writeData) show(0);
+}
+
+void simLedFrameStarted() {
+    // Interval between the starts of consecutive frames
+    static uint64_t lastShowUs = 0;
+    uint64_t now = simMicros();
+    if (simStats.ledShows > 0 && lastShowUs >= simStats.frameGapFromUs) {
+        uint32_t gap = (uint32_t)(now - lastShowUs);
+        simStats.frameGaps++;
+        if (gap > simStats.maxFrameGapUs) simStats.maxFrameGapUs = gap;
+        simStats.frameGapSumUs += gap;
+        simStats.frameGapSqSumUs += (double)gap * gap;
+    }
+    lastShowUs = now;
+}
+
+// A shorter frame than the last leaves the LEDs past its end as they were
+void simLedWireLatch(uint8_t pin, const uint8_t* grb, size_t len) {
+    size_t count = len / 3;
+    std::vector<uint8_t>& wire = wireFrames[pin];
+    if (wire.size() < count * 3) wire.resize(count * 3);
+    for (size_t i = 0; i < count; i++) {
+        wire[i * 3 + 0] = grb[i * 3 + 1];
+        wire[i * 3 + 1] = grb[i * 3 + 0];
+        wire[i * 3 + 2] = grb[i * 3 + 2];
+    }
+}
+
+const uint8_t* simLedWire(uint8_t pin, int* count) {
+    auto it = wireFrames.find(pin);
+    if (it == wireFrames.end()) {
+        if (count) *count = 0;
+        return nullptr;
+    }
+    if (count) *count = (int)(it->second.size() / 3);
+    return it->second.data();
+}
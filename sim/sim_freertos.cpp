@@ -0,0 +1,163 @@
+// =============================================================================
+// sim_freertos.cpp - FreeRTOS task stand-in: coroutines on the virtual clock
+// =============================================================================
+// Each task gets its own ucontext stack. loop() is the lowest-priority
+// context; whenever the virtual clock moves (busy work in simAdvanceMicros()
+// or a blocking delay()), any task whose wake time has come is switched to
+// and runs until it blocks again in vTaskDelay*() or vTaskSuspend(). Time
+// spent in the task is added to the clock, so it shows up as preemption of
+// whatever loop() was doing - the single-core ESP32-C3 behaves the same way.
+// =============================================================================
+
+#include "Arduino.h"
+#include "sim.h"
+
+#include <ucontext.h>
+#include <vector>
+
+#define SIM_TASK_STACK_BYTES (256 * 1024)   // Host stack, not the requested depth
+
+struct SimTask {
+    ucontext_t context;
+    std::vector<uint8_t> stack;
+    TaskFunction_t fn;
+    void* param;
+    UBaseType_t priority;
+    uint64_t wakeUs;
+    bool suspended;
+    bool deleted;
+};
+
+static std::vector<SimTask*> tasks;
+static SimTask* currentTask = nullptr;      // nullptr: loop() is running
+static ucontext_t mainContext;
+
+static void taskEntry() {
+    currentTask->fn(currentTask->param);
+    // Returning from a task function is an error in FreeRTOS; treat as delete
+    vTaskDelete(nullptr);
+}
+
+// Give the CPU back to loop()
+static void taskBlock() {
+    SimTask* self = currentTask;
+    currentTask = nullptr;
+    swapcontext(&self->context, &mainContext);
+}
+
+static bool taskReady(const SimTask* t) {
+    return !t->deleted && !t->suspended && t->wakeUs <= simMicros();
+}
+
+uint64_t simTaskNextWakeUs() {
+    if (currentTask) return UINT64_MAX;     // Tasks are not preempted here
+    uint64_t next = UINT64_MAX;
+    for (SimTask* t : tasks) {
+        if (!t->deleted && !t->suspended && t->wakeUs < next) next = t->wakeUs;
+    }
+    return next;
+}
+
+void simTaskRunReady() {
+    if (currentTask) return;
+    // Highest priority first; each ready task runs until it blocks
+    for (;;) {
+        SimTask* best = nullptr;
+        for (SimTask* t : tasks) {
+            if (taskReady(t) && (!best || t->priority > best->priority)) best = t;
+        }
+        if (!best) return;
+        currentTask = best;
+        uint64_t start = simMicros();
+        swapcontext(&mainContext, &best->context);
+        simStats.taskBusyUs += simMicros() - start;
+    }
+}
+
+void simTaskBlockUntil(uint64_t us) {
+    if (us <= simMicros()) return;
+    if (!currentTask) {
+        simWaitUntil(us);
+        return;
+    }
+    currentTask->wakeUs = us;
+    taskBlock();
+}
+
+// =============================================================================
+// Task API
+// =============================================================================
+BaseType_t xTaskCreate(TaskFunction_t fn, const char* name, uint32_t stackDepth,
+                       void* param, UBaseType_t priority, TaskHandle_t* handle) {
+    (void)name;
+    (void)stackDepth;
+    SimTask* t = new SimTask();
+    t->fn = fn;
+    t->param = param;
+    t->priority = priority;
+    t->wakeUs = simMicros();
+    t->stack.resize(SIM_TASK_STACK_BYTES);
+
+    getcontext(&t->context);
+    t->context.uc_stack.ss_sp = t->stack.data();
+    t->context.uc_stack.ss_size = t->stack.size();
+    t->context.uc_link = nullptr;
+    makecontext(&t->context, taskEntry, 0);
+
+    tasks.push_back(t);
+    if (handle) *handle = t;
+
+    // A task created above loop()'s priority runs before xTaskCreate returns
+    simTaskRunReady();
+    return pdPASS;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char* name, uint32_t stackDepth,
+                                   void* param, UBaseType_t priority, TaskHandle_t* handle,
+                                   BaseType_t core) {
+    (void)core;
+    return xTaskCreate(fn, name, stackDepth, param, priority, handle);
+}
+
+void vTaskDelete(TaskHandle_t task) {
+    SimTask* t = task ? task : currentTask;
+    if (!t) return;
+    t->deleted = true;
+    if (t == currentTask) taskBlock();      // Never resumed
+}
+
+void vTaskDelay(TickType_t ticks) {
+    if (!currentTask) {
+        delay(ticks * portTICK_PERIOD_MS);
+        return;
+    }
+    currentTask->wakeUs = simMicros() + (uint64_t)ticks * portTICK_PERIOD_MS * 1000;
+    taskBlock();
+}
+
+void vTaskDelayUntil(TickType_t* previousWakeTime, TickType_t increment) {
+    *previousWakeTime += increment;
+    uint64_t wakeUs = (uint64_t)*previousWakeTime * portTICK_PERIOD_MS * 1000;
+    // Already late: FreeRTOS returns without blocking
+    if (!currentTask || wakeUs <= simMicros()) return;
+    currentTask->wakeUs = wakeUs;
+    taskBlock();
+}
+
+void vTaskSuspend(TaskHandle_t task) {
+    SimTask* t = task ? task : currentTask;
+    if (!t) return;
+    t->suspended = true;
+    if (t == currentTask) taskBlock();
+}
+
+void vTaskResume(TaskHandle_t task) {
+    if (!task || !task->suspended) return;
+    task->suspended = false;
+    task->wakeUs = simMicros();
+    simTaskRunReady();
+}
+
+TickType_t xTaskGetTickCount() {
+    return (TickType_t)(simMicros() / (portTICK_PERIOD_MS * 1000));
+}
@@ -0,0 +1,430 @@
+// =============================================================================
+// sim_lis3dh.cpp - Wire stand-in, LIS3DH register model, Adafruit driver
+// =============================================================================
+// The LIS3DH model keeps a register file and derives OUT_X/Y/Z from the
+// acceleration set through sim.h. Click detection and 6D position changes
+// update CLICK_SRC / INT1_SRC and drive the INT1 pin according to
+// CTRL_REG3 routing and CTRL_REG5 latching, like the real part. STATUS_REG
+// follows the output data rate set in CTRL_REG1: a new sample every period,
+// consumed by reading the outputs, overrun once one is missed. With FIFO_EN
+// the samples queue in a 32-level FIFO instead (bypass, FIFO and stream
+// modes); reading OUT_Z_H pops one and auto-increment wraps back to OUT_X_L.
+// The watermark flag can drive INT1 (I1_WTM); simLis3dhTick() advances it.
+// =============================================================================
+
+#include "Wire.h"
+#include "Adafruit_LIS3DH.h"
+#include "sim.h"
+
+// LIS3DH register addresses used by the model
+#define REG_WHO_AM_I    0x0F
+#define REG_CTRL_REG1   0x20
+#define REG_CTRL_REG3   0x22
+#define REG_CTRL_REG4   0x23
+#define REG_CTRL_REG5   0x24
+#define REG_STATUS      0x27
+#define REG_OUT_X_L     0x28
+#define REG_FIFO_CTRL   0x2E
+#define REG_FIFO_SRC    0x2F
+#define REG_INT1_CFG    0x30
+#define REG_INT1_SRC    0x31
+#define REG_CLICK_CFG   0x38
+#define REG_CLICK_SRC   0x39
+
+#define LIS3DH_REG_COUNT 0x40
+#define LIS3DH_FIFO_DEPTH 32
+
+// =============================================================================
+// LIS3DH Model
+// =============================================================================
+static struct {
+    bool present = true;
+    uint8_t regs[LIS3DH_REG_COUNT];
+    uint8_t pointer;
+    bool autoIncrement;
+    int16_t mg[3] = { 0, 0, 1000 };     // Resting flat: +1 g on Z
+    uint8_t position;                   // Last 6D position (INT1_SRC axis bits)
+    uint64_t lastOutputReadUs;          // Sample in the outputs was consumed then
+    int16_t fifo[LIS3DH_FIFO_DEPTH][3]; // Raw samples, oldest first
+    uint8_t fifoLevel;
+    bool fifoOverrun;
+    uint64_t fifoSampledUs;             // Samples up to here are in the FIFO
+    uint8_t int1Pin = 0xFF;
+    uint8_t int2Pin = 0xFF;
+    bool initialized = false;
+} lis;
+
+static uint8_t lisPosition();
+
+static void lisInit() {
+    if (lis.initialized) return;
+    memset(lis.regs, 0, sizeof(lis.regs));
+    lis.regs[REG_WHO_AM_I] = 0x33;
+    lis.regs[REG_CTRL_REG1] = 0x07;
+    lis.initialized = true;
+    lis.position = lisPosition();
+}
+
+static bool lisFifoWatermark() {
+    uint8_t threshold = lis.regs[REG_FIFO_CTRL] & 0x1F;
+    return threshold && lis.fifoLevel >= threshold;
+}
+
+static void lisUpdateInt1() {
+    if (lis.int1Pin == 0xFF) return;
+    uint8_t ctrl3 = lis.regs[REG_CTRL_REG3];
+    bool level = ((ctrl3 & 0x80) && (lis.regs[REG_CLICK_SRC] & 0x40)) ||
+                 ((ctrl3 & 0x40) && (lis.regs[REG_INT1_SRC] & 0x40)) ||
+                 ((ctrl3 & 0x04) && lisFifoWatermark());
+    simGpioSet(lis.int1Pin, level ? HIGH : LOW);
+}
+
+// Sensitivity in mg/digit for the 12-bit high-resolution output
+static int lisMgPerDigit() {
+    switch ((lis.regs[REG_CTRL_REG4] >> 4) & 0x03) {
+        case 0:  return 1;
+        case 1:  return 2;
+        case 2:  return 4;
+        default: return 12;
+    }
+}
+
+static int16_t lisRawAxis(int axis) {
+    int32_t counts = lis.mg[axis] / lisMgPerDigit();
+    counts = constrain(counts, -2048, 2047);
+    return (int16_t)(counts * 16);
+}
+
+// Output data rate from CTRL_REG1 ODR[3:0] (normal / high-resolution mode)
+static uint32_t lisSamplePeriodUs() {
+    static const uint16_t hz[16] = { 0, 1, 10, 25, 50, 100, 200, 400, 1600, 1344 };
+    uint16_t rate = hz[lis.regs[REG_CTRL_REG1] >> 4];
+    return rate ? 1000000UL / rate : 0;
+}
+
+// ZYXDA once a sample came in since the outputs were last read, ZYXOR once
+// a second one overwrote it
+static uint8_t lisStatus() {
+    uint32_t period = lisSamplePeriodUs();
+    if (!period) return 0;
+    uint64_t fresh = simMicros() / period - lis.lastOutputReadUs / period;
+    if (fresh == 0) return 0;
+    return fresh > 1 ? 0x88 : 0x08;
+}
+
+static uint8_t lisFifoMode() {
+    if (!(lis.regs[REG_CTRL_REG5] & 0x40)) return 0;    // FIFO_EN off: bypass
+    return lis.regs[REG_FIFO_CTRL] >> 6;
+}
+
+// Queue the samples produced since the last call (all with the current
+// acceleration; it only changes through sim.h)
+static void lisFifoUpdate() {
+    uint32_t period = lisSamplePeriodUs();
+    uint64_t now = simMicros();
+    uint64_t produced = period ? now / period - lis.fifoSampledUs / period : 0;
+    lis.fifoSampledUs = now;
+    uint8_t mode = lisFifoMode();
+    if (mode == 0 || produced == 0) return;
+
+    if (produced > LIS3DH_FIFO_DEPTH) produced = LIS3DH_FIFO_DEPTH;
+    for (uint64_t n = 0; n < produced; n++) {
+        if (lis.fifoLevel == LIS3DH_FIFO_DEPTH) {
+            lis.fifoOverrun = true;
+            if (mode == 1) break;           // FIFO mode: stops when full
+            memmove(lis.fifo[0], lis.fifo[1], sizeof(lis.fifo[0]) * (LIS3DH_FIFO_DEPTH - 1));
+            lis.fifoLevel--;
+        }
+        for (int a = 0; a < 3; a++) lis.fifo[lis.fifoLevel][a] = lisRawAxis(a);
+        lis.fifoLevel++;
+    }
+    lisUpdateInt1();
+}
+
+static void lisFifoPop() {
+    if (lis.fifoLevel == 0) return;
+    memmove(lis.fifo[0], lis.fifo[1], sizeof(lis.fifo[0]) * (LIS3DH_FIFO_DEPTH - 1));
+    lis.fifoLevel--;
+    lis.fifoOverrun = false;
+    lisUpdateInt1();
+}
+
+// 6D position: the axis (and sign) carrying gravity, in INT1_SRC bit layout
+static uint8_t lisPosition() {
+    int best = 2;
+    for (int a = 0; a < 3; a++) {
+        if (abs(lis.mg[a]) > abs(lis.mg[best])) best = a;
+    }
+    return (uint8_t)(1 << (best * 2 + (lis.mg[best] > 0 ? 1 : 0)));
+}
+
+static uint8_t lisRead(uint8_t reg) {
+    reg &= 0x3F;
+    if (reg == REG_STATUS) return lisStatus();
+    if (reg == REG_FIFO_SRC) {
+        lisFifoUpdate();
+        uint8_t fss = lis.fifoLevel < LIS3DH_FIFO_DEPTH ? lis.fifoLevel : LIS3DH_FIFO_DEPTH - 1;
+        return (lisFifoWatermark() ? 0x80 : 0) | (lis.fifoOverrun ? 0x40 : 0) |
+               (lis.fifoLevel == 0 ? 0x20 : 0) | fss;
+    }
+    if (reg >= REG_OUT_X_L && reg < REG_OUT_X_L + 6 && lisFifoMode()) {
+        // Empty FIFO: the last sample again
+        int16_t raw = lis.fifo[0][(reg - REG_OUT_X_L) / 2];
+        if (reg == REG_OUT_X_L + 5) lisFifoPop();
+        return (reg & 1) ? (uint8_t)(raw >> 8) : (uint8_t)(raw & 0xFF);
+    }
+    if (reg >= REG_OUT_X_L && reg < REG_OUT_X_L + 6) {
+        lis.lastOutputReadUs = simMicros();
+        int16_t raw = lisRawAxis((reg - REG_OUT_X_L) / 2);
+        return (reg & 1) ? (uint8_t)(raw >> 8) : (uint8_t)(raw & 0xFF);
+    }
+    uint8_t value = lis.regs[reg];
+    if (reg == REG_CLICK_SRC) {
+        lis.regs[REG_CLICK_SRC] = 0;
+        lisUpdateInt1();
+    } else if (reg == REG_INT1_SRC) {
+        lis.regs[REG_INT1_SRC] = 0;
+        lisUpdateInt1();
+    }
+    return value;
+}
+
+static void lisWrite(uint8_t reg, uint8_t value) {
+    reg &= 0x3F;
+    if (reg == REG_WHO_AM_I || reg == REG_CLICK_SRC || reg == REG_INT1_SRC) return;
+    if (reg >= REG_OUT_X_L && reg < REG_OUT_X_L + 6) return;
+    lisFifoUpdate();
+    lis.regs[reg] = value;
+    if (reg == REG_FIFO_CTRL || reg == REG_CTRL_REG5) {
+        // Bypass mode (or FIFO_EN off) empties the FIFO
+        if (lisFifoMode() == 0) {
+            lis.fifoLevel = 0;
+            lis.fifoOverrun = false;
+        }
+        lisUpdateInt1();
+    }
+    if (reg == REG_CTRL_REG3) lisUpdateInt1();
+}
+
+void simLis3dhSetPresent(bool present) {
+    lis.present = present;
+}
+
+void simLis3dhSetInterruptPins(uint8_t int1Pin, uint8_t int2Pin) {
+    lis.int1Pin = int1Pin;
+    lis.int2Pin = int2Pin;
+}
+
+void simLis3dhTick() {
+    if (lis.initialized) lisFifoUpdate();
+}
+
+void simLis3dhSetAccelMg(int16_t x, int16_t y, int16_t z) {
+    lisInit();
+    lisFifoUpdate();        // Samples so far keep the old acceleration
+    lis.mg[0] = x;
+    lis.mg[1] = y;
+    lis.mg[2] = z;
+
+    uint8_t position = lisPosition();
+    if (position == lis.position) return;
+    lis.position = position;
+
+    // 6D movement/position recognition on the INT1 generator
+    if (lis.regs[REG_INT1_CFG] & 0x40) {
+        lis.regs[REG_INT1_SRC] = 0x40 | position;
+        lisUpdateInt1();
+    }
+}
+
+void simLis3dhTap(bool doubleTap) {
+    lisInit();
+    uint8_t cfg = lis.regs[REG_CLICK_CFG];
+    uint8_t src = 0;
+    if (doubleTap && (cfg & 0x20)) src = 0x40 | 0x20 | 0x04;
+    else if (!doubleTap && (cfg & 0x10)) src = 0x40 | 0x10 | 0x04;
+    if (!src) return;
+
+    lis.regs[REG_CLICK_SRC] = src;
+    lisUpdateInt1();
+
+    // Without LIR_INT1 the interrupt is a pulse rather than a latched level
+    if (!(lis.regs[REG_CTRL_REG5] & 0x08) && lis.int1Pin != 0xFF) {
+        simGpioSet(lis.int1Pin, LOW);
+    }
+}
+
+// =============================================================================
+// TwoWire
+// =============================================================================
+TwoWire Wire;
+
+bool TwoWire::begin(int sda, int scl, uint32_t frequency) {
+    (void)sda;
+    (void)scl;
+    if (frequency) frequency_ = frequency;
+    lisInit();
+    return true;
+}
+
+void TwoWire::chargeBusTime(size_t bytes) {
+    // Start + address byte + data bytes, 9 SCL clocks per byte, then stop
+    uint32_t us = (uint32_t)((bytes + 1) * 9 * 1000000ULL / frequency_) + 10;
+    simStats.i2cBusyUs += us;
+    simStats.i2cTransactions++;
+    simAdvanceMicros(us);
+}
+
+void TwoWire::beginTransmission(uint8_t address) {
+    txAddress_ = address;
+    txLength_ = 0;
+}
+
+size_t TwoWire::write(uint8_t data) {
+    if (txLength_ >= SIM_I2C_BUFFER_LENGTH) return 0;
+    txBuffer_[txLength_++] = data;
+    return 1;
+}
+
+size_t TwoWire::write(const uint8_t* data, size_t quantity) {
+    size_t n = 0;
+    while (n < quantity && write(data[n])) n++;
+    return n;
+}
+
+// Without a stop the write is charged with the following read: a repeated
+// start and one transaction, as the ESP32 driver sends it
+uint8_t TwoWire::endTransmission(bool sendStop) {
+    if (sendStop) chargeBusTime(txLength_);
+    else pendingWrite_ = txLength_ + 1;
+    if (txAddress_ != LIS3DH_DEFAULT_ADDRESS || !lis.present) return 2;   // NACK on address
+    if (txLength_ == 0) return 0;
+
+    lis.pointer = txBuffer_[0] & 0x7F;
+    lis.autoIncrement = (txBuffer_[0] & 0x80) != 0;
+    for (size_t i = 1; i < txLength_; i++) {
+        lisWrite(lis.pointer, txBuffer_[i]);
+        if (lis.autoIncrement) lis.pointer++;
+    }
+    return 0;
+}
+
+uint8_t TwoWire::requestFrom(uint8_t address, uint8_t quantity, bool sendStop) {
+    (void)sendStop;
+    chargeBusTime(pendingWrite_ + quantity);
+    pendingWrite_ = 0;
+    rxLength_ = 0;
+    rxIndex_ = 0;
+    if (address != LIS3DH_DEFAULT_ADDRESS || !lis.present) return 0;
+
+    for (uint8_t i = 0; i < quantity && i < SIM_I2C_BUFFER_LENGTH; i++) {
+        rxBuffer_[rxLength_++] = lisRead(lis.pointer);
+        if (lis.autoIncrement) lis.pointer++;
+        if (lis.pointer == REG_OUT_X_L + 6 && lisFifoMode()) lis.pointer = REG_OUT_X_L;
+    }
+    return (uint8_t)rxLength_;
+}
+
+int TwoWire::available() {
+    return (int)(rxLength_ - rxIndex_);
+}
+
+int TwoWire::read() {
+    return rxIndex_ < rxLength_ ? rxBuffer_[rxIndex_++] : -1;
+}
+
+int TwoWire::peek() {
+    return rxIndex_ < rxLength_ ? rxBuffer_[rxIndex_] : -1;
+}
+
+// =============================================================================
+// Adafruit_LIS3DH
+// =============================================================================
+void Adafruit_LIS3DH::writeRegister8(uint8_t reg, uint8_t value) {
+    Wire.beginTransmission(_i2caddr);
+    Wire.write(reg);
+    Wire.write(value);
+    Wire.endTransmission();
+}
+
+uint8_t Adafruit_LIS3DH::readRegister8(uint8_t reg) {
+    Wire.beginTransmission(_i2caddr);
+    Wire.write(reg);
+    Wire.endTransmission();
+    Wire.requestFrom(_i2caddr, (uint8_t)1);
+    return (uint8_t)Wire.read();
+}
+
+bool Adafruit_LIS3DH::begin(uint8_t addr, uint8_t nWAI) {
+    _i2caddr = addr;
+    Wire.begin();
+
+    if (readRegister8(LIS3DH_REG_WHOAMI) != nWAI) return false;
+
+    writeRegister8(LIS3DH_REG_CTRL1, 0x07);     // Enable all axes, normal mode
+    setDataRate(LIS3DH_DATARATE_400_HZ);
+    writeRegister8(LIS3DH_REG_CTRL4, 0x88);     // High res, BDU
+    writeRegister8(LIS3DH_REG_CTRL3, 0x10);     // DRDY on INT1
+    writeRegister8(LIS3DH_REG_TEMPCFG, 0x80);   // Enable ADCs
+    return true;
+}
+
+void Adafruit_LIS3DH::read() {
+    Wire.beginTransmission(_i2caddr);
+    Wire.write(LIS3DH_REG_OUT_X_L | 0x80);
+    Wire.endTransmission();
+    Wire.requestFrom(_i2caddr, (uint8_t)6);
+
+    uint8_t buf[6];
+    for (int i = 0; i < 6; i++) buf[i] = (uint8_t)Wire.read();
+    x = (int16_t)(buf[0] | (buf[1] << 8));
+    y = (int16_t)(buf[2] | (buf[3] << 8));
+    z = (int16_t)(buf[4] | (buf[5] << 8));
+
+    uint16_t divider = 1;
+    switch (getRange()) {
+        case LIS3DH_RANGE_16_G: divider = 1365; break;
+        case LIS3DH_RANGE_8_G:  divider = 4096; break;
+        case LIS3DH_RANGE_4_G:  divider = 8190; break;
+        case LIS3DH_RANGE_2_G:  divider = 16380; break;
+    }
+    x_g = (float)x / divider;
+    y_g = (float)y / divider;
+    z_g = (float)z / divider;
+}
+
+void Adafruit_LIS3DH::setRange(lis3dh_range_t range) {
+    uint8_t r = readRegister8(LIS3DH_REG_CTRL4);
+    r &= ~(0x30);
+    r |= range << 4;
+    writeRegister8(LIS3DH_REG_CTRL4, r);
+}
+
+lis3dh_range_t Adafruit_LIS3DH::getRange() {
+    return (lis3dh_range_t)((readRegister8(LIS3DH_REG_CTRL4) >> 4) & 0x03);
+}
+
+void Adafruit_LIS3DH::setDataRate(lis3dh_dataRate_t dataRate) {
+    uint8_t ctl1 = readRegister8(LIS3DH_REG_CTRL1);
+    ctl1 &= ~(0xF0);
+    ctl1 |= (dataRate << 4);
+    writeRegister8(LIS3DH_REG_CTRL1, ctl1);
+}
+
+lis3dh_dataRate_t Adafruit_LIS3DH::getDataRate() {
+    return (lis3dh_dataRate_t)((readRegister8(LIS3DH_REG_CTRL1) >> 4) & 0x0F);
+}
+
+bool Adafruit_LIS3DH::getEvent(sensors_event_t* event) {
+    memset(event, 0, sizeof(sensors_event_t));
+    event->version = sizeof(sensors_event_t);
+    event->type = SENSOR_TYPE_ACCELEROMETER;
+    event->timestamp = 0;
+
+    read();
+
+    event->acceleration.x = x_g * SENSORS_GRAVITY_STANDARD;
+    event->acceleration.y = y_g * SENSORS_GRAVITY_STANDARD;
+    event->acceleration.z = z_g * SENSORS_GRAVITY_STANDARD;
+    return true;
+}
@@ -0,0 +1,207 @@
+// =============================================================================
+// sim_main.cpp - Host entry point: runs setup()/loop() on the virtual clock
+// =============================================================================
+// Usage: program [options]
+//   --ms <n>            Simulated run time in ms (default: until deep sleep)
+//   --cubes <n>         Attach n programmed cubes before boot (round-robin
+//                       over the LED outputs)
+//   --leds <n>          LEDs per programmed cube (default 25)
+//   --blank <n>         Attach n unprogrammed (blank EEPROM) cubes
+//   --legacy            Programmed cubes use the layout 0 image (page 0, no CRC)
+//   --no-overdrive      Attached cubes do not support 1-Wire overdrive
+//   --nvs <file>        Keep NVS (cube config cache) in a file across runs
+//   --wake              Boot as if woken from deep sleep by the LIS3DH
+//   --rtc <file>        Save RTC memory there on deep sleep; with --wake,
+//                       start from what the previous run saved
+//   --quiet             Do not echo firmware Serial output
+//   --pty               Serial also on a new pseudo-terminal (path printed
+//                       to stderr) for host tools; implies --realtime
+//   --realtime          Run the virtual clock no faster than wall time
+//   --event <ms>:<verb>[:<arg>]
+//       plug:<serial>   Attach a programmed cube     unplug:<serial>
+//       tap / dtap      Single / double tap          flip / unflip
+//       cmd:<text>      Type a serial command line
+//       type:<text>     Type text without the newline (a partial line)
+//       stall:<ms>      Host stops reading Serial for that long
+// Serial input is also read from stdin. Statistics go to stderr on exit.
+// =============================================================================
+
+#include "hardware.h"
+#include "sim.h"
+
+#include <string>
+#include <vector>
+
+// Modeled CPU time of one loop() pass outside the instrumented peripherals
+#define SIM_LOOP_OVERHEAD_US 20
+
+struct SimEvent {
+    uint32_t atMs;
+    std::string verb;
+    std::string arg;
+};
+
+static std::vector<SimEvent> events;
+static size_t nextEvent = 0;
+static int ledsPerCube = 25;
+static bool legacyImages = false;
+
+// =============================================================================
+// Cube Images
+// =============================================================================
+static uint64_t attachProgrammedCube(uint64_t serial) {
+    uint8_t image[SIM_DS2431_MEM_SIZE];
+    memset(image, 0xFF, sizeof(image));
+
+    CubeMemory mem;
+    cubeMemoryDefaults(&mem, 1, ledsPerCube);
+    mem.config.output = (uint8_t)(simOneWireDeviceCount() % LED_CHANNEL_COUNT);
+    cubeMemorySeal(&mem);
+    if (legacyImages) {
+        // Page 0 as written by firmware 2.0: layout 0, no CRC, pages 1-3 blank
+        mem.config.layout = CUBE_LAYOUT_LEGACY;
+        mem.config.crc = 0;
+        memcpy(image, &mem.config, sizeof(mem.config));
+    } else {
+        memcpy(image, &mem, sizeof(mem));
+    }
+
+    return simOneWireAttach(serial, image);
+}
+
+static void detachCube(uint64_t serial) {
+    for (int i = 0; i < simOneWireDeviceCount(); i++) {
+        uint64_t rom = simOneWireRomAt(i);
+        if (((rom >> 8) & 0xFFFFFFFFFFFFULL) == serial) {
+            simOneWireDetach(rom);
+            return;
+        }
+    }
+}
+
+// =============================================================================
+// Scripted Events
+// =============================================================================
+static void runEvent(const SimEvent& e) {
+    if (e.verb == "plug") {
+        attachProgrammedCube(strtoull(e.arg.c_str(), nullptr, 0));
+    } else if (e.verb == "unplug") {
+        detachCube(strtoull(e.arg.c_str(), nullptr, 0));
+    } else if (e.verb == "tap") {
+        simLis3dhTap(false);
+    } else if (e.verb == "dtap") {
+        simLis3dhTap(true);
+    } else if (e.verb == "flip") {
+        simLis3dhSetAccelMg(0, 0, -1000);
+    } else if (e.verb == "unflip") {
+        simLis3dhSetAccelMg(0, 0, 1000);
+    } else if (e.verb == "cmd") {
+        simSerialInject(e.arg.c_str());
+        simSerialInject("\n");
+    } else if (e.verb == "type") {
+        simSerialInject(e.arg.c_str());
+    } else if (e.verb == "stall") {
+        simSerialStallTx(strtoul(e.arg.c_str(), nullptr, 0));
+    } else {
+        fprintf(stderr, "sim: unknown event '%s'\n", e.verb.c_str());
+    }
+}
+
+static bool parseEvent(const char* spec) {
+    SimEvent e;
+    std::string s(spec);
+    size_t a = s.find(':');
+    if (a == std::string::npos) return false;
+    e.atMs = (uint32_t)strtoul(s.substr(0, a).c_str(), nullptr, 0);
+    size_t b = s.find(':', a + 1);
+    e.verb = s.substr(a + 1, b == std::string::npos ? std::string::npos : b - a - 1);
+    if (b != std::string::npos) e.arg = s.substr(b + 1);
+
+    // Keep events ordered by time (stable for equal times)
+    size_t pos = events.size();
+    while (pos > 0 && events[pos - 1].atMs > e.atMs) pos--;
+    events.insert(events.begin() + pos, e);
+    return true;
+}
+
+// =============================================================================
+// Entry Point
+// =============================================================================
+static void usage(const char* prog) {
+    fprintf(stderr,
+            "Usage: %s [--ms n] [--cubes n] [--leds n] [--blank n] [--legacy]\n"
+            "          [--no-overdrive] [--nvs file] [--wake] [--rtc file] [--quiet]\n"
+            "          [--pty] [--realtime]\n"
+            "          [--event ms:verb[:arg]]...\n", prog);
+    exit(2);
+}
+
+int main(int argc, char** argv) {
+    uint32_t runMs = 0;
+    int cubes = 0;
+    int blanks = 0;
+    bool wake = false;
+    bool realtime = false;
+    const char* rtcPath = nullptr;
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* val = (i + 1 < argc) ? argv[i + 1] : nullptr;
+        if (!strcmp(arg, "--ms") && val) { runMs = strtoul(val, nullptr, 0); i++; }
+        else if (!strcmp(arg, "--cubes") && val) { cubes = atoi(val); i++; }
+        else if (!strcmp(arg, "--leds") && val) { ledsPerCube = atoi(val); i++; }
+        else if (!strcmp(arg, "--blank") && val) { blanks = atoi(val); i++; }
+        else if (!strcmp(arg, "--nvs") && val) { simNvsSetFile(val); i++; }
+        else if (!strcmp(arg, "--event") && val) { if (!parseEvent(val)) usage(argv[0]); i++; }
+        else if (!strcmp(arg, "--legacy")) legacyImages = true;
+        else if (!strcmp(arg, "--no-overdrive")) simOneWireSetOverdriveCapable(false);
+        else if (!strcmp(arg, "--rtc") && val) { rtcPath = val; i++; }
+        else if (!strcmp(arg, "--wake")) wake = true;
+        else if (!strcmp(arg, "--quiet")) simSerialSetEcho(false);
+        else if (!strcmp(arg, "--realtime")) realtime = true;
+        else if (!strcmp(arg, "--pty")) {
+            const char* path = simSerialOpenPty();
+            if (!path) {
+                perror("sim: pty");
+                return 1;
+            }
+            fprintf(stderr, "sim: serial on %s\n", path);
+            realtime = true;
+        }
+        else usage(argv[0]);
+    }
+
+    if (wake) simSetWakeupCause(ESP_SLEEP_WAKEUP_GPIO);
+    if (rtcPath) simRtcSetFile(rtcPath, wake);
+
+    simLis3dhSetInterruptPins(PIN_LIS3DH_INT, 0xFF);
+    for (int i = 0; i < cubes; i++) attachProgrammedCube(0x1000 + i);
+    for (int i = 0; i < blanks; i++) simOneWireAttach(0x2000 + i, nullptr);
+
+    simResetStats();
+
+    simStats.frameGapFromUs = UINT64_MAX;
+    setup();
+    simStats.frameGapFromUs = simMicros();
+
+    for (;;) {
+        uint32_t now = millis();
+        while (nextEvent < events.size() && events[nextEvent].atMs <= now) {
+            runEvent(events[nextEvent++]);
+        }
+        if (runMs && now >= runMs) break;
+
+        if (realtime) simPaceRealtime();
+        simPollInput();
+        simLis3dhTick();
+        uint64_t start = simMicros();
+        loop();
+        uint32_t elapsed = (uint32_t)(simMicros() - start);
+        if (elapsed > simStats.maxLoopUs) simStats.maxLoopUs = elapsed;
+        simStats.loopPasses++;
+        simAdvanceMicros(SIM_LOOP_OVERHEAD_US);
+    }
+
+    simExit("run complete");
+    return 0;
+}
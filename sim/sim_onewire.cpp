@@ -0,0 +1,566 @@
+// =============================================================================
+// sim_onewire.cpp - OneWire stand-in and simulated DS2431 bus
+// =============================================================================
+// The bus is modeled at bit-slot level: the master side (class OneWire)
+// produces resets, write slots and read slots exactly as the PJRC library
+// does, and every attached DS2431 runs its ROM/memory function state machine
+// on those slots. Read slots return the wired-AND of all driving devices.
+// Slot timings follow the PJRC implementation at standard speed, and the
+// AN126 overdrive values for the firmware's overdrive transport.
+// =============================================================================
+
+#include "OneWire.h"
+#include "sim.h"
+
+#include <vector>
+
+// Standard-speed slot timing (OneWire.cpp: reset 480+70+410, write/read slots)
+#define OW_RESET_US     960
+#define OW_WRITE1_US    65
+#define OW_WRITE0_US    70
+#define OW_READ_US      66
+
+// Overdrive slot timing (AN126: reset H+I+J, write 1 A+B, write 0 C+D, read A+E+F)
+#define OD_RESET_US     119
+#define OD_WRITE1_US    9
+#define OD_WRITE0_US    10
+#define OD_READ_US      9
+
+// DS2431 copy-scratchpad programming time (tPROG)
+#define DS2431_TPROG_US 10000
+
+// =============================================================================
+// DS2431 Device Model
+// =============================================================================
+enum DsState {
+    DS_IDLE,        // Waiting for reset; not driving the bus
+    DS_ROM_CMD,     // Receiving ROM function command
+    DS_MATCH_ROM,   // Receiving 64-bit ROM to compare
+    DS_SEARCH,      // Taking part in search ROM
+    DS_FUNC_CMD,    // Selected, receiving memory function command
+    DS_WS_ADDR,     // Write scratchpad: TA1, TA2
+    DS_WS_DATA,     // Write scratchpad: data bytes
+    DS_CP_AUTH,     // Copy scratchpad: TA1, TA2, E/S
+    DS_RM_ADDR,     // Read memory: TA1, TA2
+    DS_OUTPUT       // Driving bytes from an output source
+};
+
+enum DsOutput {
+    OUT_BUFFER,     // Bytes queued in out[]
+    OUT_MEMORY,     // Sequential memory read
+    OUT_PROGRAM     // 0xAA pattern once programming completes
+};
+
+struct SimDs2431 {
+    uint8_t rom[8];
+    uint8_t mem[SIM_DS2431_MEM_SIZE];
+    uint8_t scratch[8];
+    uint8_t ta1, ta2, es;
+
+    DsState state;
+    uint8_t rxByte, rxBits;
+    uint8_t rxCount;
+    uint8_t rxBuf[8];
+
+    // Search ROM progress: bit index and sub-slot (0 = bit, 1 = complement, 2 = direction)
+    uint8_t searchBit, searchSlot;
+
+    DsOutput outMode;
+    uint8_t out[16];
+    uint8_t outLen, outPos;
+    uint16_t memAddr;
+    uint64_t programDoneUs;
+    uint8_t txByte, txBits;
+
+    bool odCapable;     // Responds to Overdrive Skip / Overdrive Match ROM
+    bool overdrive;     // Currently communicating at overdrive speed
+};
+
+static std::vector<SimDs2431> devices;
+static uint8_t busPin = 0xFF;
+static bool attachOverdrive = true;
+
+static uint64_t romToId(const uint8_t* rom) {
+    uint64_t id = 0;
+    for (int i = 0; i < 8; i++) id |= ((uint64_t)rom[i]) << (i * 8);
+    return id;
+}
+
+static SimDs2431* findDevice(uint64_t romId) {
+    for (auto& d : devices) {
+        if (romToId(d.rom) == romId) return &d;
+    }
+    return nullptr;
+}
+
+uint64_t simOneWireAttach(uint64_t serial, const uint8_t* image) {
+    SimDs2431 d;
+    memset(&d, 0, sizeof(d));
+    d.rom[0] = 0x2D;
+    for (int i = 0; i < 6; i++) d.rom[1 + i] = (serial >> (i * 8)) & 0xFF;
+    d.rom[7] = OneWire::crc8(d.rom, 7);
+    if (image) {
+        memcpy(d.mem, image, SIM_DS2431_MEM_SIZE);
+    } else {
+        memset(d.mem, 0xFF, SIM_DS2431_MEM_SIZE);
+    }
+    d.state = DS_IDLE;
+    d.odCapable = attachOverdrive;
+
+    uint64_t id = romToId(d.rom);
+    simOneWireDetach(id);
+    devices.push_back(d);
+
+    // A device connecting to the idle bus issues a presence pulse
+    if (busPin != 0xFF) {
+        simGpioSet(busPin, LOW);
+        simGpioSet(busPin, HIGH);
+    }
+    return id;
+}
+
+void simOneWireDetach(uint64_t romId) {
+    for (size_t i = 0; i < devices.size(); i++) {
+        if (romToId(devices[i].rom) == romId) {
+            devices.erase(devices.begin() + i);
+            return;
+        }
+    }
+}
+
+void simOneWireSetOverdriveCapable(bool capable) {
+    attachOverdrive = capable;
+}
+
+int simOneWireDeviceCount() {
+    return (int)devices.size();
+}
+
+uint64_t simOneWireRomAt(int index) {
+    if (index < 0 || index >= (int)devices.size()) return 0;
+    return romToId(devices[index].rom);
+}
+
+uint8_t* simOneWireMemory(uint64_t romId) {
+    SimDs2431* d = findDevice(romId);
+    return d ? d->mem : nullptr;
+}
+
+// Start driving a byte sequence from out[]
+static void dsOutput(SimDs2431& d, const uint8_t* data, uint8_t len) {
+    memcpy(d.out, data, len);
+    d.outLen = len;
+    d.outPos = 0;
+    d.outMode = OUT_BUFFER;
+    d.txBits = 0;
+    d.state = DS_OUTPUT;
+}
+
+static uint8_t dsNextOutputByte(SimDs2431& d) {
+    switch (d.outMode) {
+        case OUT_BUFFER:
+            return d.outPos < d.outLen ? d.out[d.outPos++] : 0xFF;
+        case OUT_MEMORY:
+            return d.memAddr < SIM_DS2431_MEM_SIZE ? d.mem[d.memAddr++] : 0xFF;
+        case OUT_PROGRAM:
+            return simMicros() >= d.programDoneUs ? 0xAA : 0xFF;
+    }
+    return 0xFF;
+}
+
+static void dsFunctionCommand(SimDs2431& d, uint8_t cmd) {
+    d.rxCount = 0;
+    switch (cmd) {
+        case 0x0F: d.state = DS_WS_ADDR; break;     // Write scratchpad
+        case 0xAA: {                                // Read scratchpad
+            uint8_t buf[16];
+            uint8_t n = 0;
+            buf[n++] = d.ta1;
+            buf[n++] = d.ta2;
+            buf[n++] = d.es;
+            for (int i = d.ta1 & 0x07; i <= (d.es & 0x07); i++) buf[n++] = d.scratch[i];
+            uint8_t crcIn[16];
+            crcIn[0] = 0xAA;
+            memcpy(crcIn + 1, buf, n);
+            uint16_t crc = ~OneWire::crc16(crcIn, n + 1);
+            buf[n++] = crc & 0xFF;
+            buf[n++] = crc >> 8;
+            dsOutput(d, buf, n);
+            break;
+        }
+        case 0x55: d.state = DS_CP_AUTH; break;     // Copy scratchpad
+        case 0xF0: d.state = DS_RM_ADDR; break;     // Read memory
+        default:   d.state = DS_IDLE; break;
+    }
+}
+
+static void dsByte(SimDs2431& d, uint8_t b) {
+    switch (d.state) {
+        case DS_ROM_CMD:
+            d.rxCount = 0;
+            switch (b) {
+                case 0x55: d.state = DS_MATCH_ROM; break;
+                case 0xCC: d.state = DS_FUNC_CMD; break;
+                case 0x3C:                          // Overdrive Skip ROM
+                case 0x69:                          // Overdrive Match ROM
+                    if (!d.odCapable) {
+                        d.state = DS_IDLE;
+                        break;
+                    }
+                    d.overdrive = true;
+                    d.state = (b == 0x3C) ? DS_FUNC_CMD : DS_MATCH_ROM;
+                    break;
+                case 0x33: dsOutput(d, d.rom, 8); break;
+                case 0xF0:
+                    d.state = DS_SEARCH;
+                    d.searchBit = 0;
+                    d.searchSlot = 0;
+                    break;
+                default: d.state = DS_IDLE; break;
+            }
+            break;
+
+        case DS_MATCH_ROM:
+            d.rxBuf[d.rxCount++] = b;
+            if (d.rxCount == 8) {
+                d.state = memcmp(d.rxBuf, d.rom, 8) == 0 ? DS_FUNC_CMD : DS_IDLE;
+            }
+            break;
+
+        case DS_FUNC_CMD:
+            dsFunctionCommand(d, b);
+            break;
+
+        case DS_WS_ADDR:
+            d.rxBuf[d.rxCount++] = b;
+            if (d.rxCount == 2) {
+                d.ta1 = d.rxBuf[0];
+                d.ta2 = d.rxBuf[1];
+                d.es = (d.ta1 & 0x07) | 0x20;   // PF until the row is filled
+                d.rxCount = d.ta1 & 0x07;
+                d.state = DS_WS_DATA;
+            }
+            break;
+
+        case DS_WS_DATA:
+            d.scratch[d.rxCount] = b;
+            d.es = (d.es & 0x20) | d.rxCount;
+            if (++d.rxCount == 8) {
+                d.es &= ~0x20;
+                uint8_t crcIn[11] = { 0x0F, d.ta1, d.ta2 };
+                memcpy(crcIn + 3, d.scratch, 8);
+                uint16_t crc = ~OneWire::crc16(crcIn, sizeof(crcIn));
+                uint8_t buf[2] = { (uint8_t)(crc & 0xFF), (uint8_t)(crc >> 8) };
+                dsOutput(d, buf, 2);
+            }
+            break;
+
+        case DS_CP_AUTH:
+            d.rxBuf[d.rxCount++] = b;
+            if (d.rxCount == 3) {
+                uint16_t addr = d.ta1 | (d.ta2 << 8);
+                bool ok = d.rxBuf[0] == d.ta1 && d.rxBuf[1] == d.ta2 && d.rxBuf[2] == d.es &&
+                          (d.es & 0x27) == 0x07 && addr < 0x90;
+                d.state = DS_OUTPUT;
+                d.txBits = 0;
+                if (ok) {
+                    memcpy(&d.mem[addr & ~0x07], d.scratch, 8);
+                    d.es |= 0x80;
+                    d.outMode = OUT_PROGRAM;
+                    d.programDoneUs = simMicros() + DS2431_TPROG_US;
+                } else {
+                    d.outMode = OUT_BUFFER;
+                    d.outLen = 0;
+                }
+            }
+            break;
+
+        case DS_RM_ADDR:
+            d.rxBuf[d.rxCount++] = b;
+            if (d.rxCount == 2) {
+                d.memAddr = d.rxBuf[0] | (d.rxBuf[1] << 8);
+                d.outMode = OUT_MEMORY;
+                d.txBits = 0;
+                d.state = DS_OUTPUT;
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+// =============================================================================
+// Bus Primitives
+// =============================================================================
+static void busTime(uint32_t us) {
+    simStats.oneWireBusyUs += us;
+    simAdvanceMicros(us);
+}
+
+// A standard reset returns every device to standard speed. An overdrive reset
+// is too short for standard-speed devices and only resets those in overdrive.
+// Slots are only seen by devices running at the same speed.
+static uint8_t busReset(bool overdrive) {
+    busTime(overdrive ? OD_RESET_US : OW_RESET_US);
+    simStats.oneWireResets++;
+    uint8_t presence = 0;
+    for (auto& d : devices) {
+        if (overdrive && !d.overdrive) continue;
+        d.overdrive = overdrive;
+        d.state = DS_ROM_CMD;
+        d.rxByte = 0;
+        d.rxBits = 0;
+        d.rxCount = 0;
+        presence = 1;
+    }
+    return presence;
+}
+
+static void busWriteBit(uint8_t v, bool overdrive) {
+    if (overdrive) busTime(v ? OD_WRITE1_US : OD_WRITE0_US);
+    else busTime(v ? OW_WRITE1_US : OW_WRITE0_US);
+    for (auto& d : devices) {
+        if (d.overdrive != overdrive) continue;
+        if (d.state == DS_IDLE || d.state == DS_OUTPUT) continue;
+        if (d.state == DS_SEARCH) {
+            if (d.searchSlot != 2) continue;
+            uint8_t bit = (d.rom[d.searchBit / 8] >> (d.searchBit % 8)) & 1;
+            if (bit != (v & 1)) {
+                d.state = DS_IDLE;
+                continue;
+            }
+            d.searchSlot = 0;
+            if (++d.searchBit == 64) d.state = DS_FUNC_CMD;
+            continue;
+        }
+        d.rxByte |= (v & 1) << d.rxBits;
+        if (++d.rxBits == 8) {
+            uint8_t b = d.rxByte;
+            d.rxByte = 0;
+            d.rxBits = 0;
+            dsByte(d, b);
+        }
+    }
+}
+
+static uint8_t busReadBit(bool overdrive) {
+    busTime(overdrive ? OD_READ_US : OW_READ_US);
+    uint8_t level = 1;
+    for (auto& d : devices) {
+        if (d.overdrive != overdrive) continue;
+        if (d.state == DS_SEARCH) {
+            if (d.searchSlot > 1) continue;
+            uint8_t bit = (d.rom[d.searchBit / 8] >> (d.searchBit % 8)) & 1;
+            level &= (d.searchSlot == 0) ? bit : !bit;
+            d.searchSlot++;
+        } else if (d.state == DS_OUTPUT) {
+            if (d.txBits == 0) {
+                d.txByte = dsNextOutputByte(d);
+                d.txBits = 8;
+            }
+            level &= d.txByte & 1;
+            d.txByte >>= 1;
+            d.txBits--;
+        }
+    }
+    return level;
+}
+
+// =============================================================================
+// OneWire (master side, mirrors OneWire.cpp)
+// =============================================================================
+void OneWire::begin(uint8_t pin) {
+    busPin = pin;
+    simGpioSet(pin, HIGH);      // Idle bus is pulled up
+}
+
+uint8_t OneWire::reset(void) {
+    return busReset(false);
+}
+
+void OneWire::write_bit(uint8_t v) {
+    busWriteBit(v & 1, false);
+}
+
+uint8_t OneWire::read_bit(void) {
+    return busReadBit(false);
+}
+
+// =============================================================================
+// Overdrive Slots (firmware drives these directly on the device)
+// =============================================================================
+uint8_t simOneWireResetOverdrive() {
+    return busReset(true);
+}
+
+void simOneWireWriteBitOverdrive(uint8_t v) {
+    busWriteBit(v & 1, true);
+}
+
+uint8_t simOneWireReadBitOverdrive() {
+    return busReadBit(true);
+}
+
+void OneWire::write(uint8_t v, uint8_t power) {
+    (void)power;
+    for (uint8_t bitMask = 0x01; bitMask; bitMask <<= 1) {
+        write_bit((bitMask & v) ? 1 : 0);
+    }
+}
+
+void OneWire::write_bytes(const uint8_t* buf, uint16_t count, bool power) {
+    for (uint16_t i = 0; i < count; i++) write(buf[i], power);
+}
+
+uint8_t OneWire::read() {
+    uint8_t r = 0;
+    for (uint8_t bitMask = 0x01; bitMask; bitMask <<= 1) {
+        if (read_bit()) r |= bitMask;
+    }
+    return r;
+}
+
+void OneWire::read_bytes(uint8_t* buf, uint16_t count) {
+    for (uint16_t i = 0; i < count; i++) buf[i] = read();
+}
+
+void OneWire::select(const uint8_t rom[8]) {
+    write(0x55);
+    for (uint8_t i = 0; i < 8; i++) write(rom[i]);
+}
+
+void OneWire::skip() {
+    write(0xCC);
+}
+
+void OneWire::reset_search() {
+    LastDiscrepancy = 0;
+    LastDeviceFlag = false;
+    LastFamilyDiscrepancy = 0;
+    for (int i = 7; ; i--) {
+        ROM_NO[i] = 0;
+        if (i == 0) break;
+    }
+}
+
+void OneWire::target_search(uint8_t family_code) {
+    ROM_NO[0] = family_code;
+    for (uint8_t i = 1; i < 8; i++) ROM_NO[i] = 0;
+    LastDiscrepancy = 64;
+    LastFamilyDiscrepancy = 0;
+    LastDeviceFlag = false;
+}
+
+bool OneWire::search(uint8_t* newAddr, bool search_mode) {
+    uint8_t id_bit_number = 1;
+    uint8_t last_zero = 0, rom_byte_number = 0;
+    bool search_result = false;
+    uint8_t id_bit, cmp_id_bit;
+    unsigned char rom_byte_mask = 1, search_direction;
+
+    if (!LastDeviceFlag) {
+        if (!reset()) {
+            LastDiscrepancy = 0;
+            LastDeviceFlag = false;
+            LastFamilyDiscrepancy = 0;
+            return false;
+        }
+
+        write(search_mode ? 0xF0 : 0xEC);
+
+        do {
+            id_bit = read_bit();
+            cmp_id_bit = read_bit();
+
+            if ((id_bit == 1) && (cmp_id_bit == 1)) {
+                break;
+            } else {
+                if (id_bit != cmp_id_bit) {
+                    search_direction = id_bit;
+                } else {
+                    if (id_bit_number < LastDiscrepancy) {
+                        search_direction = ((ROM_NO[rom_byte_number] & rom_byte_mask) > 0);
+                    } else {
+                        search_direction = (id_bit_number == LastDiscrepancy);
+                    }
+                    if (search_direction == 0) {
+                        last_zero = id_bit_number;
+                        if (last_zero < 9) LastFamilyDiscrepancy = last_zero;
+                    }
+                }
+
+                if (search_direction == 1) {
+                    ROM_NO[rom_byte_number] |= rom_byte_mask;
+                } else {
+                    ROM_NO[rom_byte_number] &= ~rom_byte_mask;
+                }
+
+                write_bit(search_direction);
+
+                id_bit_number++;
+                rom_byte_mask <<= 1;
+
+                if (rom_byte_mask == 0) {
+                    rom_byte_number++;
+                    rom_byte_mask = 1;
+                }
+            }
+        } while (rom_byte_number < 8);
+
+        if (!(id_bit_number < 65)) {
+            LastDiscrepancy = last_zero;
+            if (LastDiscrepancy == 0) {
+                LastDeviceFlag = true;
+            }
+            search_result = true;
+        }
+    }
+
+    if (!search_result || !ROM_NO[0]) {
+        LastDiscrepancy = 0;
+        LastDeviceFlag = false;
+        LastFamilyDiscrepancy = 0;
+        search_result = false;
+    } else {
+        for (int i = 0; i < 8; i++) newAddr[i] = ROM_NO[i];
+    }
+    return search_result;
+}
+
+uint8_t OneWire::crc8(const uint8_t* addr, uint8_t len) {
+    uint8_t crc = 0;
+    while (len--) {
+        uint8_t inbyte = *addr++;
+        for (uint8_t i = 8; i; i--) {
+            uint8_t mix = (crc ^ inbyte) & 0x01;
+            crc >>= 1;
+            if (mix) crc ^= 0x8C;
+            inbyte >>= 1;
+        }
+    }
+    return crc;
+}
+
+bool OneWire::check_crc16(const uint8_t* input, uint16_t len, const uint8_t* inverted_crc, uint16_t crc) {
+    crc = ~crc16(input, len, crc);
+    return (crc & 0xFF) == inverted_crc[0] && (crc >> 8) == inverted_crc[1];
+}
+
+uint16_t OneWire::crc16(const uint8_t* input, uint16_t len, uint16_t crc) {
+    static const uint8_t oddparity[16] = { 0, 1, 1, 0, 1, 0, 0, 1, 1, 0, 0, 1, 0, 1, 1, 0 };
+
+    for (uint16_t i = 0; i < len; i++) {
+        uint16_t cdata = input[i];
+        cdata = (cdata ^ crc) & 0xff;
+        crc >>= 8;
+
+        if (oddparity[cdata & 0x0F] ^ oddparity[cdata >> 4]) crc ^= 0xC001;
+
+        cdata <<= 6;
+        crc ^= cdata;
+        cdata <<= 1;
+        crc ^= cdata;
+    }
+    return crc;
+}
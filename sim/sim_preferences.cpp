@@ -0,0 +1,146 @@
+// =============================================================================
+// sim_preferences.cpp - NVS Preferences stand-in
+// =============================================================================
+// Values are stored as "namespace/key" -> bytes. The optional backing file is
+// a sequence of records: u16 name length, name, u32 value length, value.
+// =============================================================================
+
+#include "Preferences.h"
+#include "sim.h"
+
+#include <map>
+#include <vector>
+
+// NVS stores data in 32-byte entries; a rough cost of writing one of them
+// (including the entry state updates), charged per put
+#define SIM_NVS_ENTRY_SIZE          32
+#define SIM_NVS_WRITE_US_PER_ENTRY  100
+
+static std::map<std::string, std::vector<uint8_t>> nvs;
+static std::string nvsFile;
+
+// =============================================================================
+// Backing File
+// =============================================================================
+void simNvsSetFile(const char* path) {
+    nvsFile = path;
+    nvs.clear();
+
+    FILE* f = fopen(path, "rb");
+    if (!f) return;     // First run: starts empty
+    for (;;) {
+        uint16_t nameLen;
+        uint32_t valueLen;
+        if (fread(&nameLen, sizeof(nameLen), 1, f) != 1) break;
+        std::string name(nameLen, '\0');
+        if (fread(&name[0], 1, nameLen, f) != nameLen) break;
+        if (fread(&valueLen, sizeof(valueLen), 1, f) != 1) break;
+        std::vector<uint8_t> value(valueLen);
+        if (valueLen && fread(value.data(), 1, valueLen, f) != valueLen) break;
+        nvs[name] = value;
+    }
+    fclose(f);
+}
+
+static void nvsSave() {
+    if (nvsFile.empty()) return;
+    FILE* f = fopen(nvsFile.c_str(), "wb");
+    if (!f) return;
+    for (const auto& kv : nvs) {
+        uint16_t nameLen = (uint16_t)kv.first.size();
+        uint32_t valueLen = (uint32_t)kv.second.size();
+        fwrite(&nameLen, sizeof(nameLen), 1, f);
+        fwrite(kv.first.data(), 1, nameLen, f);
+        fwrite(&valueLen, sizeof(valueLen), 1, f);
+        fwrite(kv.second.data(), 1, valueLen, f);
+    }
+    fclose(f);
+}
+
+static void nvsChargeWrite(size_t len) {
+    uint32_t entries = 1 + (uint32_t)((len + SIM_NVS_ENTRY_SIZE - 1) / SIM_NVS_ENTRY_SIZE);
+    simStats.nvsWrites++;
+    simStats.nvsBytes += len;
+    simAdvanceMicros(entries * SIM_NVS_WRITE_US_PER_ENTRY);
+}
+
+// =============================================================================
+// Preferences
+// =============================================================================
+std::string Preferences::path(const char* key) const {
+    return ns_ + "/" + key;
+}
+
+bool Preferences::begin(const char* name, bool readOnly, const char* partition_label) {
+    (void)partition_label;
+    if (started_) return false;
+    ns_ = name;
+
+    // Like nvs_open(), a read-only open fails until the namespace exists
+    if (readOnly) {
+        auto it = nvs.lower_bound(ns_ + "/");
+        if (it == nvs.end() || it->first.compare(0, ns_.size() + 1, ns_ + "/") != 0) return false;
+    }
+    started_ = true;
+    readOnly_ = readOnly;
+    return true;
+}
+
+void Preferences::end() {
+    started_ = false;
+}
+
+bool Preferences::clear() {
+    if (!started_ || readOnly_) return false;
+    std::string prefix = ns_ + "/";
+    for (auto it = nvs.lower_bound(prefix); it != nvs.end() && it->first.compare(0, prefix.size(), prefix) == 0;) {
+        it = nvs.erase(it);
+    }
+    nvsChargeWrite(0);
+    nvsSave();
+    return true;
+}
+
+bool Preferences::remove(const char* key) {
+    if (!started_ || readOnly_) return false;
+    if (!nvs.erase(path(key))) return false;
+    nvsChargeWrite(0);
+    nvsSave();
+    return true;
+}
+
+bool Preferences::isKey(const char* key) {
+    return started_ && nvs.count(path(key));
+}
+
+size_t Preferences::putUChar(const char* key, uint8_t value) {
+    return putBytes(key, &value, 1);
+}
+
+uint8_t Preferences::getUChar(const char* key, uint8_t defaultValue) {
+    uint8_t value = defaultValue;
+    if (getBytesLength(key) == 1) getBytes(key, &value, 1);
+    return value;
+}
+
+size_t Preferences::putBytes(const char* key, const void* value, size_t len) {
+    if (!started_ || readOnly_ || !key || (!value && len)) return 0;
+    const uint8_t* p = (const uint8_t*)value;
+    nvs[path(key)] = std::vector<uint8_t>(p, p + len);
+    nvsChargeWrite(len);
+    nvsSave();
+    return len;
+}
+
+size_t Preferences::getBytesLength(const char* key) {
+    if (!started_) return 0;
+    auto it = nvs.find(path(key));
+    return it == nvs.end() ? 0 : it->second.size();
+}
+
+size_t Preferences::getBytes(const char* key, void* buf, size_t maxLen) {
+    size_t len = getBytesLength(key);
+    if (!len || !buf || len > maxLen) return 0;
+    memcpy(buf, nvs[path(key)].data(), len);
+    return len;
+}
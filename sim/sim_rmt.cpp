@@ -0,0 +1,135 @@
+// =============================================================================
+// sim_rmt.cpp - RMT TX stand-in: WS2812 pulses on the virtual clock
+// =============================================================================
+// Translation and decoding cost no virtual time: on the chip the translator
+// runs in the RMT interrupt, a few percent of the CPU while a frame is out.
+// Channels transmit independently. A write that finds every channel idle
+// starts a new frame; "LED output busy" counts the time any channel is
+// sending, so parallel outputs overlap instead of adding up.
+// =============================================================================
+
+#include "driver/rmt.h"
+#include "sim.h"
+
+#include <vector>
+
+#define SIM_RMT_ITEMS_PER_CALL 64        // One RMT memory block per refill
+
+struct SimRmtChannel {
+    bool configured;
+    bool installed;
+    uint8_t clkDiv;
+    uint8_t pin;
+    sample_to_rmt_t translator;
+    uint64_t busyUntilUs;
+};
+
+static SimRmtChannel channels[RMT_CHANNEL_MAX];
+
+static bool validChannel(rmt_channel_t channel) {
+    return channel >= RMT_CHANNEL_0 && channel < RMT_CHANNEL_MAX;
+}
+
+// End of the latest transfer on any channel
+static uint64_t outputBusyUntil() {
+    uint64_t until = 0;
+    for (const SimRmtChannel& ch : channels) {
+        if (ch.busyUntilUs > until) until = ch.busyUntilUs;
+    }
+    return until;
+}
+
+esp_err_t rmt_config(const rmt_config_t* config) {
+    if (!config || !validChannel(config->channel) || config->clk_div == 0) return ESP_ERR_INVALID_ARG;
+    if (config->rmt_mode != RMT_MODE_TX) return ESP_ERR_INVALID_ARG;     // RX not modeled
+    SimRmtChannel* ch = &channels[config->channel];
+    ch->configured = true;
+    ch->clkDiv = config->clk_div;
+    ch->pin = (uint8_t)config->gpio_num;
+    return ESP_OK;
+}
+
+esp_err_t rmt_driver_install(rmt_channel_t channel, size_t rx_buf_size, int intr_alloc_flags) {
+    (void)rx_buf_size;
+    (void)intr_alloc_flags;
+    if (!validChannel(channel) || !channels[channel].configured) return ESP_ERR_INVALID_STATE;
+    if (channels[channel].installed) return ESP_ERR_INVALID_STATE;
+    channels[channel].installed = true;
+    return ESP_OK;
+}
+
+esp_err_t rmt_driver_uninstall(rmt_channel_t channel) {
+    if (!validChannel(channel) || !channels[channel].installed) return ESP_ERR_INVALID_STATE;
+    rmt_wait_tx_done(channel, portMAX_DELAY);
+    channels[channel].installed = false;
+    channels[channel].translator = nullptr;
+    return ESP_OK;
+}
+
+esp_err_t rmt_translator_init(rmt_channel_t channel, sample_to_rmt_t fn) {
+    if (!validChannel(channel) || !channels[channel].installed || !fn) return ESP_ERR_INVALID_ARG;
+    channels[channel].translator = fn;
+    return ESP_OK;
+}
+
+esp_err_t rmt_get_counter_clock(rmt_channel_t channel, uint32_t* clock_hz) {
+    if (!validChannel(channel) || !channels[channel].configured || !clock_hz) return ESP_ERR_INVALID_ARG;
+    *clock_hz = RMT_SIM_SOURCE_CLK_HZ / channels[channel].clkDiv;
+    return ESP_OK;
+}
+
+esp_err_t rmt_wait_tx_done(rmt_channel_t channel, TickType_t wait_time) {
+    if (!validChannel(channel) || !channels[channel].installed) return ESP_ERR_INVALID_STATE;
+    SimRmtChannel* ch = &channels[channel];
+    if (ch->busyUntilUs <= simMicros()) return ESP_OK;
+    if (wait_time == 0) return ESP_ERR_TIMEOUT;
+    simTaskBlockUntil(ch->busyUntilUs);
+    return ESP_OK;
+}
+
+esp_err_t rmt_write_sample(rmt_channel_t channel, const uint8_t* src, size_t src_size, bool wait_tx_done) {
+    if (!validChannel(channel) || !channels[channel].translator || !src) return ESP_ERR_INVALID_ARG;
+    SimRmtChannel* ch = &channels[channel];
+
+    // The driver takes the channel's TX semaphore first
+    rmt_wait_tx_done(channel, portMAX_DELAY);
+
+    // Translate in memory-block sized pieces, like the refill interrupt
+    std::vector<rmt_item32_t> items;
+    size_t done = 0;
+    while (done < src_size) {
+        rmt_item32_t block[SIM_RMT_ITEMS_PER_CALL];
+        size_t translated = 0, num = 0;
+        ch->translator(src + done, block, src_size - done, SIM_RMT_ITEMS_PER_CALL, &translated, &num);
+        if (translated == 0 && num == 0) break;
+        items.insert(items.end(), block, block + num);
+        done += translated;
+    }
+
+    // Decode what a WS2812 chain samples: high longer than low is a 1 bit
+    uint64_t ticks = 0;
+    std::vector<uint8_t> bytes(items.size() / 8, 0);
+    for (size_t i = 0; i < items.size(); i++) {
+        const rmt_item32_t& it = items[i];
+        uint32_t high = (it.level0 ? it.duration0 : 0) + (it.level1 ? it.duration1 : 0);
+        uint32_t low = (it.level0 ? 0 : it.duration0) + (it.level1 ? 0 : it.duration1);
+        if (i / 8 < bytes.size() && high > low) bytes[i / 8] |= 0x80 >> (i % 8);
+        ticks += it.duration0 + it.duration1;
+    }
+    simLedWireLatch(ch->pin, bytes.data(), bytes.size());
+
+    uint32_t clockHz = RMT_SIM_SOURCE_CLK_HZ / ch->clkDiv;
+    uint32_t us = (uint32_t)(ticks * 1000000 / clockHz) + SIM_WS2812_LATCH_US;
+    uint64_t now = simMicros();
+    uint64_t busyUntil = outputBusyUntil();
+    if (busyUntil <= now) {
+        simLedFrameStarted();
+        simStats.ledShows++;
+        busyUntil = now;
+    }
+    if (now + us > busyUntil) simStats.ledBusyUs += now + us - busyUntil;
+    ch->busyUntilUs = now + us;
+
+    if (wait_tx_done) rmt_wait_tx_done(channel, portMAX_DELAY);
+    return ESP_OK;
+}
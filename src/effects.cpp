@@ -0,0 +1,116 @@
+// =============================================================================
+// effects.cpp - Animations and the effect registry
+// =============================================================================
+
+#include "effects.h"
+#include "pixel_ops.h"
+
+EffectArena effectArena = { EFFECT_NONE, {} };
+
+// =============================================================================
+// Effects
+// =============================================================================
+
+// Rainbow Wave: a hue ramp that scrolls one step a frame
+struct RainbowState {
+    uint8_t hue;
+};
+
+static void rainbowRender(void* state, CRGB* frame, int count) {
+    RainbowState* s = (RainbowState*)state;
+    pixelFillHue(frame, count, s->hue++, 10, 255, 200);
+}
+
+// Breathe: all LEDs pulse blue at 30 beats per minute
+static void breatheRender(void* state, CRGB* frame, int count) {
+    pixelFill(frame, count, CHSV(160, 255, beatsin8(30, 50, 255)));
+}
+
+// Chase: a red runner leaving a fading trail
+struct ChaseState {
+    uint16_t pos;
+};
+
+static void chaseRender(void* state, CRGB* frame, int count) {
+    ChaseState* s = (ChaseState*)state;
+    pixelFade(frame, count, 100);
+    if (count > 0) {
+        if (s->pos >= count) s->pos = 0;
+        frame[s->pos++] = CRGB::Red;
+    }
+}
+
+// Sparkle: random white pixels fading out
+static void sparkleRender(void* state, CRGB* frame, int count) {
+    pixelFade(frame, count, 50);
+    if (random8() < 80 && count > 0) {
+        frame[random16(count)] = CRGB::White;
+    }
+}
+
+// Solid White: every LED at full white
+static void solidRender(void* state, CRGB* frame, int count) {
+    pixelFill(frame, count, CRGB::White);
+}
+
+// =============================================================================
+// Registry
+// =============================================================================
+// "next" cycles through this table in order
+
+static constexpr Effect effects[] = {
+    { "rainbow", sizeof(RainbowState), nullptr, rainbowRender,  nullptr },
+    { "breathe", 0,                    nullptr, breatheRender,  nullptr },
+    { "chase",   sizeof(ChaseState),   nullptr, chaseRender,    nullptr },
+    { "sparkle", 0,                    nullptr, sparkleRender,  nullptr },
+    { "solid",   0,                    nullptr, solidRender,    nullptr },
+};
+
+#define EFFECT_COUNT (sizeof(effects) / sizeof(effects[0]))
+
+static constexpr uint16_t largestEffectState() {
+    uint16_t largest = 0;
+    for (size_t i = 0; i < EFFECT_COUNT; i++) {
+        if (effects[i].stateSize > largest) largest = effects[i].stateSize;
+    }
+    return largest;
+}
+
+static constexpr bool effectsRenderable() {
+    for (size_t i = 0; i < EFFECT_COUNT; i++) {
+        if (!effects[i].render) return false;
+    }
+    return true;
+}
+
+static_assert(EFFECT_COUNT > 0 && EFFECT_COUNT < EFFECT_NONE, "Effect indexes are uint8_t");
+static_assert(largestEffectState() <= EFFECT_ARENA_BYTES, "An effect's state is larger than EFFECT_ARENA_BYTES");
+static_assert(effectsRenderable(), "Every effect needs a render function");
+
+uint8_t effectCount() {
+    return EFFECT_COUNT;
+}
+
+const Effect* effectAt(uint8_t index) {
+    return index < EFFECT_COUNT ? &effects[index] : nullptr;
+}
+
+uint16_t effectArenaUsed() {
+    return largestEffectState();
+}
+
+void renderEffectFrame(uint8_t index, CRGB* frame, int count) {
+    if (index >= EFFECT_COUNT) index = 0;
+    const Effect* effect = &effects[index];
+    
+    if (effectArena.active != index) {
+        if (effectArena.active < EFFECT_COUNT && effects[effectArena.active].teardown) {
+            effects[effectArena.active].teardown(effectArena.state);
+        }
+        memset(effectArena.state, 0, sizeof(effectArena.state));
+        effectArena.active = index;
+        if (effect->init) effect->init(effectArena.state);
+    }
+    
+    effect->render(effectArena.state, frame, count);
+}
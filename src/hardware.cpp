@@ -4,12 +4,16 @@
 
 #include "hardware.h"
 
+#ifdef HOST_SIM
+#include "sim.h"      // Overdrive slots are simulated; see sim_onewire.cpp
+#endif
+
 // =============================================================================
 // Global Hardware Objects (definitions)
 // =============================================================================
 OneWire oneWire(PIN_ONEWIRE);
-CRGB leds[MAX_TOTAL_LEDS];
-Adafruit_LIS3DH lis3dh = Adafruit_LIS3DH();
+alignas(4) static CRGB frameBuffers[2][MAX_TOTAL_LEDS];   // Word-aligned for pixel_ops
+CRGB* leds = frameBuffers[0];
 
 // =============================================================================
 // Global State Variables (definitions)
@@ -19,17 +23,16 @@ int cubeCount = 0;
 int totalLeds = 0;
 
 uint32_t lastPoll = 0;
-uint32_t lastAnim = 0;
 uint32_t lastAccel = 0;
-uint32_t lastOrientationCheck = 0;
-uint8_t animFrame = 0;
 uint8_t currentAnimation = 0;
 bool animationRunning = true;
 bool accelMode = false;
 bool lis3dhFound = false;
 bool ledsEnabled = true;
 
-volatile bool doubleTapDetected = false;
+bool accelIntPending = false;
+bool doubleTapDetected = false;
+static bool orientationChanged = false;     // INT1 may hold a 6D event to read
 
 uint8_t accelR = 0;
 uint8_t accelG = 0;
@@ -45,25 +48,129 @@ bool sleepRequested = false;
 // I2C Register Helper Functions
 // =============================================================================
 void writeReg(uint8_t reg, uint8_t val) {
-    Wire.beginTransmission(LIS3DH_ADDRESS);
-    Wire.write(reg);
-    Wire.write(val);
-    Wire.endTransmission();
+    writeRegs(reg, &val, 1);
 }
 
 uint8_t readReg(uint8_t reg) {
+    uint8_t val = 0xFF;
+    readRegs(reg, &val, 1);
+    return val;
+}
+
+// Consecutive registers in one transaction: the LIS3DH auto-increments the
+// register address when its MSB is set. Up to 127 bytes (the Wire buffer).
+void writeRegs(uint8_t reg, const uint8_t* vals, uint8_t count) {
     Wire.beginTransmission(LIS3DH_ADDRESS);
-    Wire.write(reg);
+    Wire.write(reg | 0x80);
+    Wire.write(vals, count);
     Wire.endTransmission();
-    Wire.requestFrom((uint8_t)LIS3DH_ADDRESS, (uint8_t)1);
-    return Wire.read();
+}
+
+// Repeated start between the address write and the read: one transaction.
+// Returns false (buf untouched past what arrived) on a NACK or short read.
+bool readRegs(uint8_t reg, uint8_t* buf, uint8_t count) {
+    Wire.beginTransmission(LIS3DH_ADDRESS);
+    Wire.write(reg | 0x80);
+    if (Wire.endTransmission(false) != 0) return false;
+    if (Wire.requestFrom((uint8_t)LIS3DH_ADDRESS, count) != count) return false;
+    for (uint8_t i = 0; i < count; i++) buf[i] = Wire.read();
+    return true;
 }
 
 // =============================================================================
-// Interrupt Service Routine
+// Interrupt Service Routines
 // =============================================================================
-void IRAM_ATTR onDoubleTap() {
-    doubleTapDetected = true;
+// The handlers only queue a timestamped event; loop() drains the queue once
+// per pass in serviceIsrEvents(), so edges that come faster than loop() are
+// kept in order with their time instead of collapsing into a flag.
+// Lock-free single producer / single consumer: both GPIO interrupts are
+// dispatched by the one GPIO ISR and never nest, loop() is the only reader.
+// head is only written by the ISR, tail only by loop().
+
+static IsrEvent isrEvents[ISR_EVENT_QUEUE_SIZE];
+static volatile uint8_t isrEventHead = 0;    // Next slot the ISR writes
+static volatile uint8_t isrEventTail = 0;    // Next slot loop() reads
+volatile uint32_t isrEventsDropped = 0;
+uint8_t isrEventPeak = 0;
+
+static volatile bool owEdgeQueued = false;  // A 1-Wire edge is waiting in the queue
+static uint32_t owBusIdleSinceUs = 0;       // End of our own last 1-Wire traffic
+static bool owEdgeUnsure = false;           // Edge during our traffic since the last search began
+static uint32_t accelEdgeUs = 0;            // Oldest INT1 edge not yet serviced
+static uint32_t accelSourceUs = 0;          // Edge behind the pending click / 6D read
+
+static_assert((ISR_EVENT_QUEUE_SIZE & (ISR_EVENT_QUEUE_SIZE - 1)) == 0 && ISR_EVENT_QUEUE_SIZE <= 128,
+              "ISR_EVENT_QUEUE_SIZE must be a power of 2 up to 128");
+
+static inline bool IRAM_ATTR isrEventPush(IsrEventType type) {
+    uint8_t head = isrEventHead;
+    if ((uint8_t)(head - isrEventTail) >= ISR_EVENT_QUEUE_SIZE) {
+        isrEventsDropped++;
+        return false;
+    }
+    IsrEvent* ev = &isrEvents[head & (ISR_EVENT_QUEUE_SIZE - 1)];
+    ev->us = micros();
+    ev->type = type;
+    __sync_synchronize();       // Event complete before it is published
+    isrEventHead = head + 1;
+    return true;
+}
+
+static bool isrEventPop(IsrEvent* ev) {
+    uint8_t tail = isrEventTail;
+    if (tail == isrEventHead) return false;
+    __sync_synchronize();
+    *ev = isrEvents[tail & (ISR_EVENT_QUEUE_SIZE - 1)];
+    // Before the slot is released, so an edge arriving now is queued again
+    if (ev->type == ISR_EVENT_ONEWIRE) owEdgeQueued = false;
+    __sync_synchronize();
+    isrEventTail = tail + 1;
+    return true;
+}
+
+// INT1 carries the click, 6D and FIFO watermark interrupts; serviceAccelFifo()
+// sorts them out
+void IRAM_ATTR onAccelInt() {
+    isrEventPush(ISR_EVENT_ACCEL);
+}
+
+// Every slot we send pulls the bus low too, so only one 1-Wire edge is
+// queued at a time; its timestamp tells ours from a hot-plug presence pulse
+void IRAM_ATTR onOneWireEdge() {
+    if (owEdgeQueued) return;
+    owEdgeQueued = isrEventPush(ISR_EVENT_ONEWIRE);
+}
+
+// Called every loop() pass (and after our own 1-Wire traffic): hands the
+// queued edges to the code that services them
+void serviceIsrEvents() {
+    uint8_t waiting = isrEventHead - isrEventTail;
+    if (waiting > isrEventPeak) isrEventPeak = waiting;
+    
+    IsrEvent ev;
+    while (isrEventPop(&ev)) {
+        switch (ev.type) {
+            case ISR_EVENT_ACCEL:
+                if (!accelIntPending) accelEdgeUs = ev.us;
+                accelIntPending = true;
+                break;
+            case ISR_EVENT_ONEWIRE:
+                // During our traffic a presence pulse can't be told from our
+                // own slots, so the next poll has to enumerate to be sure
+                if ((int32_t)(ev.us - owBusIdleSinceUs) > 0) {
+                    oneWireHotPlug = true;
+                } else {
+                    owEdgeUnsure = true;
+                }
+                break;
+        }
+    }
+}
+
+// Our own slots trip the edge interrupt: edges queued until now are ours
+static void oneWireBusReleased() {
+    owBusIdleSinceUs = micros();
+    serviceIsrEvents();
 }
 
 // =============================================================================
@@ -76,65 +183,267 @@ int freeRam() {
 // =============================================================================
 // LIS3DH Functions
 // =============================================================================
+// The LIS3DH queues samples in its 32-level FIFO (stream mode). When
+// ACCEL_FIFO_WATERMARK are waiting, INT1 rises and serviceAccelFifo() takes
+// them all in one burst read into a cache of timestamped samples, which
+// every consumer (LED color, "xyz", telemetry) reads instead of going to the
+// bus. Flips come from the LIS3DH's own 6D detection on the same pin.
+
+static AccelSample accelCache[ACCEL_CACHE_SIZE];
+static uint32_t accelCount = 0;             // Samples cached since boot
+static uint32_t accelPeriodUs = 1000000UL / ACCEL_DATA_RATE_HZ;
+static uint32_t accelLastDrainUs = 0;
+uint32_t accelFifoOverruns = 0;             // Drains that found the FIFO full (samples lost)
+
+static_assert((ACCEL_CACHE_SIZE & (ACCEL_CACHE_SIZE - 1)) == 0, "ACCEL_CACHE_SIZE must be a power of 2");
+static_assert(ACCEL_BURST_MAX * 6 <= 128, "ACCEL_BURST_MAX exceeds the Wire buffer");
+
+// Sensor configurations as register tables: each block is written in one
+// auto-increment transaction and read back to verify. Durations are in
+// output samples and given for ACCEL_DATA_RATE_HZ; setAccelDataRate()
+// rescales them.
+struct RegBlock {
+    uint8_t reg;
+    uint8_t count;
+    uint8_t vals[6];
+};
+
+static constexpr uint8_t accelOdrBits(uint16_t hz) {
+    return hz == 400 ? 0x07 : hz == 200 ? 0x06 : 0x05;     // CTRL_REG1 ODR: 400, 200, 100 Hz
+}
+
+static constexpr uint8_t accelRateScale(uint16_t hz) {
+    return hz == 400 ? 4 : hz == 200 ? 2 : 1;
+}
+
+// Click and 6D durations in output samples: the same time at every rate,
+// except where 400 Hz would overflow the register field. There TIME_LIMIT
+// (7 bits) is 317 ms and TIME_WINDOW (8 bits) 637 ms.
+static constexpr uint16_t accelTimeLimit(uint16_t hz) {
+    return hz == 400 ? 0x7F : 0x20 * accelRateScale(hz);   // 320ms
+}
+
+static constexpr uint16_t accelTimeLatency(uint16_t hz) {
+    return 0x10 * accelRateScale(hz);                       // 160ms
+}
+
+static constexpr uint16_t accelTimeWindow(uint16_t hz) {
+    return hz == 400 ? 0xFF : 0x70 * accelRateScale(hz);   // 1120ms
+}
+
+static constexpr uint16_t accelInt1Duration(uint16_t hz) {
+    return 0x02 * accelRateScale(hz);                       // 20ms
+}
+
+// Each duration must fit its field, and a double tap needs window left
+// after the latency
+static constexpr bool accelTimingValid(uint16_t hz) {
+    return accelTimeLimit(hz) <= 0x7F && accelTimeLatency(hz) <= 0xFF &&
+           accelTimeWindow(hz) <= 0xFF && accelInt1Duration(hz) <= 0x7F &&
+           accelTimeLatency(hz) < accelTimeWindow(hz);
+}
+
+static_assert(accelTimingValid(100) && accelTimingValid(200) && accelTimingValid(400),
+              "LIS3DH click/6D durations out of range at some data rate");
+
+#define ACCEL_CTRL_REG1(hz)     (uint8_t)((accelOdrBits(hz) << 4) | 0x07)  // ODR, X/Y/Z enabled
+#define ACCEL_TIME_LIMIT(hz)    (uint8_t)accelTimeLimit(hz)
+#define ACCEL_TIME_LATENCY(hz)  (uint8_t)accelTimeLatency(hz)
+#define ACCEL_TIME_WINDOW(hz)   (uint8_t)accelTimeWindow(hz)
+#define ACCEL_INT1_DURATION(hz) (uint8_t)accelInt1Duration(hz)
+
+// Double-tap (LED toggle, wake), 6D flips (sleep gesture) and the FIFO
+// watermark on INT1, samples queued in the FIFO
+static constexpr RegBlock accelActiveConfig[] = {
+    { 0x20, 6, { ACCEL_CTRL_REG1(ACCEL_DATA_RATE_HZ),   // CTRL_REG1
+                 0x04,      // CTRL_REG2: HP filter enabled for click
+                 0xC4,      // CTRL_REG3: I1_CLICK + I1_IA1 (6D) + I1_WTM (FIFO watermark)
+                 0x88,      // CTRL_REG4: BDU, high resolution, 2G
+                 0x48,      // CTRL_REG5: FIFO_EN, LIR_INT1 = 1 (latch interrupt)
+                 0x00 } },  // CTRL_REG6: INT1 active high
+    { 0x2E, 1, { 0x80 | ACCEL_FIFO_WATERMARK } },       // FIFO_CTRL_REG: stream, FTH
+    { 0x30, 1, { 0x7F } },  // INT1_CFG: Enable all axes, 6D movement (fires on change)
+    { 0x32, 2, { 0x20,      // INT1_THS: ~500mg threshold
+                 ACCEL_INT1_DURATION(ACCEL_DATA_RATE_HZ) } },
+    { 0x38, 1, { 0x20 } },  // CLICK_CFG: ZD enabled (double-tap on Z)
+    { 0x3A, 4, { 0x18,      // CLICK_THS: ~0.38G threshold
+                 ACCEL_TIME_LIMIT(ACCEL_DATA_RATE_HZ),
+                 ACCEL_TIME_LATENCY(ACCEL_DATA_RATE_HZ),
+                 ACCEL_TIME_WINDOW(ACCEL_DATA_RATE_HZ) } },
+};
+
+// Wake-on-tap only: click on INT1, FIFO off. Rate and click timing are the
+// active ones (endTelemetry() has restored them).
+static constexpr RegBlock accelSleepConfig[] = {
+    { 0x22, 4, { 0x80,      // CTRL_REG3: I1_CLICK only
+                 0x88,      // CTRL_REG4: BDU, high resolution, 2G
+                 0x08,      // CTRL_REG5: FIFO off, LIR_INT1 = 1
+                 0x00 } },  // CTRL_REG6: INT1 active high
+};
+
+static constexpr bool regBlocksValid(const RegBlock* blocks, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        const RegBlock& b = blocks[i];
+        if (b.count == 0 || b.count > sizeof(b.vals) || b.reg + b.count > 0x40) return false;
+        // No read-only or clear-on-read registers (STATUS, OUT, FIFO_SRC, *_SRC)
+        for (uint8_t r = b.reg; r < b.reg + b.count; r++) {
+            if ((r >= 0x27 && r <= 0x2D) || r == 0x2F || r == 0x31 || r == 0x35 || r == 0x39) return false;
+        }
+    }
+    return true;
+}
+
+#define REG_BLOCK_COUNT(t) (sizeof(t) / sizeof(t[0]))
+
+static_assert(regBlocksValid(accelActiveConfig, REG_BLOCK_COUNT(accelActiveConfig)), "bad accelActiveConfig");
+static_assert(regBlocksValid(accelSleepConfig, REG_BLOCK_COUNT(accelSleepConfig)), "bad accelSleepConfig");
+
+// Writes every block, then reads each back. Returns the number of registers
+// that did not take their value (0: configuration verified).
+static int applyAccelConfig(const RegBlock* blocks, size_t count) {
+    for (size_t i = 0; i < count; i++) writeRegs(blocks[i].reg, blocks[i].vals, blocks[i].count);
+    
+    int mismatches = 0;
+    for (size_t i = 0; i < count; i++) {
+        const RegBlock& b = blocks[i];
+        uint8_t readback[sizeof(b.vals)];
+        if (!readRegs(b.reg, readback, b.count)) return b.count;
+        for (uint8_t r = 0; r < b.count; r++) {
+            if (readback[r] == b.vals[r]) continue;
+            mismatches++;
+            Serial.print(F("LIS3DH reg 0x")); Serial.print(b.reg + r, HEX);
+            Serial.print(F(" = 0x")); Serial.print(readback[r], HEX);
+            Serial.print(F(", expected 0x")); Serial.println(b.vals[r], HEX);
+        }
+    }
+    return mismatches;
+}
+
+// One read through INT1_SRC..CLICK_SRC clears both latched interrupt sources
+static void clearAccelInterrupts() {
+    uint8_t src[0x39 - 0x31 + 1];
+    readRegs(0x31, src, sizeof(src));
+}
 
-bool initLIS3DH() {
-    Wire.begin(PIN_I2C_SDA, PIN_I2C_SCL);
+// verbose = false skips the banner (fast wake path)
+bool initLIS3DH(bool verbose) {
+    Wire.begin(PIN_I2C_SDA, PIN_I2C_SCL, ACCEL_I2C_HZ);
     
-    if (!lis3dh.begin(LIS3DH_ADDRESS)) {
+    if (readReg(0x0F) != 0x33) {   // WHO_AM_I
         Serial.println(F("LIS3DH not found!"));
         return false;
     }
     
-    Serial.println(F("LIS3DH found!"));
-    
-    // Configure LIS3DH
-    lis3dh.setRange(LIS3DH_RANGE_2_G);
-    lis3dh.setDataRate(LIS3DH_DATARATE_100_HZ);
-    
-    // Configure double-tap detection for LED toggle and wake
-    writeReg(0x21, 0x04);  // CTRL_REG2: HP filter enabled for click
-    writeReg(0x22, 0x80);  // CTRL_REG3: I1_CLICK enabled
-    writeReg(0x24, 0x08);  // CTRL_REG5: LIR_INT1 = 1 (latch interrupt)
-    writeReg(0x25, 0x00);  // CTRL_REG6: INT1 active high
-    writeReg(0x38, 0x20);  // CLICK_CFG: ZD enabled (double-tap on Z)
-    
-    // Click timing parameters
-    writeReg(0x3A, 0x18);  // CLICK_THS: ~0.38G threshold
-    writeReg(0x3B, 0x20);  // TIME_LIMIT: 320ms
-    writeReg(0x3C, 0x10);  // TIME_LATENCY: 160ms
-    writeReg(0x3D, 0x70);  // TIME_WINDOW: 1120ms
-    
-    // Configure 6D orientation detection (for sleep trigger)
-    writeReg(0x30, 0x7F);  // INT1_CFG: Enable all axes, OR combination, 6D enabled
-    writeReg(0x32, 0x20);  // INT1_THS: ~500mg threshold
-    writeReg(0x33, 0x02);  // INT1_DURATION: 20ms at 100Hz
-    
-    // Clear any pending interrupts
-    readReg(0x39);  // Read CLICK_SRC
-    readReg(0x31);  // Read INT1_SRC
+    // Bypass empties the FIFO; the table restarts it in stream mode
+    writeReg(0x2E, 0x00);   // FIFO_CTRL_REG: bypass
+    int mismatches = applyAccelConfig(accelActiveConfig, REG_BLOCK_COUNT(accelActiveConfig));
+    accelPeriodUs = 1000000UL / ACCEL_DATA_RATE_HZ;
+    accelLastDrainUs = micros();
+    clearAccelInterrupts();
+    if (mismatches) {
+        Serial.println(F("LIS3DH configuration failed!"));
+        return false;
+    }
     
     // Setup hardware interrupt
     pinMode(PIN_LIS3DH_INT, INPUT);
-    attachInterrupt(digitalPinToInterrupt(PIN_LIS3DH_INT), onDoubleTap, RISING);
+    attachInterrupt(digitalPinToInterrupt(PIN_LIS3DH_INT), onAccelInt, RISING);
+    
+    if (!verbose) return true;
     
+    Serial.println(F("LIS3DH found!"));
     Serial.println(F("  Double-tap detection enabled"));
     Serial.println(F("  Tap Z-axis to toggle LEDs"));
     Serial.println(F("  Flip upside down twice within 2s to sleep"));
+    Serial.print(F("  Configuration verified: "));
+    Serial.print(REG_BLOCK_COUNT(accelActiveConfig));
+    Serial.print(F(" register blocks, 2G, "));
+    Serial.print(ACCEL_DATA_RATE_HZ);
+    Serial.println(F(" Hz"));
     
-    // Debug register readback
-    Serial.print(F("  CTRL_REG3: 0x")); Serial.println(readReg(0x22), HEX);
-    Serial.print(F("  CTRL_REG5: 0x")); Serial.println(readReg(0x24), HEX);
-    Serial.print(F("  CLICK_CFG: 0x")); Serial.println(readReg(0x38), HEX);
-    Serial.print(F("  INT1_CFG: 0x")); Serial.println(readReg(0x30), HEX);
+    return true;
+}
+
+// The click and 6D durations count output samples, so they are rewritten
+// with each rate to stay the same in milliseconds. 100, 200 or 400 Hz.
+void setAccelDataRate(uint16_t hz) {
+    const uint8_t timing[] = { ACCEL_TIME_LIMIT(hz), ACCEL_TIME_LATENCY(hz), ACCEL_TIME_WINDOW(hz) };
+    writeReg(0x20, ACCEL_CTRL_REG1(hz));        // CTRL_REG1
+    writeRegs(0x3B, timing, sizeof(timing));    // TIME_LIMIT, TIME_LATENCY, TIME_WINDOW
+    writeReg(0x33, ACCEL_INT1_DURATION(hz));    // INT1_DURATION
+    accelPeriodUs = 1000000UL / (accelRateScale(hz) * 100);
+}
+
+// One burst read of the oldest samples (OUT_X_L..OUT_Z_H wraps around in
+// FIFO mode) out of the n queued. The newest queued sample was taken about
+// now, the others one period apart before it. Returns the count read.
+static uint8_t accelReadFifo(uint8_t n, uint32_t now) {
+    uint8_t burst = n < ACCEL_BURST_MAX ? n : ACCEL_BURST_MAX;
+    uint32_t us = now - (uint32_t)(n - 1) * accelPeriodUs;
+    uint8_t raw[ACCEL_BURST_MAX * 6];
+    if (!readRegs(0x28, raw, burst * 6)) return 0;     // OUT_X_L
+    for (uint8_t i = 0; i < burst; i++) {
+        const uint8_t* r = &raw[i * 6];
+        AccelSample* s = &accelCache[accelCount++ & (ACCEL_CACHE_SIZE - 1)];
+        s->us = us;
+        s->x = r[0] | (r[1] << 8);
+        s->y = r[2] | (r[3] << 8);
+        s->z = r[4] | (r[5] << 8);
+        us += accelPeriodUs;
+    }
+    return burst;
+}
+
+// Called every loop() pass: drains the FIFO when INT1 says the watermark is
+// reached (or, should an edge be missed, after twice the expected time).
+// One burst per pass; a backlog (e.g. after the blocking boot scan) keeps
+// INT1 high and is taken over the next passes. INT1 still high with the FIFO
+// below the watermark is a click or a 6D change, left to handleDoubleTap()
+// and checkOrientation() to read from their source registers.
+// Returns true if new samples were cached.
+bool serviceAccelFifo() {
+    if (!lis3dhFound) return false;
+    uint32_t now = micros();
+    bool pinHigh = digitalRead(PIN_LIS3DH_INT) == HIGH;
+    bool overdue = now - accelLastDrainUs >= 2 * ACCEL_FIFO_WATERMARK * accelPeriodUs;
+    if (!accelIntPending && !pinHigh && !overdue) return false;
+    // Latency is measured from the edge; INT1 already high has none
+    uint32_t edgeUs = accelIntPending ? accelEdgeUs : now;
+    accelIntPending = false;
     
-    Serial.print(F("  Range: "));
-    switch (lis3dh.getRange()) {
-        case LIS3DH_RANGE_2_G:  Serial.println(F("2G")); break;
-        case LIS3DH_RANGE_4_G:  Serial.println(F("4G")); break;
-        case LIS3DH_RANGE_8_G:  Serial.println(F("8G")); break;
-        case LIS3DH_RANGE_16_G: Serial.println(F("16G")); break;
+    uint8_t src = readReg(0x2F);       // FIFO_SRC_REG
+    uint8_t n = src & 0x1F;            // FSS: unread samples
+    if (src & 0x40) {                  // OVRN_FIFO: full, the oldest were lost
+        accelFifoOverruns++;
+        n = 32;
+    }
+    uint8_t read = 0;
+    if ((src & 0x80) || overdue) {
+        if (n) read = accelReadFifo(n, now);
+        accelLastDrainUs = now;
+        if (src & 0x80) perfRecordUs(PERF_FIFO_LATENCY, micros() - edgeUs);
     }
     
+    if (n - read < ACCEL_FIFO_WATERMARK && digitalRead(PIN_LIS3DH_INT) == HIGH) {
+        doubleTapDetected = true;
+        orientationChanged = true;
+        accelSourceUs = (src & 0x80) ? now : edgeUs;    // A watermark edge was the drain's
+    }
+    return read > 0;
+}
+
+const AccelSample* accelLatest() {
+    return accelCount ? &accelCache[(accelCount - 1) & (ACCEL_CACHE_SIZE - 1)] : nullptr;
+}
+
+uint32_t accelSampleCount() {
+    return accelCount;
+}
+
+// Sample number seq (0 = first since boot); false once it has been overwritten
+bool accelGetSample(uint32_t seq, AccelSample* sample) {
+    if (seq >= accelCount || accelCount - seq > ACCEL_CACHE_SIZE) return false;
+    *sample = accelCache[seq & (ACCEL_CACHE_SIZE - 1)];
     return true;
 }
 
@@ -144,6 +453,8 @@ void handleDoubleTap() {
     
     // Read CLICK_SRC to get tap info and clear the interrupt
     uint8_t clickSrc = readReg(0x39);
+    if (!(clickSrc & 0x40)) return;     // No click after all (FIFO watermark)
+    perfRecordUs(PERF_TAP_LATENCY, micros() - accelSourceUs);
     
     // Debug output
     Serial.print(F("INT fired! CLICK_SRC: 0x"));
@@ -155,11 +466,6 @@ void handleDoubleTap() {
         
         Serial.print(F("Double-tap detected! LEDs: "));
         Serial.println(ledsEnabled ? F("ON") : F("OFF"));
-        
-        if (!ledsEnabled) {
-            fill_solid(leds, MAX_TOTAL_LEDS, CRGB::Black);
-            FastLED.show();
-        }
     } else if (clickSrc & 0x10) {
         // Single tap detected (bit 4)
         Serial.println(F("Single tap detected (need double-tap)"));
@@ -167,13 +473,12 @@ void handleDoubleTap() {
 }
 
 void updateAccelerometer() {
-    if (!lis3dhFound) return;
+    const AccelSample* s = accelLatest();
+    if (!s) return;
     
-    lis3dh.read();
-    
-    int16_t x = lis3dh.x;
-    int16_t y = lis3dh.y;
-    int16_t z = lis3dh.z;
+    int16_t x = s->x;
+    int16_t y = s->y;
+    int16_t z = s->z;
     
     accelR = constrain(abs(x) / 64, 0, 255);
     accelG = constrain(abs(y) / 64, 0, 255);
@@ -186,19 +491,29 @@ void printAccelData() {
         return;
     }
     
-    lis3dh.read();
+    const AccelSample* s = accelLatest();
+    if (!s) {
+        Serial.println(F("No accelerometer samples yet"));
+        return;
+    }
     
     Serial.println(F("\n=== Accelerometer Data ==="));
-    Serial.print(F("Raw X: ")); Serial.print(lis3dh.x);
-    Serial.print(F("  Y: ")); Serial.print(lis3dh.y);
-    Serial.print(F("  Z: ")); Serial.println(lis3dh.z);
+    Serial.print(F("Raw X: ")); Serial.print(s->x);
+    Serial.print(F("  Y: ")); Serial.print(s->y);
+    Serial.print(F("  Z: ")); Serial.println(s->z);
     
-    sensors_event_t event;
-    lis3dh.getEvent(&event);
+    const float scale = SENSORS_GRAVITY_STANDARD / ACCEL_LSB_PER_G;
+    Serial.print(F("Accel (m/s²) X: ")); Serial.print(s->x * scale, 2);
+    Serial.print(F("  Y: ")); Serial.print(s->y * scale, 2);
+    Serial.print(F("  Z: ")); Serial.println(s->z * scale, 2);
     
-    Serial.print(F("Accel (m/s²) X: ")); Serial.print(event.acceleration.x, 2);
-    Serial.print(F("  Y: ")); Serial.print(event.acceleration.y, 2);
-    Serial.print(F("  Z: ")); Serial.println(event.acceleration.z, 2);
+    Serial.print(F("Sample age: "));
+    Serial.print((micros() - s->us) / 1000);
+    Serial.print(F(" ms ("));
+    Serial.print(accelSampleCount());
+    Serial.print(F(" cached, "));
+    Serial.print(accelFifoOverruns);
+    Serial.println(F(" FIFO overruns)"));
     
     Serial.print(F("LED Color -> R: ")); Serial.print(accelR);
     Serial.print(F("  G: ")); Serial.print(accelG);
@@ -214,31 +529,97 @@ void printAccelData() {
 // =============================================================================
 // Sleep Functions
 // =============================================================================
+// The cube table and animation state are kept in RTC slow memory, which
+// survives deep sleep, so a double-tap wake can render immediately instead of
+// rescanning the bus. The copy is only trusted if its magic, size and CRC
+// match; any other reset leaves it invalid.
+
+#define RETAINED_MAGIC  0x43554245  // "CUBE"
+
+struct RetainedState {
+    uint32_t magic;
+    uint16_t size;
+    Cube cubes[MAX_CUBES];
+    int cubeCount;
+    int totalLeds;
+    uint8_t currentAnimation;
+    bool animationRunning;
+    bool accelMode;
+    bool ledsEnabled;
+    EffectArena effect;
+    uint16_t crc;               // CRC16 of everything above
+};
+
+RTC_DATA_ATTR static RetainedState retained;
+
+static uint16_t retainedCrc() {
+    return OneWire::crc16((const uint8_t*)&retained, offsetof(RetainedState, crc));
+}
+
+void saveRetainedState() {
+    memset(&retained, 0, sizeof(retained));
+    retained.magic = RETAINED_MAGIC;
+    retained.size = sizeof(RetainedState);
+    memcpy(retained.cubes, cubes, sizeof(cubes));
+    retained.cubeCount = cubeCount;
+    retained.totalLeds = totalLeds;
+    retained.currentAnimation = currentAnimation;
+    retained.animationRunning = animationRunning;
+    retained.accelMode = accelMode;
+    retained.ledsEnabled = ledsEnabled;
+    retained.effect = effectArena;
+    retained.crc = retainedCrc();
+}
+
+// Returns false (and leaves the globals alone) if nothing valid was retained
+bool restoreRetainedState() {
+    bool valid = retained.magic == RETAINED_MAGIC && retained.size == sizeof(RetainedState) &&
+                 retained.crc == retainedCrc() &&
+                 retained.cubeCount >= 0 && retained.cubeCount <= MAX_CUBES &&
+                 retained.totalLeds >= 0 && retained.totalLeds <= MAX_TOTAL_LEDS;
+    retained.magic = 0;     // One use: a later reset must not restore stale state
+    if (!valid) return false;
+
+    memcpy(cubes, retained.cubes, sizeof(cubes));
+    cubeCount = retained.cubeCount;
+    totalLeds = retained.totalLeds;
+    currentAnimation = retained.currentAnimation;
+    animationRunning = retained.animationRunning;
+    accelMode = retained.accelMode;
+    ledsEnabled = retained.ledsEnabled;
+    effectArena = retained.effect;
+    for (int i = 0; i < cubeCount; i++) cubes[i].flashUntil = 0;   // millis() restarted
+    publishRenderLayout();
+    return true;
+}
 
 void enterDeepSleep() {
     Serial.println(F("\n=== Entering Deep Sleep ==="));
     Serial.println(F("Double-tap to wake up"));
+    endTelemetry();     // Wake detection runs at the normal rate
     Serial.flush();
     
+    // Take the LEDs back from the render task for the fade
+    stopRenderTask();
+    
     // Fade LEDs to black
-    for (int brightness = 100; brightness >= 0; brightness -= 5) {
-        FastLED.setBrightness(brightness);
-        FastLED.show();
+    RenderLayout layout;
+    buildRenderLayout(&layout);
+    for (int brightness = LED_BRIGHTNESS; brightness >= 0; brightness -= 5) {
+        ledOutputShow(leds, &layout, brightness, LED_ALL_SEGMENTS);
         delay(SLEEP_FADE_MS / 20);
     }
     
-    // Turn off all LEDs
+    // Turn off all LEDs; the frame must be out before the RMT powers down
     fill_solid(leds, MAX_TOTAL_LEDS, CRGB::Black);
-    FastLED.show();
+    ledOutputClear();
+    ledOutputWait();
     
     // Reconfigure LIS3DH for wake-on-tap only
-    writeReg(0x30, 0x00);  // INT1_CFG = 0 (disable 6D)
-    writeReg(0x22, 0x80);  // CTRL_REG3: I1_CLICK enabled
-    writeReg(0x38, 0x20);  // CLICK_CFG: ZD enabled (double-tap on Z)
-    
-    // Clear any pending interrupts
-    readReg(0x39);  // Read CLICK_SRC
-    readReg(0x31);  // Read INT1_SRC
+    if (applyAccelConfig(accelSleepConfig, REG_BLOCK_COUNT(accelSleepConfig))) {
+        Serial.println(F("LIS3DH sleep configuration failed, tap wake may not work"));
+    }
+    readReg(0x39);  // Clear CLICK_SRC (the only source left on INT1)
     
     // Configure ESP32-C3 GPIO wakeup
     esp_deep_sleep_enable_gpio_wakeup(BIT(D1), ESP_GPIO_WAKEUP_GPIO_HIGH);
@@ -246,41 +627,55 @@ void enterDeepSleep() {
     // Small delay to ensure everything is settled
     delay(100);
     
+    cubeCacheFlush();
+    saveRetainedState();
+    
     // Enter deep sleep
     esp_deep_sleep_start();
 }
 
+// Runs the double-flip state machine on 6D movement events: the LIS3DH
+// latches the new position in INT1_SRC whenever gravity moves to another
+// axis, so nothing is polled. Only the window timeout is checked every pass.
 void checkOrientation() {
     if (!lis3dhFound) return;
     
-    // Read accelerometer
-    lis3dh.read();
-    int16_t z = lis3dh.z;
-    
-    // Check if cube is upside down (Z-axis negative, around -16384 at 2G)
-    bool currentlyUpsideDown = (z < -8000);
-    
-    // Detect transition from right-side-up to upside-down
-    if (currentlyUpsideDown && !isUpsideDown) {
-        uint32_t now = millis();
+    if (orientationChanged) {
+        orientationChanged = false;
         
-        if (flipCount == 0) {
-            // First flip detected
-            flipCount = 1;
-            firstFlipTime = now;
-            Serial.println(F("First flip detected (upside down)"));
-        }
-        else if (flipCount == 1 && (now - firstFlipTime) < FLIP_DETECT_WINDOW_MS) {
-            // Second flip within time window
-            flipCount = 2;
-            Serial.println(F("Second flip detected - initiating sleep!"));
-            sleepRequested = true;
-        }
-        else if ((now - firstFlipTime) >= FLIP_DETECT_WINDOW_MS) {
-            // Time window expired, restart count
-            flipCount = 1;
-            firstFlipTime = now;
-            Serial.println(F("First flip detected (timer reset)"));
+        // Read INT1_SRC to get the position and clear the interrupt
+        uint8_t int1Src = readReg(0x31);
+        if (int1Src & 0x40) {
+            perfRecordUs(PERF_6D_LATENCY, micros() - accelSourceUs);
+            
+            // ZL: Z axis below -500mg, cube is upside down
+            bool currentlyUpsideDown = (int1Src & 0x3F) == 0x10;
+            
+            // Detect transition from right-side-up to upside-down
+            if (currentlyUpsideDown && !isUpsideDown) {
+                uint32_t now = millis();
+                
+                if (flipCount == 0) {
+                    // First flip detected
+                    flipCount = 1;
+                    firstFlipTime = now;
+                    Serial.println(F("First flip detected (upside down)"));
+                }
+                else if (flipCount == 1 && (now - firstFlipTime) < FLIP_DETECT_WINDOW_MS) {
+                    // Second flip within time window
+                    flipCount = 2;
+                    Serial.println(F("Second flip detected - initiating sleep!"));
+                    sleepRequested = true;
+                }
+                else if ((now - firstFlipTime) >= FLIP_DETECT_WINDOW_MS) {
+                    // Time window expired, restart count
+                    flipCount = 1;
+                    firstFlipTime = now;
+                    Serial.println(F("First flip detected (timer reset)"));
+                }
+            }
+            
+            isUpsideDown = currentlyUpsideDown;
         }
     }
     
@@ -291,8 +686,256 @@ void checkOrientation() {
         }
         flipCount = 0;
     }
-    
-    isUpsideDown = currentlyUpsideDown;
+}
+
+// =============================================================================
+// 1-Wire Transport
+// =============================================================================
+// All DS2431 traffic goes through these helpers so it can run at overdrive
+// speed (slots ~7x shorter). The PJRC library only drives standard speed, so
+// the overdrive reset and slots are bit-banged here with its GPIO macros.
+//
+// Overdrive Skip ROM after a standard reset moves every capable device to
+// overdrive until the next standard reset. A device that stays silent at
+// overdrive but answers at standard speed is remembered as standard-only: it
+// is always addressed after a standard reset, and while one is known the bus
+// is searched at standard speed. Devices that never follow Overdrive Skip are
+// found by a standard-speed enumeration every ONEWIRE_STANDARD_SCAN_MS.
+
+bool oneWireOverdrive = true;
+static bool owInOverdrive = false;          // Capable devices are at overdrive speed
+static uint64_t owStandardOnly[MAX_CUBES];
+static int owStandardOnlyCount = 0;
+
+#ifdef HOST_SIM
+static uint8_t odReset() { return simOneWireResetOverdrive(); }
+static void odWriteBit(uint8_t v) { simOneWireWriteBitOverdrive(v); }
+static uint8_t odReadBit() { return simOneWireReadBitOverdrive(); }
+static void odRelease() {}
+#else
+// Overdrive timing in 0.1 us (Maxim AN126, overdrive column)
+#define OD_A    10
+#define OD_B    75
+#define OD_C    75
+#define OD_D    25
+#define OD_E    10
+#define OD_F    70
+#define OD_H    700
+#define OD_I    85
+#define OD_J    400
+
+// Busy-wait on the cycle counter; delayMicroseconds() is too coarse here
+static inline void IRAM_ATTR odWait(uint32_t tenthsUs) {
+    uint32_t start = ESP.getCycleCount();
+    uint32_t cycles = tenthsUs * (F_CPU / 10000000);
+    while (ESP.getCycleCount() - start < cycles) {}
+}
+
+static uint8_t IRAM_ATTR odReset() {
+    IO_REG_TYPE mask IO_REG_MASK_ATTR = PIN_TO_BITMASK(PIN_ONEWIRE);
+    volatile IO_REG_TYPE* reg IO_REG_BASE_ATTR = PIN_TO_BASEREG(PIN_ONEWIRE);
+    uint8_t r;
+
+    noInterrupts();
+    DIRECT_WRITE_LOW(reg, mask);
+    DIRECT_MODE_OUTPUT(reg, mask);
+    odWait(OD_H);
+    DIRECT_MODE_INPUT(reg, mask);
+    odWait(OD_I);
+    r = !DIRECT_READ(reg, mask);
+    interrupts();
+    odWait(OD_J);
+    return r;
+}
+
+static void IRAM_ATTR odWriteBit(uint8_t v) {
+    IO_REG_TYPE mask IO_REG_MASK_ATTR = PIN_TO_BITMASK(PIN_ONEWIRE);
+    volatile IO_REG_TYPE* reg IO_REG_BASE_ATTR = PIN_TO_BASEREG(PIN_ONEWIRE);
+
+    noInterrupts();
+    DIRECT_WRITE_LOW(reg, mask);
+    DIRECT_MODE_OUTPUT(reg, mask);
+    odWait((v & 1) ? OD_A : OD_C);
+    DIRECT_WRITE_HIGH(reg, mask);
+    interrupts();
+    odWait((v & 1) ? OD_B : OD_D);
+}
+
+static uint8_t IRAM_ATTR odReadBit() {
+    IO_REG_TYPE mask IO_REG_MASK_ATTR = PIN_TO_BITMASK(PIN_ONEWIRE);
+    volatile IO_REG_TYPE* reg IO_REG_BASE_ATTR = PIN_TO_BASEREG(PIN_ONEWIRE);
+    uint8_t r;
+
+    noInterrupts();
+    DIRECT_MODE_OUTPUT(reg, mask);
+    DIRECT_WRITE_LOW(reg, mask);
+    odWait(OD_A);
+    DIRECT_MODE_INPUT(reg, mask);
+    odWait(OD_E);
+    r = DIRECT_READ(reg, mask);
+    interrupts();
+    odWait(OD_F);
+    return r;
+}
+
+// Stop driving the bus high after a write (PJRC write() with power = 0)
+static void odRelease() {
+    IO_REG_TYPE mask IO_REG_MASK_ATTR = PIN_TO_BITMASK(PIN_ONEWIRE);
+    volatile IO_REG_TYPE* reg IO_REG_BASE_ATTR = PIN_TO_BASEREG(PIN_ONEWIRE);
+
+    noInterrupts();
+    DIRECT_MODE_INPUT(reg, mask);
+    DIRECT_WRITE_LOW(reg, mask);
+    interrupts();
+}
+#endif
+
+static bool owIsStandardOnly(uint64_t romId) {
+    for (int i = 0; i < owStandardOnlyCount; i++) {
+        if (owStandardOnly[i] == romId) return true;
+    }
+    return false;
+}
+
+static void owMarkStandardOnly(uint64_t romId) {
+    if (owIsStandardOnly(romId) || owStandardOnlyCount >= MAX_CUBES) return;
+    owStandardOnly[owStandardOnlyCount++] = romId;
+    Serial.print(F("  No overdrive response, using standard speed for "));
+    Serial.println((unsigned long)(romId & 0xFFFFFFFF), HEX);
+}
+
+static void owForgetDevice(uint64_t romId) {
+    for (int i = 0; i < owStandardOnlyCount; i++) {
+        if (owStandardOnly[i] == romId) {
+            owStandardOnly[i] = owStandardOnly[--owStandardOnlyCount];
+            return;
+        }
+    }
+}
+
+static bool owDeviceOverdrive(uint64_t romId) {
+    return oneWireOverdrive && !owIsStandardOnly(romId);
+}
+
+static bool owSearchOverdrive() {
+    return oneWireOverdrive && owStandardOnlyCount == 0;
+}
+
+// Reset at the requested speed. Entering overdrive costs one standard reset
+// plus Overdrive Skip; later overdrive resets are ~8x shorter. Falls back to
+// a standard reset when nothing answers at overdrive speed.
+static bool owReset(bool overdrive) {
+    if (overdrive) {
+        if (!owInOverdrive) {
+            if (!oneWire.reset()) return false;
+            oneWire.write(0x3C);
+            owInOverdrive = true;
+        }
+        if (odReset()) return true;
+    }
+    owInOverdrive = false;
+    return oneWire.reset();
+}
+
+static void owWriteBit(uint8_t v) {
+    if (owInOverdrive) odWriteBit(v);
+    else oneWire.write_bit(v);
+}
+
+static uint8_t owReadBit() {
+    return owInOverdrive ? odReadBit() : oneWire.read_bit();
+}
+
+static void owWrite(uint8_t v) {
+    if (!owInOverdrive) {
+        oneWire.write(v);
+        return;
+    }
+    for (uint8_t bitMask = 0x01; bitMask; bitMask <<= 1) {
+        odWriteBit((bitMask & v) ? 1 : 0);
+    }
+    odRelease();
+}
+
+static uint8_t owRead() {
+    if (!owInOverdrive) return oneWire.read();
+    uint8_t r = 0;
+    for (uint8_t bitMask = 0x01; bitMask; bitMask <<= 1) {
+        if (odReadBit()) r |= bitMask;
+    }
+    return r;
+}
+
+// Reset and Match ROM one device
+static bool owSelect(const uint8_t* addr, bool overdrive) {
+    if (!owReset(overdrive)) return false;
+    owWrite(0x55);
+    for (int i = 0; i < 8; i++) owWrite(addr[i]);
+    return true;
+}
+
+// One search triplet (id bit, complement, direction) with the same
+// bookkeeping as OneWire::search(). Returns false if no device answered.
+static bool owSearchTriplet(uint8_t* rom, uint8_t bitNumber, uint8_t lastDiscrepancy, uint8_t* lastZero) {
+    uint8_t byteNumber = (bitNumber - 1) / 8;
+    uint8_t byteMask = 1 << ((bitNumber - 1) % 8);
+
+    uint8_t idBit = owReadBit();
+    uint8_t cmpIdBit = owReadBit();
+    if (idBit && cmpIdBit) return false;
+
+    uint8_t direction;
+    if (idBit != cmpIdBit) {
+        direction = idBit;
+    } else {
+        if (bitNumber < lastDiscrepancy) {
+            direction = (rom[byteNumber] & byteMask) ? 1 : 0;
+        } else {
+            direction = (bitNumber == lastDiscrepancy);
+        }
+        if (direction == 0) *lastZero = bitNumber;
+    }
+
+    if (direction) rom[byteNumber] |= byteMask;
+    else rom[byteNumber] &= ~byteMask;
+    owWriteBit(direction);
+    return true;
+}
+
+// Blocking search with the OneWire::reset_search()/search() interface
+static uint8_t owSearchRom[8];
+static uint8_t owLastDiscrepancy = 0;
+static bool owLastDevice = false;
+
+void owResetSearch() {
+    memset(owSearchRom, 0, sizeof(owSearchRom));
+    owLastDiscrepancy = 0;
+    owLastDevice = false;
+    owInOverdrive = false;      // Re-issue Overdrive Skip for newly attached devices
+}
+
+bool owSearch(uint8_t* addr) {
+    if (owLastDevice || !owReset(owSearchOverdrive())) {
+        oneWireBusReleased();
+        owResetSearch();
+        return false;
+    }
+    owWrite(0xF0);
+
+    uint8_t lastZero = 0;
+    for (uint8_t bitNumber = 1; bitNumber <= 64; bitNumber++) {
+        if (!owSearchTriplet(owSearchRom, bitNumber, owLastDiscrepancy, &lastZero)) {
+            oneWireBusReleased();
+            owResetSearch();
+            return false;
+        }
+    }
+    oneWireBusReleased();
+
+    owLastDiscrepancy = lastZero;
+    owLastDevice = (lastZero == 0);
+    memcpy(addr, owSearchRom, 8);
+    return true;
 }
 
 // =============================================================================
@@ -318,237 +961,1973 @@ bool isDS2431(uint8_t* addr) {
     return (OneWire::crc8(addr, 7) == addr[7]);
 }
 
-bool ds2431ReadPage(uint8_t* addr, uint8_t page, uint8_t* buffer) {
-    if (!oneWire.reset()) return false;
-    
-    oneWire.select(addr);
-    oneWire.write(0xF0);
-    oneWire.write(page * 32);
-    oneWire.write(0x00);
-    
-    for (int i = 0; i < 32; i++) {
-        buffer[i] = oneWire.read();
+static bool isBlank(const uint8_t* data, int len) {
+    for (int i = 0; i < len; i++) {
+        if (data[i] != 0xFF) return false;
     }
     return true;
 }
 
-bool ds2431Write8(uint8_t* addr, uint8_t offset, uint8_t* data) {
-    if (!oneWire.reset()) return false;
-    oneWire.select(addr);
-    oneWire.write(0x0F);
-    oneWire.write(offset);
-    oneWire.write(0x00);
-    for (int i = 0; i < 8; i++) {
-        oneWire.write(data[i]);
-    }
-    
-    if (!oneWire.reset()) return false;
-    oneWire.select(addr);
-    oneWire.write(0xAA);
-    uint8_t ta1 = oneWire.read();
-    uint8_t ta2 = oneWire.read();
-    uint8_t es = oneWire.read();
-    
-    for (int i = 0; i < 8; i++) {
-        if (oneWire.read() != data[i]) return false;
+static bool ds2431ReadAt(uint8_t* addr, uint8_t start, uint8_t* buffer, int len, bool overdrive) {
+    bool present = owSelect(addr, overdrive);
+    if (present) {
+        owWrite(0xF0);
+        owWrite(start);
+        owWrite(0x00);
+        
+        for (int i = 0; i < len; i++) {
+            buffer[i] = owRead();
+        }
     }
-    
-    if (!oneWire.reset()) return false;
-    oneWire.select(addr);
-    oneWire.write(0x55);
-    oneWire.write(ta1);
-    oneWire.write(ta2);
-    oneWire.write(es);
-    
-    delay(15);
-    return (oneWire.read() == 0xAA);
+    oneWireBusReleased();
+    return present;
 }
 
-bool ds2431WritePage(uint8_t* addr, uint8_t page, uint8_t* data) {
-    uint8_t offset = page * 32;
-    for (int chunk = 0; chunk < 4; chunk++) {
-        if (!ds2431Write8(addr, offset + (chunk * 8), data + (chunk * 8))) {
-            return false;
-        }
+// A device that ignored Overdrive Skip reads as all ones; retry it at
+// standard speed and remember it if it answers there.
+static bool ds2431Read(uint8_t* addr, uint8_t start, uint8_t* buffer, int len) {
+    uint64_t romId = addressToId(addr);
+    bool overdrive = owDeviceOverdrive(romId);
+    if (!ds2431ReadAt(addr, start, buffer, len, overdrive)) return false;
+    if (overdrive && owInOverdrive && isBlank(buffer, len)) {
+        if (!ds2431ReadAt(addr, start, buffer, len, false)) return false;
     }
+    if (overdrive && !owInOverdrive && !isBlank(buffer, len)) owMarkStandardOnly(romId);
     return true;
 }
 
-// =============================================================================
-// Cube Management
-// =============================================================================
+// All four pages in one Read Memory command (the address auto-increments)
+bool ds2431ReadMemory(uint8_t* addr, uint8_t* buffer) {
+    return ds2431Read(addr, 0x00, buffer, DS2431_MEMORY_SIZE);
+}
 
-int findCube(uint64_t romId) {
-    for (int i = 0; i < cubeCount; i++) {
-        if (cubes[i].romId == romId) return i;
+// Write Scratchpad: one 8-byte row
+static bool ds2431WriteScratchpad(uint8_t* addr, uint8_t offset, const uint8_t* data, bool overdrive) {
+    if (!owSelect(addr, overdrive)) return false;
+    owWrite(0x0F);
+    owWrite(offset);
+    owWrite(0x00);
+    for (int i = 0; i < 8; i++) {
+        owWrite(data[i]);
     }
-    return -1;
+    return true;
 }
 
-bool addCube(uint64_t romId, CubeConfig* config) {
-    if (cubeCount >= MAX_CUBES) return false;
-    if (totalLeds + config->ledCount > MAX_TOTAL_LEDS) return false;
-    
-    Cube* cube = &cubes[cubeCount];
-    cube->romId = romId;
-    memcpy(&cube->config, config, sizeof(CubeConfig));
-    cube->ledStart = totalLeds;
-    cube->ledCount = config->ledCount;
-    cube->active = true;
-    
-    totalLeds += config->ledCount;
-    cubeCount++;
-    
-    Serial.print(F("Added cube: LEDs "));
-    Serial.print(cube->ledStart);
-    Serial.print(F("-"));
-    Serial.println(cube->ledStart + cube->ledCount - 1);
+// Read Scratchpad back and compare; returns the E/S byte needed for the copy
+static bool ds2431CheckScratchpad(uint8_t* addr, uint8_t offset, const uint8_t* data, bool overdrive, uint8_t* es) {
+    if (!owSelect(addr, overdrive)) return false;
+    owWrite(0xAA);
+    uint8_t ta1 = owRead();
+    uint8_t ta2 = owRead();
+    *es = owRead();
+    if (ta1 != offset || ta2 != 0x00) return false;
     
-    for (int i = cube->ledStart; i < cube->ledStart + cube->ledCount; i++) {
-        leds[i] = CRGB::Green;
-    }
-    FastLED.show();
-    delay(200);
-    for (int i = cube->ledStart; i < cube->ledStart + cube->ledCount; i++) {
-        leds[i] = CRGB::Black;
+    for (int i = 0; i < 8; i++) {
+        if (owRead() != data[i]) return false;
     }
-    FastLED.show();
-    
     return true;
 }
 
-void removeCube(uint64_t romId) {
-    int idx = findCube(romId);
-    if (idx < 0) return;
-    
-    Serial.print(F("Removed cube at index "));
-    Serial.println(idx);
-    
-    for (int i = cubes[idx].ledStart; i < cubes[idx].ledStart + cubes[idx].ledCount; i++) {
-        leds[i] = CRGB::Black;
-    }
-    
-    cubes[idx].active = false;
+// Copy Scratchpad: programming starts after the E/S byte and takes tPROG
+static bool ds2431CopyScratchpad(uint8_t* addr, uint8_t offset, uint8_t es, bool overdrive) {
+    if (!owSelect(addr, overdrive)) return false;
+    owWrite(0x55);
+    owWrite(offset);
+    owWrite(0x00);
+    owWrite(es);
+    return true;
 }
 
 // =============================================================================
-// 1-Wire Bus Scanning
+// DS2431 Write Pipeline
 // =============================================================================
+// A write is a job advanced one bus transaction per stepDs2431Write() call,
+// so loop() keeps rendering while a cube is programmed. Each 8-byte row is
+// read first and skipped if it already holds the target bytes. Changed rows
+// go through write, read back and copy scratchpad, then wait out tPROG
+// without blocking and are read back to verify. Rows run from the end of the
+// range backwards, so page 0 (the config) is committed last.
+//
+// The DS2431 is parasite powered, so the bus must stay idle during tPROG:
+// the 1-Wire scan does not step while a job is running.
+
+#define DS2431_ROW_SIZE     8
+#define WRITE_ROW_RETRIES   2
 
-void scanOneWireBus() {
+enum Ds2431WriteState : uint8_t {
+    WRITE_IDLE,
+    WRITE_READ,         // Read the current row; skip it if unchanged
+    WRITE_SCRATCH,      // Write Scratchpad
+    WRITE_CHECK,        // Read Scratchpad back
+    WRITE_COPY,         // Copy Scratchpad (starts tPROG)
+    WRITE_WAIT,         // Bus idle until tPROG has passed
+    WRITE_VERIFY        // Read the row back
+};
+
+struct Ds2431WriteJob {
+    Ds2431WriteState state;
     uint8_t addr[8];
-    uint64_t foundIds[MAX_CUBES];
-    int foundCount = 0;
+    uint8_t data[DS2431_MEMORY_SIZE];
+    uint8_t start;          // Memory address of data[0]
+    uint8_t row;            // Memory address of the current row
+    uint8_t es;
+    uint8_t retries;
+    bool standard;          // Overdrive failed: finish at standard speed
+    uint32_t startMs;
+    uint32_t progStart;
+};
+
+static Ds2431WriteJob writeJob;
+static Ds2431WriteResult writeResult;
+
+bool beginDs2431Write(uint8_t* addr, uint8_t start, const uint8_t* data, uint8_t len) {
+    if (writeJob.state != WRITE_IDLE) return false;
+    if (len == 0 || start % DS2431_ROW_SIZE || len % DS2431_ROW_SIZE) return false;
+    if (start + len > DS2431_MEMORY_SIZE) return false;
     
-    oneWire.reset_search();
-    while (oneWire.search(addr) && foundCount < MAX_CUBES) {
-        if (isDS2431(addr)) {
-            foundIds[foundCount++] = addressToId(addr);
-        }
-    }
+    memcpy(writeJob.addr, addr, 8);
+    memcpy(writeJob.data, data, len);
+    writeJob.start = start;
+    writeJob.row = start + len - DS2431_ROW_SIZE;
+    writeJob.retries = 0;
+    writeJob.standard = false;
+    writeJob.startMs = millis();
+    writeJob.state = WRITE_READ;
     
-    for (int i = 0; i < foundCount; i++) {
-        if (findCube(foundIds[i]) < 0) {
-            Serial.print(F("New device: "));
-            Serial.println((unsigned long)(foundIds[i] & 0xFFFFFFFF), HEX);
-            
-            uint8_t configAddr[8];
-            idToAddress(foundIds[i], configAddr);
-            
-            CubeConfig config;
-            if (ds2431ReadPage(configAddr, 0, (uint8_t*)&config)) {
-                if (config.ledCount > 0 && config.ledCount <= 100) {
-                    addCube(foundIds[i], &config);
-                } else {
-                    Serial.println(F("  Invalid config - needs programming"));
-                }
+    memset(&writeResult, 0, sizeof(writeResult));
+    writeResult.romId = addressToId(addr);
+    return true;
+}
+
+static bool writeOverdrive() {
+    return !writeJob.standard && owDeviceOverdrive(writeResult.romId);
+}
+
+static bool writeFinish(const __FlashStringHelper* error) {
+    writeResult.ok = (error == nullptr);
+    writeResult.error = error;
+    writeResult.elapsedMs = millis() - writeJob.startMs;
+    writeJob.state = WRITE_IDLE;
+    // The EEPROM may now differ from the cached image
+    if (writeResult.rowsWritten > 0 || error) cubeCacheForget(writeResult.romId);
+    return true;
+}
+
+// Start the current row over from the scratchpad write, or give up
+static bool writeRetry(const __FlashStringHelper* error) {
+    if (writeJob.retries++ >= WRITE_ROW_RETRIES) return writeFinish(error);
+    writeJob.state = WRITE_SCRATCH;
+    return false;
+}
+
+static bool writeNextRow() {
+    if (writeJob.row == writeJob.start) return writeFinish(nullptr);
+    writeJob.row -= DS2431_ROW_SIZE;
+    writeJob.retries = 0;
+    writeJob.state = WRITE_READ;
+    return false;
+}
+
+bool stepDs2431Write() {
+    Ds2431WriteJob& job = writeJob;
+    const uint8_t* target = &job.data[job.row - job.start];
+    uint8_t current[DS2431_ROW_SIZE];
+    bool done = false;
+    
+    switch (job.state) {
+        case WRITE_IDLE:
+            return false;
+            
+        case WRITE_READ:
+            if (!ds2431Read(job.addr, job.row, current, DS2431_ROW_SIZE)) {
+                done = writeFinish(F("no presence"));
+            } else if (memcmp(current, target, DS2431_ROW_SIZE) == 0) {
+                writeResult.rowsSkipped++;
+                done = writeNextRow();
+            } else {
+                job.state = WRITE_SCRATCH;
+            }
+            break;
+            
+        case WRITE_SCRATCH:
+            if (ds2431WriteScratchpad(job.addr, job.row, target, writeOverdrive())) {
+                job.state = WRITE_CHECK;
+            } else {
+                done = writeRetry(F("no presence"));
+            }
+            break;
+            
+        case WRITE_CHECK: {
+            bool overdrive = writeOverdrive();
+            if (ds2431CheckScratchpad(job.addr, job.row, target, overdrive, &job.es)) {
+                if (job.standard || (overdrive && !owInOverdrive)) owMarkStandardOnly(writeResult.romId);
+                job.state = WRITE_COPY;
+            } else if (overdrive && owInOverdrive) {
+                // Device did not follow overdrive: redo the row at standard speed
+                job.standard = true;
+                job.state = WRITE_SCRATCH;
+            } else {
+                done = writeRetry(F("scratchpad mismatch"));
+            }
+            break;
+        }
+            
+        case WRITE_COPY:
+            if (ds2431CopyScratchpad(job.addr, job.row, job.es, writeOverdrive())) {
+                job.progStart = millis();
+                job.state = WRITE_WAIT;
             } else {
-                Serial.println(F("  Read failed"));
+                done = writeRetry(F("no presence"));
             }
+            break;
+            
+        case WRITE_WAIT:
+            if (millis() - job.progStart < DS2431_PROG_MS) return false;
+            job.state = WRITE_VERIFY;
+            // fall through
+            
+        case WRITE_VERIFY:
+            if (!ds2431Read(job.addr, job.row, current, DS2431_ROW_SIZE)) {
+                done = writeRetry(F("no presence"));
+            } else if (memcmp(current, target, DS2431_ROW_SIZE) != 0) {
+                done = writeRetry(F("verify mismatch"));
+            } else {
+                writeResult.rowsWritten++;
+                done = writeNextRow();
+            }
+            break;
+    }
+    
+    oneWireBusReleased();
+    return done;
+}
+
+bool ds2431WriteBusy() {
+    return writeJob.state != WRITE_IDLE;
+}
+
+const Ds2431WriteResult& ds2431LastWrite() {
+    return writeResult;
+}
+
+// Blocking wrapper around the pipeline
+bool ds2431WritePage(uint8_t* addr, uint8_t page, uint8_t* data) {
+    if (!beginDs2431Write(addr, page * DS2431_PAGE_SIZE, data, DS2431_PAGE_SIZE)) return false;
+    while (!stepDs2431Write()) {
+        if (writeJob.state == WRITE_WAIT) delay(1);
+    }
+    return writeResult.ok;
+}
+
+// =============================================================================
+// Cube Memory
+// =============================================================================
+// Read Memory has no CRC of its own, so from CUBE_LAYOUT_CRC on every page
+// carries one. A bad page 0 rejects the read (retried on the next pass); a
+// bad calibration page only falls back to the defaults.
+
+static bool cubePageValid(const void* page) {
+    const uint8_t* p = (const uint8_t*)page;
+    return OneWire::check_crc16(p, DS2431_PAGE_SIZE - 2, p + DS2431_PAGE_SIZE - 2);
+}
+
+static void cubePageSeal(void* page) {
+    uint8_t* p = (uint8_t*)page;
+    uint16_t crc = ~OneWire::crc16(p, DS2431_PAGE_SIZE - 2);
+    p[DS2431_PAGE_SIZE - 2] = crc & 0xFF;
+    p[DS2431_PAGE_SIZE - 1] = crc >> 8;
+}
+
+void cubeMemoryDefaults(CubeMemory* mem, uint8_t cubeType, uint16_t ledCount) {
+    memset(mem, 0, sizeof(CubeMemory));
+    mem->config.cubeType = cubeType;
+    mem->config.ledCount = ledCount;
+    mem->config.colorOrder = 0;
+    mem->config.brightness = 128;
+    mem->config.layout = CUBE_LAYOUT_CRC;
+    for (int i = 0; i < 3; i++) mem->gamma.scale[i] = 255;
+    mem->power.ledMilliamps = 20;
+    cubeMemorySeal(mem);
+}
+
+// Keeps what "prog" does not set: the rest of page 0 and every calibration
+// page that checks out. Blank or corrupt images start from the defaults.
+void cubeMemoryReprogram(CubeMemory* mem, CubeMemoryStatus status, uint8_t cubeType, uint16_t ledCount) {
+    CubeMemory defaults;
+    cubeMemoryDefaults(&defaults, cubeType, ledCount);
+    if (status != CUBE_MEM_OK && status != CUBE_MEM_INVALID) {
+        *mem = defaults;
+        return;
+    }
+    
+    bool calibrated = mem->config.layout >= CUBE_LAYOUT_CRC;
+    if (!calibrated || !cubePageValid(&mem->ledMap)) mem->ledMap = defaults.ledMap;
+    if (!calibrated || !cubePageValid(&mem->gamma)) mem->gamma = defaults.gamma;
+    if (!calibrated || !cubePageValid(&mem->power)) mem->power = defaults.power;
+    mem->config.cubeType = cubeType;
+    mem->config.ledCount = ledCount;
+    mem->config.layout = CUBE_LAYOUT_CRC;
+}
+
+void cubeMemorySeal(CubeMemory* mem) {
+    cubePageSeal(&mem->config);
+    cubePageSeal(&mem->ledMap);
+    cubePageSeal(&mem->gamma);
+    cubePageSeal(&mem->power);
+}
+
+CubeMemoryStatus cubeMemoryCheck(const CubeMemory* mem) {
+    if (isBlank((const uint8_t*)&mem->config, DS2431_PAGE_SIZE)) return CUBE_MEM_BLANK;
+    if (mem->config.layout >= CUBE_LAYOUT_CRC && !cubePageValid(&mem->config)) return CUBE_MEM_CORRUPT;
+    if (mem->config.ledCount == 0 || mem->config.ledCount > 100) return CUBE_MEM_INVALID;
+    return CUBE_MEM_OK;
+}
+
+// One bulk read plus integrity check. A CRC failure at overdrive is retried
+// once at standard speed.
+CubeMemoryStatus readCubeMemory(uint8_t* addr, CubeMemory* mem) {
+    if (!ds2431ReadMemory(addr, (uint8_t*)mem)) return CUBE_MEM_ABSENT;
+    CubeMemoryStatus status = cubeMemoryCheck(mem);
+    if (status == CUBE_MEM_CORRUPT && owInOverdrive) {
+        if (!ds2431ReadAt(addr, 0x00, (uint8_t*)mem, DS2431_MEMORY_SIZE, false)) return CUBE_MEM_ABSENT;
+        status = cubeMemoryCheck(mem);
+        if (status != CUBE_MEM_CORRUPT) owMarkStandardOnly(addressToId(addr));
+    }
+    return status;
+}
+
+// The index-th DS2431 on the bus, in search order (as listed by "list")
+bool findOneWireDevice(int index, uint8_t* addr) {
+    int count = 0;
+    owResetSearch();
+    while (owSearch(addr)) {
+        if (!isDS2431(addr)) continue;
+        if (count++ == index) {
+            owResetSearch();
+            return true;
+        }
+    }
+    return false;
+}
+
+// =============================================================================
+// Cube Config Cache
+// =============================================================================
+// Validated memory images are kept in NVS, keyed by ROM ID, so a cube seen
+// before goes live from its ROM ID alone (at boot and on hot-plug) and its
+// EEPROM is re-read afterwards in the background. Each entry carries a
+// CRC16 of its image as a content version. When the table is full the least
+// recently seen cube that is not connected is evicted. Changes only mark the
+// table dirty: serviceCubeCache() writes it from loop() once the bus is idle,
+// at most every CUBE_CACHE_FLUSH_MS (an NVS write takes several ms, so it
+// never runs inside a budgeted scan or write step). Use stamps ride along.
+
+#define CUBE_CACHE_NAMESPACE "cubecache"
+#define CUBE_CACHE_FORMAT    1      // Bump when CubeCacheEntry changes
+
+struct CubeCacheEntry {
+    uint64_t romId;             // 0 = free
+    uint32_t lastSeen;          // Use stamp for eviction
+    uint16_t version;           // cubeCacheVersion() of memory
+    CubeMemory memory;
+};
+
+static CubeCacheEntry cubeCache[CUBE_CACHE_SIZE];
+static uint32_t cubeCacheStamp = 0;
+static bool cubeCacheDirty = false;
+static uint32_t cubeCacheFlushed = 0;       // millis() of the last NVS write
+
+// Over the page payloads only: a sealed page ends in its own inverted CRC,
+// which would bring a CRC over the whole image back to the same residue
+static uint16_t cubeCacheVersion(const CubeMemory* mem) {
+    const uint8_t* p = (const uint8_t*)mem;
+    uint16_t crc = 0;
+    for (int page = 0; page < DS2431_MEMORY_SIZE / DS2431_PAGE_SIZE; page++) {
+        crc = OneWire::crc16(p + page * DS2431_PAGE_SIZE, DS2431_PAGE_SIZE - 2, crc);
+    }
+    return crc;
+}
+
+static CubeCacheEntry* cubeCacheFind(uint64_t romId) {
+    for (int i = 0; i < CUBE_CACHE_SIZE; i++) {
+        if (cubeCache[i].romId == romId) return &cubeCache[i];
+    }
+    return nullptr;
+}
+
+// A free entry, else the oldest one whose cube is not connected
+static CubeCacheEntry* cubeCacheVictim() {
+    CubeCacheEntry* oldest = nullptr;
+    CubeCacheEntry* oldestIdle = nullptr;
+    for (int i = 0; i < CUBE_CACHE_SIZE; i++) {
+        CubeCacheEntry* e = &cubeCache[i];
+        if (e->romId == 0) return e;
+        if (!oldest || e->lastSeen < oldest->lastSeen) oldest = e;
+        if (findCube(e->romId) < 0 && (!oldestIdle || e->lastSeen < oldestIdle->lastSeen)) oldestIdle = e;
+    }
+    return oldestIdle ? oldestIdle : oldest;
+}
+
+void cubeCacheFlush() {
+    if (!cubeCacheDirty) return;
+    Preferences prefs;
+    if (!prefs.begin(CUBE_CACHE_NAMESPACE, false)) return;
+    if (prefs.getUChar("format", 0) != CUBE_CACHE_FORMAT) prefs.putUChar("format", CUBE_CACHE_FORMAT);
+    prefs.putBytes("entries", cubeCache, sizeof(cubeCache));
+    prefs.end();
+    cubeCacheDirty = false;
+    cubeCacheFlushed = millis();
+}
+
+void serviceCubeCache() {
+    if (!cubeCacheDirty || oneWireScanBusy() || ds2431WriteBusy()) return;
+    if (millis() - cubeCacheFlushed < CUBE_CACHE_FLUSH_MS) return;
+    cubeCacheFlush();
+}
+
+void initCubeCache() {
+    memset(cubeCache, 0, sizeof(cubeCache));
+    cubeCacheStamp = 0;
+    cubeCacheDirty = false;
+
+    Preferences prefs;
+    if (!prefs.begin(CUBE_CACHE_NAMESPACE, true)) return;   // Nothing stored yet
+    if (prefs.getUChar("format", 0) == CUBE_CACHE_FORMAT &&
+        prefs.getBytesLength("entries") == sizeof(cubeCache)) {
+        prefs.getBytes("entries", cubeCache, sizeof(cubeCache));
+    }
+    prefs.end();
+
+    // Drop anything that no longer validates
+    for (int i = 0; i < CUBE_CACHE_SIZE; i++) {
+        CubeCacheEntry* e = &cubeCache[i];
+        if (e->romId == 0) continue;
+        if (e->version != cubeCacheVersion(&e->memory) || cubeMemoryCheck(&e->memory) != CUBE_MEM_OK) {
+            memset(e, 0, sizeof(CubeCacheEntry));
+            continue;
+        }
+        if (e->lastSeen > cubeCacheStamp) cubeCacheStamp = e->lastSeen;
+    }
+}
+
+bool cubeCacheLookup(uint64_t romId, CubeMemory* mem) {
+    CubeCacheEntry* e = cubeCacheFind(romId);
+    if (!e) return false;
+    e->lastSeen = ++cubeCacheStamp;
+    memcpy(mem, &e->memory, sizeof(CubeMemory));
+    return true;
+}
+
+// Returns true if the cached contents changed; NVS is written later by
+// serviceCubeCache()
+bool cubeCacheStore(uint64_t romId, const CubeMemory* mem) {
+    uint16_t version = cubeCacheVersion(mem);
+    CubeCacheEntry* e = cubeCacheFind(romId);
+    if (e && e->version == version && memcmp(&e->memory, mem, sizeof(CubeMemory)) == 0) {
+        e->lastSeen = ++cubeCacheStamp;
+        return false;
+    }
+
+    if (!e) e = cubeCacheVictim();
+    e->romId = romId;
+    e->lastSeen = ++cubeCacheStamp;
+    e->version = version;
+    memcpy(&e->memory, mem, sizeof(CubeMemory));
+    cubeCacheDirty = true;
+    return true;
+}
+
+void cubeCacheForget(uint64_t romId) {
+    CubeCacheEntry* e = cubeCacheFind(romId);
+    if (!e) return;
+    memset(e, 0, sizeof(CubeCacheEntry));
+    cubeCacheDirty = true;
+}
+
+void cubeCacheClear() {
+    memset(cubeCache, 0, sizeof(cubeCache));
+    cubeCacheDirty = false;
+    Preferences prefs;
+    if (!prefs.begin(CUBE_CACHE_NAMESPACE, false)) return;
+    prefs.clear();
+    prefs.end();
+}
+
+void printCubeCache() {
+    int count = 0;
+    for (int i = 0; i < CUBE_CACHE_SIZE; i++) {
+        const CubeCacheEntry* e = &cubeCache[i];
+        if (e->romId == 0) continue;
+        Serial.print(F("  "));
+        Serial.print((unsigned long)(e->romId & 0xFFFFFFFF), HEX);
+        Serial.print(F(": Type="));
+        Serial.print(e->memory.config.cubeType);
+        Serial.print(F(" LEDs="));
+        Serial.print(e->memory.config.ledCount);
+        Serial.print(F(" v"));
+        Serial.print(e->version, HEX);
+        Serial.println(findCube(e->romId) >= 0 ? F(" (connected)") : F(""));
+        count++;
+    }
+    Serial.print(count);
+    Serial.print(F("/"));
+    Serial.print(CUBE_CACHE_SIZE);
+    Serial.println(F(" entries"));
+}
+
+// =============================================================================
+// Cube Management
+// =============================================================================
+
+int findCube(uint64_t romId) {
+    for (int i = 0; i < cubeCount; i++) {
+        if (cubes[i].active && cubes[i].romId == romId) return i;
+    }
+    return -1;
+}
+
+// Slots are reused: a cube takes the lowest free one, and cubeCount is one
+// past the highest slot in use. LED ranges are not tied to slots; after
+// every change compactCubeLeds() packs the active cubes back to back,
+// grouped by output, so the frame holds live pixels only and freed ranges
+// are never lost.
+static void compactCubeLeds() {
+    int next = 0;
+    for (int ch = 0; ch < LED_CHANNEL_COUNT; ch++) {
+        for (int i = 0; i < cubeCount; i++) {
+            if (!cubes[i].active || cubes[i].output != ch) continue;
+            cubes[i].ledStart = next;
+            next += cubes[i].ledCount;
         }
     }
+    totalLeds = next;
+}
+
+int activeCubeCount() {
+    int n = 0;
+    for (int i = 0; i < cubeCount; i++) {
+        if (cubes[i].active) n++;
+    }
+    return n;
+}
+
+bool addCube(uint64_t romId, CubeMemory* mem) {
+    CubeConfig* config = &mem->config;
+    int slot = 0;
+    while (slot < cubeCount && cubes[slot].active) slot++;
+    if (slot >= MAX_CUBES || totalLeds + config->ledCount > MAX_TOTAL_LEDS) {
+        Serial.print(F("No room for cube: "));
+        Serial.print(activeCubeCount());
+        Serial.print(F(" cubes, "));
+        Serial.print(totalLeds);
+        Serial.println(F(" LEDs in use"));
+        return false;
+    }
+    
+    Cube* cube = &cubes[slot];
+    cube->romId = romId;
+    memcpy(&cube->config, config, sizeof(CubeConfig));
+    cube->ledCount = config->ledCount;
+    cube->output = (config->output < LED_CHANNEL_COUNT) ? config->output : 0;
+    cube->active = true;
+    
+    // Calibration pages only exist from CUBE_LAYOUT_CRC on
+    CubeMemory defaults;
+    cubeMemoryDefaults(&defaults, config->cubeType, config->ledCount);
+    bool calibrated = config->layout >= CUBE_LAYOUT_CRC;
+    if (calibrated && !(cubePageValid(&mem->ledMap) && cubePageValid(&mem->gamma) && cubePageValid(&mem->power))) {
+        Serial.println(F("  Calibration CRC error - using defaults for bad pages"));
+    }
+    cube->ledMap = (calibrated && cubePageValid(&mem->ledMap)) ? mem->ledMap : defaults.ledMap;
+    cube->gamma = (calibrated && cubePageValid(&mem->gamma)) ? mem->gamma : defaults.gamma;
+    cube->power = (calibrated && cubePageValid(&mem->power)) ? mem->power : defaults.power;
+    
+    if (slot == cubeCount) cubeCount++;
+    compactCubeLeds();
+    
+    Serial.print(F("Added cube "));
+    Serial.print(slot);
+    Serial.print(F(": LEDs "));
+    Serial.print(cube->ledStart);
+    Serial.print(F("-"));
+    Serial.print(cube->ledStart + cube->ledCount - 1);
+    Serial.print(F(" on output "));
+    Serial.println(cube->output);
+    
+    // The render task shows the identify flash
+    cube->flashUntil = millis() + CUBE_FLASH_MS;
+    publishRenderLayout();
+    
+    return true;
+}
+
+void removeCube(uint64_t romId) {
+    int idx = findCube(romId);
+    if (idx < 0) return;
+    
+    Serial.print(F("Removed cube at index "));
+    Serial.println(idx);
     
+    cubes[idx].active = false;
+    while (cubeCount > 0 && !cubes[cubeCount - 1].active) cubeCount--;
+    compactCubeLeds();
+    owForgetDevice(romId);
+    publishRenderLayout();
+}
+
+// =============================================================================
+// 1-Wire Bus Scanning
+// =============================================================================
+// A scan pass is a resumable state machine so it can be spread over many
+// loop() passes. Each step is one bus primitive (reset, byte, or search
+// triplet); 1-Wire slaves tolerate any idle time between slots, so pausing
+// between primitives is safe. Add/remove changes are only applied once the
+// whole pass (search + config reads) has completed.
+//
+// Most polls are a cheap verify pass instead: one Match ROM plus a single
+// read slot per active cube (~half the bus time of searching for it), which
+// catches removals. New devices announce themselves with a presence pulse
+// when they connect to the idle bus; onOneWireEdge() latches that so the
+// next poll enumerates. A pulse that lands in our own traffic can't be told
+// from our slots, so any edge seen then also makes the next poll enumerate,
+// keeping hot-plug latency within one ONEWIRE_POLL_MS. A full enumeration
+// also runs whenever presence or verification fails, and at least every
+// ONEWIRE_FULL_SCAN_MS.
+// Searches, reads and verifies use overdrive where devices allow it; a read
+// or verify that fails at overdrive is retried once at standard speed.
+//
+// New devices found in the config cache are added without reading them.
+// A later refresh pass reads those cubes and reloads any whose EEPROM no
+// longer matches the cached image.
+
+// Estimated cost of each primitive, used to stay in budget
+#define OW_COST_RESET_US    960
+#define OW_COST_BYTE_US     560
+#define OW_COST_TRIPLET_US  200
+#define OD_COST_RESET_US    120
+#define OD_COST_BYTE_US     80
+#define OD_COST_TRIPLET_US  30
+
+enum OneWireScanState : uint8_t {
+    SCAN_IDLE,
+    SCAN_SEARCH_RESET,   // Reset, queue search ROM command
+    SCAN_TX,             // Send queued bytes, one per step
+    SCAN_SEARCH_BITS,    // One id bit / complement / direction triplet per step
+    SCAN_READ_NEXT,      // Reset and address the next new (or refreshed) device
+    SCAN_READ_RX,        // Read page 0, one byte per step
+    SCAN_COMMIT,         // Apply add/remove changes
+    SCAN_VERIFY_NEXT,    // Reset and Match ROM the next active cube
+    SCAN_VERIFY_BIT      // One read slot: the cube drives a known 0 bit
+};
+
+struct OneWireScan {
+    OneWireScanState state;
+    OneWireScanState afterTx;
+    bool overdrive;         // Search speed for this pass
+    bool retryStandard;     // Current read/verify fell back to standard speed
+    bool odSkipNext;        // Standard reset done, Overdrive Skip is the next step
+    bool odFallback;        // Overdrive reset went unanswered, standard reset next
+    bool refresh;           // Re-reading cubes that came from the cache
+
+    // Search ROM progress (same bookkeeping as OneWire::search())
+    uint8_t rom[8];
+    uint8_t bitNumber;
+    uint8_t lastZero;
+    uint8_t lastDiscrepancy;
+    bool lastDevice;
+
+    // Devices found this pass and their memory contents
+    uint64_t foundIds[MAX_CUBES];
+    CubeMemory images[MAX_CUBES];
+    bool readOk[MAX_CUBES];
+    bool cached[MAX_CUBES];     // Image came from the config cache
+    int foundCount;
+    int readIndex;
+    int verifyIndex;
+
+    uint8_t tx[12];
+    uint8_t txLen;
+    uint8_t txPos;
+    uint8_t rxPos;
+};
+
+static OneWireScan scan;
+static uint32_t lastFullScan = 0;
+static uint32_t lastStandardScan = 0;
+static bool standardScanDone = false;
+static uint64_t refreshIds[MAX_CUBES];  // Cubes added from the cache, not yet re-read
+static int refreshCount = 0;
+bool oneWireHotPlug = false;
+
+static void scanQueueTx(const uint8_t* data, uint8_t len, OneWireScanState next) {
+    memcpy(scan.tx, data, len);
+    scan.txLen = len;
+    scan.txPos = 0;
+    scan.afterTx = next;
+    scan.state = SCAN_TX;
+}
+
+static_assert(ONEWIRE_SCAN_BUDGET_US >= OW_COST_RESET_US, "A standard reset must fit in one scan pass");
+
+// Bus resets for the scan, one primitive per step. Entering overdrive is a
+// standard reset and then Overdrive Skip, and an unanswered overdrive reset
+// falls back to a standard one; each of those is a step of its own, during
+// which this returns SCAN_RESET_PENDING and the state runs again.
+enum ScanReset : uint8_t {
+    SCAN_RESET_ABSENT,
+    SCAN_RESET_PRESENT,
+    SCAN_RESET_PENDING
+};
+
+static ScanReset scanReset(bool overdrive) {
+    if (scan.odFallback) {
+        scan.odFallback = false;
+        return oneWire.reset() ? SCAN_RESET_PRESENT : SCAN_RESET_ABSENT;
+    }
+    if (!overdrive) {
+        owInOverdrive = false;
+        return oneWire.reset() ? SCAN_RESET_PRESENT : SCAN_RESET_ABSENT;
+    }
+    if (owInOverdrive) {
+        if (odReset()) return SCAN_RESET_PRESENT;
+        owInOverdrive = false;
+        scan.odFallback = true;
+        return SCAN_RESET_PENDING;
+    }
+    if (scan.odSkipNext) {
+        oneWire.write(0x3C);
+        owInOverdrive = true;
+        scan.odSkipNext = false;
+        return SCAN_RESET_PENDING;
+    }
+    if (!oneWire.reset()) return SCAN_RESET_ABSENT;
+    scan.odSkipNext = true;
+    return SCAN_RESET_PENDING;
+}
+
+static uint32_t scanStepCost() {
+    // A reset is only short if it is sure to stay at overdrive: no fallback
+    // pending and no standard-only device it could be addressing
+    bool odReset = owInOverdrive && !scan.retryStandard && !scan.odFallback && owSearchOverdrive();
+    switch (scan.state) {
+        case SCAN_SEARCH_RESET:
+        case SCAN_READ_NEXT:
+        case SCAN_VERIFY_NEXT:  return odReset ? OD_COST_RESET_US : OW_COST_RESET_US;
+        case SCAN_TX:
+        case SCAN_READ_RX:      return owInOverdrive ? OD_COST_BYTE_US : OW_COST_BYTE_US;
+        case SCAN_SEARCH_BITS:  return owInOverdrive ? OD_COST_TRIPLET_US : OW_COST_TRIPLET_US;
+        case SCAN_VERIFY_BIT:   return (owInOverdrive ? OD_COST_TRIPLET_US : OW_COST_TRIPLET_US) / 3;
+        default:                return 0;
+    }
+}
+
+// Full passes search at overdrive unless a standard-speed pass is due
+static void scanStartSearch() {
+    scan.overdrive = owSearchOverdrive() && standardScanDone &&
+                     millis() - lastStandardScan < ONEWIRE_STANDARD_SCAN_MS;
+    owInOverdrive = false;      // Re-issue Overdrive Skip for newly attached devices
+    owEdgeUnsure = false;       // This search finds anything attached before it
+    scan.retryStandard = false;
+    scan.odSkipNext = false;
+    scan.odFallback = false;
+    scan.state = SCAN_SEARCH_RESET;
+}
+
+static void scanQueueRefresh(uint64_t romId) {
+    for (int i = 0; i < refreshCount; i++) {
+        if (refreshIds[i] == romId) return;
+    }
+    if (refreshCount < MAX_CUBES) refreshIds[refreshCount++] = romId;
+}
+
+// Compare re-read cubes with their cached images
+static void scanCommitRefresh() {
+    for (int i = 0; i < scan.foundCount; i++) {
+        uint64_t romId = scan.foundIds[i];
+        if (findCube(romId) < 0) continue;
+
+        CubeMemoryStatus status = scan.readOk[i] ? cubeMemoryCheck(&scan.images[i]) : CUBE_MEM_ABSENT;
+        if (status == CUBE_MEM_ABSENT || status == CUBE_MEM_CORRUPT) {
+            // Gone (the next poll removes it) or a bad read: try again later
+            scanQueueRefresh(romId);
+            continue;
+        }
+        if (status != CUBE_MEM_OK) {
+            Serial.print(F("Cube "));
+            Serial.print((unsigned long)(romId & 0xFFFFFFFF), HEX);
+            Serial.println(F(" no longer programmed"));
+            cubeCacheForget(romId);
+            removeCube(romId);
+            continue;
+        }
+        if (!cubeCacheStore(romId, &scan.images[i])) continue;     // Unchanged
+
+        Serial.print(F("Cube "));
+        Serial.print((unsigned long)(romId & 0xFFFFFFFF), HEX);
+        Serial.println(F(" changed - reloading config"));
+        removeCube(romId);
+        addCube(romId, &scan.images[i]);
+    }
+}
+
+static void scanCommit() {
+    if (scan.refresh) {
+        scanCommitRefresh();
+        return;
+    }
+
+    for (int i = 0; i < scan.foundCount; i++) {
+        if (findCube(scan.foundIds[i]) >= 0) continue;
+
+        Serial.print(F("New device: "));
+        Serial.println((unsigned long)(scan.foundIds[i] & 0xFFFFFFFF), HEX);
+
+        if (scan.cached[i]) {
+            Serial.println(F("  Config from cache"));
+            if (addCube(scan.foundIds[i], &scan.images[i])) scanQueueRefresh(scan.foundIds[i]);
+            continue;
+        }
+        if (!scan.readOk[i]) {
+            Serial.println(F("  Read failed"));
+            continue;
+        }
+        switch (cubeMemoryCheck(&scan.images[i])) {
+            case CUBE_MEM_OK:
+                cubeCacheStore(scan.foundIds[i], &scan.images[i]);
+                addCube(scan.foundIds[i], &scan.images[i]);
+                break;
+            case CUBE_MEM_CORRUPT:
+                Serial.println(F("  Config CRC error - will retry"));
+                break;
+            default:
+                Serial.println(F("  Invalid config - needs programming"));
+                break;
+        }
+    }
+
     for (int i = 0; i < cubeCount; i++) {
         if (!cubes[i].active) continue;
-        
+
         bool stillPresent = false;
-        for (int j = 0; j < foundCount; j++) {
-            if (cubes[i].romId == foundIds[j]) {
+        for (int j = 0; j < scan.foundCount; j++) {
+            if (cubes[i].romId == scan.foundIds[j]) {
                 stillPresent = true;
                 break;
             }
         }
-        
+
         if (!stillPresent) {
             removeCube(cubes[i].romId);
         }
     }
 }
 
+// One search triplet per step
+static void scanSearchTriplet() {
+    if (!owSearchTriplet(scan.rom, scan.bitNumber, scan.lastDiscrepancy, &scan.lastZero)) {
+        // Nobody answered (device left mid-search): abandon this pass
+        scan.state = SCAN_IDLE;
+        return;
+    }
+
+    if (++scan.bitNumber <= 64) return;
+
+    // Full ROM found
+    scan.lastDiscrepancy = scan.lastZero;
+    scan.lastDevice = (scan.lastDiscrepancy == 0);
+    if (isDS2431(scan.rom)) {
+        scan.foundIds[scan.foundCount++] = addressToId(scan.rom);
+    }
+
+    if (scan.lastDevice || scan.foundCount >= MAX_CUBES) {
+        scan.readIndex = 0;
+        scan.state = SCAN_READ_NEXT;
+    } else {
+        scan.state = SCAN_SEARCH_RESET;
+    }
+}
+
+// Perform one bus primitive. Returns true when the pass has completed.
+static bool scanAdvance() {
+    switch (scan.state) {
+        case SCAN_IDLE:
+            return false;
+
+        case SCAN_SEARCH_RESET: {
+            ScanReset reset = scanReset(scan.overdrive);
+            if (reset == SCAN_RESET_PENDING) break;
+            if (reset == SCAN_RESET_ABSENT) {
+                // Empty bus: the pass is complete with nothing found
+                scan.foundCount = 0;
+                scan.state = SCAN_COMMIT;
+                break;
+            }
+            scan.bitNumber = 1;
+            scan.lastZero = 0;
+            const uint8_t cmd = 0xF0;
+            scanQueueTx(&cmd, 1, SCAN_SEARCH_BITS);
+            break;
+        }
+
+        case SCAN_TX:
+            owWrite(scan.tx[scan.txPos++]);
+            if (scan.txPos >= scan.txLen) scan.state = scan.afterTx;
+            break;
+
+        case SCAN_SEARCH_BITS:
+            scanSearchTriplet();
+            break;
+
+        case SCAN_READ_NEXT: {
+            // Only devices not already in the cube table (or in the config
+            // cache) need their memory read, except on a refresh pass
+            while (scan.readIndex < scan.foundCount && !scan.refresh) {
+                int i = scan.readIndex;
+                if (findCube(scan.foundIds[i]) < 0) {
+                    scan.cached[i] = cubeCacheLookup(scan.foundIds[i], &scan.images[i]);
+                    if (!scan.cached[i]) break;
+                }
+                scan.readIndex++;
+            }
+            if (scan.readIndex >= scan.foundCount) {
+                scan.state = SCAN_COMMIT;
+                break;
+            }
+            uint64_t romId = scan.foundIds[scan.readIndex];
+            bool overdrive = owDeviceOverdrive(romId) && !scan.retryStandard;
+            ScanReset reset = scanReset(overdrive);
+            if (reset == SCAN_RESET_PENDING) break;
+            if (reset == SCAN_RESET_ABSENT) {
+                scan.readOk[scan.readIndex++] = false;
+                scan.retryStandard = false;
+                break;
+            }
+            if (overdrive && !owInOverdrive) scan.retryStandard = true;
+            uint8_t cmd[12];
+            cmd[0] = 0x55;
+            idToAddress(romId, &cmd[1]);
+            cmd[9] = 0xF0;
+            cmd[10] = 0x00;     // All pages from address 0
+            cmd[11] = 0x00;
+            scan.rxPos = 0;
+            scanQueueTx(cmd, sizeof(cmd), SCAN_READ_RX);
+            break;
+        }
+
+        case SCAN_READ_RX: {
+            CubeMemory* mem = &scan.images[scan.readIndex];
+            ((uint8_t*)mem)[scan.rxPos++] = owRead();
+            if (scan.rxPos < DS2431_MEMORY_SIZE) break;
+
+            scan.state = SCAN_READ_NEXT;
+            CubeMemoryStatus status = cubeMemoryCheck(mem);
+            bool failed = (status == CUBE_MEM_BLANK || status == CUBE_MEM_CORRUPT);
+            if (owInOverdrive && failed) {
+                // Silent or garbled at overdrive: read it again at standard speed
+                scan.retryStandard = true;
+                break;
+            }
+            if (scan.retryStandard && !failed) {
+                owMarkStandardOnly(scan.foundIds[scan.readIndex]);
+            }
+            scan.retryStandard = false;
+            scan.readOk[scan.readIndex++] = true;
+            break;
+        }
+
+        case SCAN_COMMIT:
+            scan.state = SCAN_IDLE;
+            if (scan.refresh) {
+                scanCommit();
+                return true;
+            }
+            lastFullScan = millis();
+            if (!scan.overdrive) {
+                lastStandardScan = lastFullScan;
+                standardScanDone = true;
+            }
+            scanCommit();
+            return true;
+
+        case SCAN_VERIFY_NEXT: {
+            while (scan.verifyIndex < cubeCount && !cubes[scan.verifyIndex].active) {
+                scan.verifyIndex++;
+            }
+            if (scan.verifyIndex >= cubeCount) {
+                // Every active cube answered: nothing changed
+                scan.state = SCAN_IDLE;
+                return true;
+            }
+            uint64_t romId = cubes[scan.verifyIndex].romId;
+            bool overdrive = owDeviceOverdrive(romId) && !scan.retryStandard;
+            ScanReset reset = scanReset(overdrive);
+            if (reset == SCAN_RESET_PENDING) break;
+            if (reset == SCAN_RESET_ABSENT) {
+                scanStartSearch();
+                break;
+            }
+            if (overdrive && !owInOverdrive) scan.retryStandard = true;
+            // Read Memory at the high byte of ledCount, which is 0 in any
+            // valid config, so a present cube pulls the first slot low.
+            uint8_t cmd[12];
+            cmd[0] = 0x55;
+            idToAddress(romId, &cmd[1]);
+            cmd[9] = 0xF0;
+            cmd[10] = offsetof(CubeConfig, ledCount) + 1;
+            cmd[11] = 0x00;
+            scanQueueTx(cmd, sizeof(cmd), SCAN_VERIFY_BIT);
+            break;
+        }
+
+        case SCAN_VERIFY_BIT:
+            if (!owReadBit()) {
+                if (scan.retryStandard) owMarkStandardOnly(cubes[scan.verifyIndex].romId);
+                scan.retryStandard = false;
+                scan.verifyIndex++;
+                scan.state = SCAN_VERIFY_NEXT;
+            } else if (owInOverdrive) {
+                // No answer at overdrive: try the same cube at standard speed
+                scan.retryStandard = true;
+                scan.state = SCAN_VERIFY_NEXT;
+            } else {
+                // No answer: fall back to a full enumeration
+                scanStartSearch();
+            }
+            break;
+    }
+    return false;
+}
+
+void beginOneWireScan() {
+    memset(&scan, 0, sizeof(scan));
+    scanStartSearch();
+}
+
+void beginOneWirePoll() {
+    bool anyActive = false;
+    for (int i = 0; i < cubeCount; i++) {
+        if (cubes[i].active) anyActive = true;
+    }
+
+    if (oneWireHotPlug || owEdgeUnsure || !anyActive ||
+        millis() - lastFullScan >= ONEWIRE_FULL_SCAN_MS) {
+        beginOneWireScan();
+    } else if (refreshCount > 0) {
+        // Read back the cubes that were brought up from the cache
+        memset(&scan, 0, sizeof(scan));
+        scan.refresh = true;
+        for (int i = 0; i < refreshCount; i++) {
+            if (findCube(refreshIds[i]) >= 0) scan.foundIds[scan.foundCount++] = refreshIds[i];
+        }
+        refreshCount = 0;
+        scan.state = SCAN_READ_NEXT;
+    } else {
+        memset(&scan, 0, sizeof(scan));
+        scan.state = SCAN_VERIFY_NEXT;
+    }
+    oneWireHotPlug = false;
+}
+
+// Runs scan steps while their estimated cost still fits in budgetUs. The
+// first step always runs; no step costs more than a standard reset, which
+// ONEWIRE_SCAN_BUDGET_US covers, so the budget holds for every pass.
+bool stepOneWireScan(uint32_t budgetUs) {
+    if (scan.state == SCAN_IDLE || ds2431WriteBusy()) return false;
+
+    uint32_t start = micros();
+    bool complete = false;
+    do {
+        complete = scanAdvance();
+    } while (!complete && scan.state != SCAN_IDLE && micros() - start + scanStepCost() <= budgetUs);
+
+    oneWireBusReleased();
+    return complete;
+}
+
+bool oneWireScanBusy() {
+    return scan.state != SCAN_IDLE;
+}
+
+void cancelOneWireScan() {
+    scan.state = SCAN_IDLE;
+}
+
+// Scan steps wait for a DS2431 write, so this refuses to start during one
+bool scanOneWireBus() {
+    if (ds2431WriteBusy()) return false;
+    beginOneWireScan();
+    while (oneWireScanBusy()) {
+        stepOneWireScan(UINT32_MAX);
+    }
+    return true;
+}
+
 // =============================================================================
 // Animations
 // =============================================================================
 
+// Render the current effect (see effects.cpp) into frame[0..count)
+static void renderEffect(CRGB* frame, int count) {
+    if (accelMode) {
+        pixelFill(frame, count, CRGB(accelR, accelG, accelB));
+    } else {
+        renderEffectFrame(currentAnimation, frame, count);
+    }
+}
+
 void runAnimation() {
     if (!animationRunning || !ledsEnabled) return;
+    renderEffect(leds, totalLeds);
+}
+
+// =============================================================================
+// LED Output
+// =============================================================================
+// FastLED.show() holds its caller for the whole transfer (9 ms at 300 LEDs).
+// Here a frame is packed into a GRB wire buffer, brightness applied, and
+// handed to the RMT driver; its interrupt translates the bytes into WS2812
+// pulses while the CPU goes on to render the next frame. The wire buffer is
+// all the RMT reads, so ledOutputShow() itself is the fence: it waits for the
+// previous transfer before packing over it, and the caller's frame buffers are
+// free again as soon as it returns.
+//
+// With several outputs each cube's pixels go to the data line it is chained
+// on (config.output), in frame order. Every output gets its own region of the
+// wire buffer and RMT channel and all of them are started back to back, so a
+// refresh takes as long as the longest chain rather than all LEDs in a row.
+//
+// Packing is also where each cube's own calibration is applied, in the same
+// pass: one table lookup per channel covers its gamma, white balance and
+// brightness, the wire bytes are written in its color order, and the global
+// brightness scales the result. The tables hold 8.8 fixed point; the fraction
+// is temporally dithered, so dim gamma-corrected colors average out to their
+// true level over a few frames instead of stepping. leds[] itself is never
+// touched - the effects fade from it and the PC stream writes it as sent.
+
+#define LED_RMT_CLK_DIV 2           // 80 MHz APB / 2: 25 ns ticks
+#define WS2812_T0H_NS   400
+#define WS2812_T0L_NS   850
+#define WS2812_T1H_NS   800
+#define WS2812_T1L_NS   450
+
+static_assert(LED_CHANNEL_COUNT >= 1 && LED_CHANNEL_COUNT <= 2, "ESP32-C3 has two RMT TX channels");
+
+static const uint8_t ledOutputPins[LED_CHANNEL_COUNT] = {
+    PIN_LED_DATA,
+#if LED_CHANNEL_COUNT > 1
+    PIN_LED_DATA2,
+#endif
+};
+
+static uint8_t ledWire[MAX_TOTAL_LEDS * 3];
+static rmt_item32_t ledBit0;
+static rmt_item32_t ledBit1;
+static bool ledOutputReady = false;
+
+// Channel read for each wire byte (CRGB raw index: 0 = R, 1 = G, 2 = B)
+static const uint8_t ledColorOrders[][3] = {
+    { 1, 0, 2 },    // CUBE_ORDER_GRB
+    { 0, 1, 2 },    // CUBE_ORDER_RGB
+    { 2, 0, 1 },    // CUBE_ORDER_BRG
+    { 0, 2, 1 },    // CUBE_ORDER_RBG
+    { 1, 2, 0 },    // CUBE_ORDER_GBR
+    { 2, 1, 0 },    // CUBE_ORDER_BGR
+};
+
+#define LED_COLOR_ORDER_COUNT (sizeof(ledColorOrders) / sizeof(ledColorOrders[0]))
+
+// Output tables for one set of calibration values. Cubes that share the
+// values share the table, so identical cubes cost one build and 1.5 KB.
+struct LedCalibration {
+    uint8_t gamma[3];
+    uint8_t scale[3];
+    uint8_t brightness;
+    uint32_t lastUsed;          // ledCalibrationGen of the last layout using it
+    uint16_t lut[3][256];       // R, G, B: 8.8 fixed point, at most 255.0
+};
+
+// Room for the layout being built and the one the render task still draws
+#define LED_CALIBRATION_SLOTS (2 * MAX_CUBES)
+
+static LedCalibration ledCalibrations[LED_CALIBRATION_SLOTS];
+static LedCalibration ledUncalibrated;
+static uint8_t ledCalibrationCount = 0;
+static uint32_t ledCalibrationGen = 0;
+static volatile uint32_t ledCalibrationInUse = UINT32_MAX;  // Generation the render task draws, if running
+static uint8_t ledDitherFrame = 0;
+static uint32_t ledDitherSegments = 0;      // Sent segments still mid-dither (see ledOutputDithering())
+
+// 2^-(2^-(i+1)) in Q30, one per fraction bit of a Q16 exponent
+static const uint32_t ledExp2Bits[16] = {
+    0x2D413CCD, 0x35D13F33, 0x3AB031BA, 0x3D495F45,
+    0x3EA0ECB7, 0x3F4F8303, 0x3FA78457, 0x3FD3B2D6,
+    0x3FE9D595, 0x3FF4E9D4, 0x3FFA74AD, 0x3FFD3A47,
+    0x3FFE9D20, 0x3FFF4E8F, 0x3FFFA747, 0x3FFFD3A4,
+};
+
+// log2(v) in Q16 for v >= 1, one squaring per fraction bit
+static int32_t ledLog2(uint32_t v) {
+    int whole = 31 - __builtin_clz(v);
+    uint64_t y = ((uint64_t)v << 16) >> whole;     // Q16, in [1, 2)
+    int32_t result = whole << 16;
+    for (int32_t bit = 0x8000; bit; bit >>= 1) {
+        y = (y * y) >> 16;
+        if (y >= (2u << 16)) {
+            y >>= 1;
+            result |= bit;
+        }
+    }
+    return result;
+}
+
+// (v / 255) ^ (gamma / 10) in Q30, given depth = -log2(v / 255) in Q16;
+// gamma 0 is linear. Integer only: the C3 has no FPU, and soft-float powf()
+// for all 768 entries held up loop() for milliseconds.
+static uint32_t ledGammaCurve(uint8_t v, uint32_t depth, uint8_t gamma) {
+    if (v == 0) return 0;
+    if (gamma == 0 || v == 255) return ((uint64_t)v << 30) / 255;
     
-    if (accelMode) {
-        CRGB color = CRGB(accelR, accelG, accelB);
-        fill_solid(leds, totalLeds, color);
-        animFrame++;
-        return;
+    uint32_t e = (uint32_t)(((uint64_t)depth * gamma + 5) / 10);     // -log2 of the result, Q16
+    if ((e >> 16) >= 30) return 0;
+    uint64_t x = 1u << 30;
+    for (int i = 0; i < 16; i++) {
+        if (e & (0x8000 >> i)) x = (x * ledExp2Bits[i]) >> 30;
+    }
+    return (uint32_t)(x >> (e >> 16));
+}
+
+static void buildLedCalibration(LedCalibration* cal) {
+    uint32_t t = perfStart();
+    
+    // 0 is an unprogrammed cube: show it as is
+    uint32_t level = cal->brightness ? cal->brightness : 128;
+    uint64_t gain[3];       // Over 128 * 255
+    for (int c = 0; c < 3; c++) gain[c] = 65280ULL * level * cal->scale[c];
+    
+    int32_t log255 = ledLog2(255);
+    for (int v = 0; v < 256; v++) {
+        uint32_t depth = v ? log255 - ledLog2(v) : 0;
+        for (int c = 0; c < 3; c++) {
+            uint64_t out = (ledGammaCurve(v, depth, cal->gamma[c]) * gain[c] / (128 * 255) + (1u << 29)) >> 30;
+            cal->lut[c][v] = out < 65280 ? (uint16_t)out : 65280;
+        }
+    }
+    perfEnd(PERF_CALIBRATION, t);
+}
+
+// Table for a cube's calibration (loop() context). A new set of values takes
+// a never-used slot, else the one unused for longest among those neither the
+// new layout nor the render task's current one refers to: the task keeps
+// drawing with its old layout until it picks up the new one, so rebuilding
+// a slot it reads would tear its frames. Each layout needs at most MAX_CUBES
+// slots; only if the task has fallen several layouts behind can they run out,
+// and the cube is then sent uncorrected until the next layout.
+static const LedCalibration* ledCalibrationFor(const Cube* cube) {
+    uint32_t inUse = ledCalibrationInUse;
+    uint32_t keepFrom = inUse < ledCalibrationGen ? inUse : ledCalibrationGen;
+    LedCalibration* victim = nullptr;
+    for (int i = 0; i < ledCalibrationCount; i++) {
+        LedCalibration* cal = &ledCalibrations[i];
+        if (memcmp(cal->gamma, cube->gamma.gamma, 3) == 0 &&
+            memcmp(cal->scale, cube->gamma.scale, 3) == 0 &&
+            cal->brightness == cube->config.brightness) {
+            cal->lastUsed = ledCalibrationGen;
+            return cal;
+        }
+        if (cal->lastUsed < keepFrom && (!victim || cal->lastUsed < victim->lastUsed)) victim = cal;
     }
+    if (ledCalibrationCount < LED_CALIBRATION_SLOTS) victim = &ledCalibrations[ledCalibrationCount++];
+    if (!victim) return nullptr;
     
-    switch (currentAnimation) {
-        case 0:
-            for (int i = 0; i < totalLeds; i++) {
-                leds[i] = CHSV((animFrame + i * 10) % 256, 255, 200);
+    memcpy(victim->gamma, cube->gamma.gamma, 3);
+    memcpy(victim->scale, cube->gamma.scale, 3);
+    victim->brightness = cube->config.brightness;
+    victim->lastUsed = ledCalibrationGen;
+    buildLedCalibration(victim);
+    return victim;
+}
+
+// Frame counter with its bits reversed: over any 2^n frames the dither
+// offsets are spread evenly across 0-255, so a fraction of 0.5 alternates
+// every frame rather than every 128
+static uint8_t ledDitherBias() {
+    uint8_t b = ledDitherFrame++;
+    b = (b & 0xF0) >> 4 | (b & 0x0F) << 4;
+    b = (b & 0xCC) >> 2 | (b & 0x33) << 2;
+    b = (b & 0xAA) >> 1 | (b & 0x55) << 1;
+    return b;
+}
+
+// A channel level (8.8) whose fraction is still being dithered and is low
+// enough for a frozen step to show
+static inline uint32_t ledDitherVisible(uint32_t v) {
+    return v < (LED_DITHER_REFRESH << 8) && (v & 0xFF);
+}
+
+static rmt_channel_t ledRmtChannel(int output) {
+    return (rmt_channel_t)(RMT_CHANNEL_0 + output);
+}
+
+// RMT translator: one item per bit, MSB first. Runs in the RMT interrupt
+// each time the channel memory needs refilling.
+static void IRAM_ATTR ledTranslate(const void* src, rmt_item32_t* dest, size_t srcSize,
+                                   size_t wantedNum, size_t* translatedSize, size_t* itemNum) {
+    const uint8_t* p = (const uint8_t*)src;
+    size_t size = 0;
+    size_t num = 0;
+    while (size < srcSize && num + 8 <= wantedNum) {
+        uint8_t b = p[size++];
+        for (uint8_t mask = 0x80; mask; mask >>= 1) {
+            dest[num++].val = (b & mask) ? ledBit1.val : ledBit0.val;
+        }
+    }
+    *translatedSize = size;
+    *itemNum = num;
+}
+
+static uint32_t ledTicks(uint32_t ns, uint32_t clockHz) {
+    return (uint32_t)((uint64_t)ns * clockHz / 1000000000ULL);
+}
+
+bool ledOutputBegin() {
+    if (ledOutputReady) return true;
+    
+    uint32_t clockHz = 0;
+    for (int i = 0; i < LED_CHANNEL_COUNT; i++) {
+        rmt_config_t config = RMT_DEFAULT_CONFIG_TX((gpio_num_t)ledOutputPins[i], ledRmtChannel(i));
+        config.clk_div = LED_RMT_CLK_DIV;
+        if (rmt_config(&config) != ESP_OK ||
+            rmt_driver_install(config.channel, 0, 0) != ESP_OK ||
+            rmt_get_counter_clock(config.channel, &clockHz) != ESP_OK ||
+            rmt_translator_init(config.channel, ledTranslate) != ESP_OK) {
+            Serial.print(F("RMT init failed on LED output "));
+            Serial.print(i);
+            Serial.println(F(" - LED output disabled"));
+            return false;
+        }
+    }
+    
+    ledBit0.level0 = 1;
+    ledBit0.duration0 = ledTicks(WS2812_T0H_NS, clockHz);
+    ledBit0.level1 = 0;
+    ledBit0.duration1 = ledTicks(WS2812_T0L_NS, clockHz);
+    ledBit1.level0 = 1;
+    ledBit1.duration0 = ledTicks(WS2812_T1H_NS, clockHz);
+    ledBit1.level1 = 0;
+    ledBit1.duration1 = ledTicks(WS2812_T1L_NS, clockHz);
+    
+    memset(ledUncalibrated.gamma, 0, 3);
+    memset(ledUncalibrated.scale, 255, 3);
+    ledUncalibrated.brightness = 128;
+    buildLedCalibration(&ledUncalibrated);
+    
+    ledOutputReady = true;
+    return true;
+}
+
+// Starts sending the frame's segments and returns the number of LEDs sent;
+// frames sent back to back are kept apart by the caller's own cadence (the
+// latch needs only ~50 us). A WS2812 chain can only be cut short at its end,
+// so each output sends its cubes up to the last one set in segments and the
+// LEDs after that keep what they show.
+int ledOutputShow(const CRGB* frame, const RenderLayout* layout, uint8_t brightness, uint32_t segments) {
+    if (!ledOutputReady) return 0;
+    
+    ledOutputWait();
+    uint32_t level = brightness + 1;        // 256 = unity, as scale8()
+    uint32_t bias = ledDitherBias();
+    uint8_t* out = ledWire;
+    for (int ch = 0; ch < LED_CHANNEL_COUNT; ch++) {
+        int last = -1;
+        for (int s = 0; s < layout->segmentCount; s++) {
+            if (layout->segments[s].output == ch && (segments & (1u << s))) last = s;
+        }
+        
+        uint8_t* begin = out;
+        for (int s = 0; s <= last; s++) {
+            const RenderSegment* seg = &layout->segments[s];
+            if (seg->output != ch) continue;
+            const LedCalibration* cal = seg->calibration ? seg->calibration : &ledUncalibrated;
+            const uint8_t* order = ledColorOrders[seg->colorOrder < LED_COLOR_ORDER_COUNT ? seg->colorOrder : 0];
+            uint8_t c0 = order[0], c1 = order[1], c2 = order[2];
+            const uint16_t* lut0 = cal->lut[c0];
+            const uint16_t* lut1 = cal->lut[c1];
+            const uint16_t* lut2 = cal->lut[c2];
+            const uint8_t* px = frame[seg->start].raw;
+            uint32_t dither = 0;
+            for (int i = 0; i < seg->count; i++, px += 3) {
+                uint32_t v0 = (lut0[px[c0]] * level) >> 8;
+                uint32_t v1 = (lut1[px[c1]] * level) >> 8;
+                uint32_t v2 = (lut2[px[c2]] * level) >> 8;
+                *out++ = (v0 + bias) >> 8;
+                *out++ = (v1 + bias) >> 8;
+                *out++ = (v2 + bias) >> 8;
+                dither |= ledDitherVisible(v0) | ledDitherVisible(v1) | ledDitherVisible(v2);
             }
+            if (dither) ledDitherSegments |= 1u << s;
+            else ledDitherSegments &= ~(1u << s);
+        }
+        if (out > begin) rmt_write_sample(ledRmtChannel(ch), begin, out - begin, false);
+    }
+    return (out - ledWire) / 3;
+}
+
+// Segments whose last sent pixels include a low channel between two levels:
+// left standing, they would keep one dither step instead of averaging out
+uint32_t ledOutputDithering() {
+    return ledDitherSegments;
+}
+
+// Black over the full capacity of every output, whatever is chained on it
+void ledOutputClear() {
+    if (!ledOutputReady) return;
+    
+    ledOutputWait();
+    ledDitherSegments = 0;
+    memset(ledWire, 0, sizeof(ledWire));
+    for (int ch = 0; ch < LED_CHANNEL_COUNT; ch++) {
+        rmt_write_sample(ledRmtChannel(ch), ledWire, sizeof(ledWire), false);
+    }
+}
+
+// Blocks (without spinning) until every output has sent its last frame
+void ledOutputWait() {
+    if (!ledOutputReady) return;
+    for (int ch = 0; ch < LED_CHANNEL_COUNT; ch++) {
+        rmt_wait_tx_done(ledRmtChannel(ch), portMAX_DELAY);
+    }
+}
+
+// =============================================================================
+// Render Task
+// =============================================================================
+// Frames are rendered in their own task, above loop()'s priority, so bus
+// I/O, serial parsing and blocking waits in loop() no longer delay them. Each
+// frame is drawn into the back buffer (seeded with the last frame, which the
+// fading effects build on) and only then handed to the LED output, which
+// sends it in the background while the task sleeps until the next frame.
+// Cube-table changes reach the task through a sequence-counted snapshot:
+// loop() never waits for the renderer, and a frame that catches loop()
+// mid-update keeps the previous snapshot.
+//
+// Only what changed is sent. Each cube's pixels are compared with the front
+// buffer, which holds what the LEDs show; a frame with no change is not sent
+// at all, otherwise every output stops after its last changed cube. A new
+// layout, and every LED_KEEPALIVE_MS, sends the whole frame. Cubes with dim
+// channels between two output levels are sent every frame even when static,
+// so their temporal dither keeps running (ledOutputDithering()).
+
+RenderStats renderStats;
+
+static RenderLayout renderLayout;
+static volatile uint32_t renderLayoutSeq = 0;      // Odd while being written
+static uint32_t renderLayoutSeen = 1;              // Seq of the task's copy
+static uint32_t renderFullFrameMs = 0;
+static TaskHandle_t renderTaskHandle = nullptr;
+static volatile bool renderStopRequested = false;
+static volatile bool renderStopped = false;
+
+// Snapshot of the cube table (loop() context): the active cubes only, in
+// frame order (see compactCubeLeds()), with their output calibration
+void buildRenderLayout(RenderLayout* layout) {
+    layout->generation = ++ledCalibrationGen;
+    layout->totalLeds = totalLeds;
+    layout->segmentCount = 0;
+    for (int ch = 0; ch < LED_CHANNEL_COUNT; ch++) {
+        for (int i = 0; i < cubeCount; i++) {
+            if (!cubes[i].active || cubes[i].output != ch) continue;
+            RenderSegment* seg = &layout->segments[layout->segmentCount++];
+            seg->start = cubes[i].ledStart;
+            seg->count = cubes[i].ledCount;
+            seg->flashUntil = cubes[i].flashUntil;
+            seg->calibration = ledCalibrationFor(&cubes[i]);
+            seg->output = cubes[i].output;
+            seg->colorOrder = cubes[i].config.colorOrder;
+        }
+    }
+}
+
+// Called from loop() after every cube-table change
+void publishRenderLayout() {
+    renderLayoutSeq++;
+    __sync_synchronize();
+    buildRenderLayout(&renderLayout);
+    __sync_synchronize();
+    renderLayoutSeq++;
+}
+
+// Copy a newly published snapshot unless a publish is in progress or lands
+// mid-copy; the caller then keeps what it had (loop() cannot finish while we
+// spin here). Returns true if the layout changed.
+static bool readRenderLayout(RenderLayout* layout) {
+    uint32_t seq = renderLayoutSeq;
+    if ((seq & 1) || seq == renderLayoutSeen) return false;
+    __sync_synchronize();
+    RenderLayout copy;
+    memcpy(&copy, (const void*)&renderLayout, sizeof(copy));
+    __sync_synchronize();
+    if (seq != renderLayoutSeq) return false;
+    *layout = copy;
+    renderLayoutSeen = seq;
+    return true;
+}
+
+// Segments of back that differ from the front buffer (what the LEDs show)
+static uint32_t changedSegments(const CRGB* back, const RenderLayout* layout) {
+    uint32_t changed = 0;
+    for (int i = 0; i < layout->segmentCount; i++) {
+        const RenderSegment* seg = &layout->segments[i];
+        if (memcmp(&back[seg->start], &leds[seg->start], seg->count * sizeof(CRGB)) != 0) {
+            changed |= 1u << i;
+        }
+    }
+    return changed;
+}
+
+static void renderFrame(const RenderLayout* layout, bool layoutChanged) {
+    int count = layout->totalLeds;
+    if (count <= 0) return;
+    
+    uint32_t t = perfStart();
+    CRGB* back = (leds == frameBuffers[0]) ? frameBuffers[1] : frameBuffers[0];
+    memcpy(back, leds, count * sizeof(CRGB));
+    if (!ledsEnabled) {
+        pixelFill(back, count, CRGB::Black);
+    } else if (animationRunning) {
+        renderEffect(back, count);
+    }
+    
+    uint32_t now = millis();
+    for (int i = 0; i < layout->segmentCount; i++) {
+        const RenderSegment* seg = &layout->segments[i];
+        if ((int32_t)(seg->flashUntil - now) > 0) {
+            pixelFill(&back[seg->start], seg->count, CRGB::Green);
+        }
+    }
+    
+    perfEnd(PERF_RENDER, t);
+    
+    t = perfStart();
+    uint32_t send;
+    if (layoutChanged || (LED_KEEPALIVE_MS && now - renderFullFrameMs >= LED_KEEPALIVE_MS)) {
+        send = LED_ALL_SEGMENTS;
+        renderFullFrameMs = now;
+    } else {
+        send = changedSegments(back, layout) | ledOutputDithering();
+    }
+    
+    // Swap: the finished frame becomes the front buffer
+    leds = back;
+    if (send) {
+        int sent = ledOutputShow(leds, layout, LED_BRIGHTNESS, send);
+        renderStats.framesSent++;
+        renderStats.ledsSent += sent;
+        renderStats.ledsSkipped += count - sent;
+    } else {
+        renderStats.framesSkipped++;
+        renderStats.ledsSkipped += count;
+    }
+    perfEnd(PERF_SHOW, t);
+}
+
+static void renderTask(void* param) {
+    TickType_t lastWake = xTaskGetTickCount();
+    RenderLayout layout = {};
+    for (;;) {
+        if (renderStopRequested) {
+            renderStopped = true;
+            vTaskSuspend(nullptr);
+        }
+        bool layoutChanged = readRenderLayout(&layout);
+        if (layoutChanged) ledCalibrationInUse = layout.generation;
+        renderFrame(&layout, layoutChanged);
+        vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(ANIMATION_MS));
+    }
+}
+
+// The first frame is drawn before this returns (the task preempts loop())
+void startRenderTask() {
+    if (renderTaskHandle) return;
+    publishRenderLayout();
+    renderLayoutSeen = 1;       // Whatever the LEDs showed meanwhile, resend all
+    renderStopRequested = false;
+    renderStopped = false;
+    ledCalibrationInUse = 0;    // Until the task has its first layout
+    xTaskCreate(renderTask, "render", RENDER_TASK_STACK, nullptr, RENDER_TASK_PRIORITY, &renderTaskHandle);
+}
+
+// Waits for the current frame to finish; loop() owns the LEDs afterwards
+void stopRenderTask() {
+    if (!renderTaskHandle) return;
+    renderStopRequested = true;
+    while (!renderStopped) delay(1);
+    vTaskDelete(renderTaskHandle);
+    renderTaskHandle = nullptr;
+    ledCalibrationInUse = UINT32_MAX;
+}
+
+// =============================================================================
+// Frame Streaming
+// =============================================================================
+// Binary mode for driving the LEDs from a PC ("stream" command). Packets are
+//   A5 5A | type | flags | target (u16) | length (u16) | payload | CRC16 (u16)
+// little-endian; the CRC (inverted, as on the DS2431 pages) covers type
+// through payload. Payload is RGB, read from Serial straight into leds[]:
+// the render task is stopped and ledOutputShow() packs its own wire buffer,
+// so nothing displays leds[] until the next frame is shown. A packet with
+// STREAM_FLAG_SHOW shows the frame, unless one of its packets failed the CRC.
+// Pixels not addressed keep their last value.
+
+#define STREAM_HEADER_SIZE 6
+
+static_assert(sizeof(CRGB) == 3, "Stream payload is decoded straight into CRGB");
+
+enum FrameStreamState : uint8_t {
+    STREAM_WAIT_SYNC0,
+    STREAM_WAIT_SYNC1,
+    STREAM_RX_HEADER,
+    STREAM_RX_PAYLOAD,
+    STREAM_RX_CRC
+};
+
+struct FrameStream {
+    bool active;
+    FrameStreamState state;
+    uint8_t header[STREAM_HEADER_SIZE];
+    uint8_t crcRx[2];
+    uint8_t got;                // Header / CRC bytes received so far
+    uint8_t* dest;              // Where the next payload byte goes
+    uint16_t remaining;         // Payload bytes still to come
+    uint16_t crc;               // Running CRC16 from type on
+    bool frameBad;              // A packet of the current frame was dropped
+    uint32_t startMs;
+    uint32_t lastRxMs;
+    uint32_t packets;
+    uint32_t frames;
+    uint32_t framesDropped;
+    uint32_t crcErrors;
+    uint32_t badHeaders;
+};
+
+static FrameStream stream;
+
+void beginFrameStream() {
+    if (stream.active) return;
+    stopRenderTask();
+    memset(&stream, 0, sizeof(stream));
+    stream.active = true;
+    stream.state = STREAM_WAIT_SYNC0;
+    stream.startMs = millis();
+    stream.lastRxMs = stream.startMs;
+}
+
+bool frameStreamActive() {
+    return stream.active;
+}
+
+void endFrameStream() {
+    if (!stream.active) return;
+    stream.active = false;
+    
+    uint32_t ms = millis() - stream.startMs;
+    Serial.print(F("Stream ended: "));
+    Serial.print(stream.frames);
+    Serial.print(F(" frames ("));
+    Serial.print(ms ? stream.frames * 1000.0f / ms : 0.0f, 1);
+    Serial.print(F(" fps), "));
+    Serial.print(stream.packets);
+    Serial.print(F(" packets, "));
+    Serial.print(stream.crcErrors);
+    Serial.print(F(" CRC errors, "));
+    Serial.print(stream.badHeaders);
+    Serial.print(F(" bad headers, "));
+    Serial.print(stream.framesDropped);
+    Serial.println(F(" frames dropped"));
+    
+    // Effects pick up from the last streamed frame
+    startRenderTask();
+}
+
+// Header complete: check it and point the payload at its pixels
+static void streamStartPayload() {
+    uint8_t type = stream.header[0];
+    uint16_t target = stream.header[2] | (stream.header[3] << 8);
+    uint16_t length = stream.header[4] | (stream.header[5] << 8);
+    
+    stream.dest = nullptr;
+    if (type == STREAM_PIXELS) {
+        if (length % 3 == 0 && target + length / 3 <= MAX_TOTAL_LEDS) {
+            stream.dest = (uint8_t*)&leds[target];
+        }
+    } else if (type == STREAM_CUBE) {
+        if (target < cubeCount && cubes[target].active && length == cubes[target].ledCount * 3) {
+            stream.dest = (uint8_t*)&leds[cubes[target].ledStart];
+        }
+    } else if (type == STREAM_END) {
+        if (length == 0) stream.dest = (uint8_t*)leds;
+    }
+    
+    if (!stream.dest) {
+        // Not a packet we can take: look for the next sync
+        stream.badHeaders++;
+        stream.frameBad = true;
+        stream.state = STREAM_WAIT_SYNC0;
+        return;
+    }
+    stream.remaining = length;
+    stream.got = 0;
+    stream.state = length ? STREAM_RX_PAYLOAD : STREAM_RX_CRC;
+}
+
+static void streamFinishPacket() {
+    uint16_t rx = stream.crcRx[0] | (stream.crcRx[1] << 8);
+    stream.state = STREAM_WAIT_SYNC0;
+    if ((uint16_t)~stream.crc != rx) {
+        stream.crcErrors++;
+        if (stream.header[1] & STREAM_FLAG_SHOW) {
+            // Most likely still the end of the frame: the next packet starts a new one
+            stream.framesDropped++;
+            stream.frameBad = false;
+        } else {
+            stream.frameBad = true;
+        }
+        return;
+    }
+    stream.packets++;
+    
+    if (stream.header[0] == STREAM_END) {
+        endFrameStream();
+        return;
+    }
+    if (stream.header[1] & STREAM_FLAG_SHOW) {
+        if (stream.frameBad) {
+            stream.framesDropped++;
+        } else {
+            RenderLayout layout;
+            buildRenderLayout(&layout);
+            ledOutputShow(leds, &layout, LED_BRIGHTNESS, LED_ALL_SEGMENTS);
+            stream.frames++;
+        }
+        stream.frameBad = false;
+    }
+}
+
+static void streamByte(uint8_t c) {
+    switch (stream.state) {
+        case STREAM_WAIT_SYNC0:
+            // Bytes between packets mean one was lost: don't show a partial frame
+            if (c == STREAM_SYNC0) stream.state = STREAM_WAIT_SYNC1;
+            else stream.frameBad = true;
             break;
             
-        case 1:
-            {
-                uint8_t brightness = beatsin8(30, 50, 255);
-                for (int i = 0; i < totalLeds; i++) {
-                    leds[i] = CHSV(160, 255, brightness);
-                }
+        case STREAM_WAIT_SYNC1:
+            if (c == STREAM_SYNC1) {
+                stream.state = STREAM_RX_HEADER;
+                stream.got = 0;
+                stream.crc = 0;
+            } else if (c != STREAM_SYNC0) {
+                stream.state = STREAM_WAIT_SYNC0;
+                stream.frameBad = true;
             }
             break;
             
-        case 2:
-            fadeToBlackBy(leds, totalLeds, 100);
-            if (totalLeds > 0) {
-                leds[animFrame % totalLeds] = CRGB::Red;
-            }
+        case STREAM_RX_HEADER:
+            stream.header[stream.got++] = c;
+            stream.crc = OneWire::crc16(&c, 1, stream.crc);
+            if (stream.got == STREAM_HEADER_SIZE) streamStartPayload();
             break;
             
-        case 3:
-            fadeToBlackBy(leds, totalLeds, 50);
-            if (random8() < 80 && totalLeds > 0) {
-                leds[random16(totalLeds)] = CRGB::White;
-            }
+        case STREAM_RX_CRC:
+            stream.crcRx[stream.got++] = c;
+            if (stream.got == 2) streamFinishPacket();
             break;
             
-        case 4:
-            fill_solid(leds, totalLeds, CRGB::White);
-            break;
+        case STREAM_RX_PAYLOAD:
+            break;      // Taken in bulk by pollFrameStream()
     }
+}
+
+// Called from loop() in place of the command console; only takes the bytes
+// already received
+void pollFrameStream() {
+    if (!stream.active) return;
     
-    animFrame++;
+    int pending = Serial.available();
+    if (pending <= 0) {
+        if (millis() - stream.lastRxMs >= STREAM_IDLE_MS) {
+            Serial.println(F("Stream idle"));
+            endFrameStream();
+        }
+        return;
+    }
+    stream.lastRxMs = millis();
+    
+    while (pending > 0 && stream.active) {
+        if (stream.state == STREAM_RX_PAYLOAD) {
+            size_t n = (size_t)pending < stream.remaining ? (size_t)pending : stream.remaining;
+            n = Serial.readBytes(stream.dest, n);
+            if (n == 0) break;
+            stream.crc = OneWire::crc16(stream.dest, n, stream.crc);
+            stream.dest += n;
+            stream.remaining -= n;
+            pending -= n;
+            if (stream.remaining == 0) {
+                stream.got = 0;
+                stream.state = STREAM_RX_CRC;
+            }
+        } else {
+            int c = Serial.read();
+            if (c < 0) break;
+            pending--;
+            streamByte((uint8_t)c);
+        }
+    }
+}
+
+// =============================================================================
+// Accelerometer Telemetry
+// =============================================================================
+// "telem" sends every LIS3DH sample (100-400 Hz) in stream packets (see
+// Frame Streaming) of type STREAM_TELEMETRY: target is the sequence number
+// of the first sample, the payload 12-byte records of
+//   timestamp us (u32) | x, y, z raw (i16) | orientation | flip state
+// The samples come straight from the accelerometer cache, which is the ring
+// buffer here: packets go out only as fast as Serial has room, so a slow or
+// absent host never stalls loop(). Samples the cache overwrote before they
+// were sent count as dropped; the host sees the gap in the sequence numbers.
+
+#define TELEMETRY_PACKET_OVERHEAD 10    // Sync, header, CRC
+
+struct __attribute__((packed)) TelemetrySample {
+    uint32_t us;            // Sample time (AccelSample::us)
+    int16_t x;
+    int16_t y;
+    int16_t z;
+    uint8_t orientation;    // Axis carrying gravity: 0/1 = +X/-X, 2/3 = Y, 4/5 = Z
+    uint8_t flip;           // When sent - bit 7: upside down, bits 0-1: flip count
+};
+
+static_assert(sizeof(TelemetrySample) == 12, "Telemetry record layout");
+
+struct Telemetry {
+    bool active;
+    uint32_t nextSeq;       // Next accelerometer sample to send
+    uint32_t startOverruns; // accelFifoOverruns when started
+    uint32_t samples;
+    uint32_t dropped;       // Overwritten in the cache before they were sent
+    uint32_t packets;
+};
+
+static Telemetry telemetry;
+
+bool beginTelemetry(uint16_t hz) {
+    if (!lis3dhFound || (hz != 100 && hz != 200 && hz != 400)) return false;
+    memset(&telemetry, 0, sizeof(telemetry));
+    setAccelDataRate(hz);
+    telemetry.nextSeq = accelSampleCount();
+    telemetry.startOverruns = accelFifoOverruns;
+    telemetry.active = true;
+    return true;
+}
+
+bool telemetryActive() {
+    return telemetry.active;
+}
+
+void endTelemetry() {
+    if (!telemetry.active) return;
+    telemetry.active = false;
+    setAccelDataRate(ACCEL_DATA_RATE_HZ);
+    
+    Serial.print(F("Telemetry stopped: "));
+    Serial.print(telemetry.samples);
+    Serial.print(F(" samples, "));
+    Serial.print(telemetry.packets);
+    Serial.print(F(" packets, "));
+    Serial.print(telemetry.dropped);
+    Serial.print(F(" dropped, "));
+    Serial.print(accelFifoOverruns - telemetry.startOverruns);
+    Serial.println(F(" FIFO overruns"));
+}
+
+// One packet of the oldest unsent samples, if Serial can take it without blocking
+static void telemetrySend() {
+    uint32_t count = accelSampleCount() - telemetry.nextSeq;
+    if (count > ACCEL_CACHE_SIZE) {
+        telemetry.dropped += count - ACCEL_CACHE_SIZE;
+        telemetry.nextSeq += count - ACCEL_CACHE_SIZE;
+        count = ACCEL_CACHE_SIZE;
+    }
+    int room = (Serial.availableForWrite() - TELEMETRY_PACKET_OVERHEAD) / (int)sizeof(TelemetrySample);
+    if ((int)count > room) count = room > 0 ? room : 0;
+    if (count > TELEMETRY_BATCH_MAX) count = TELEMETRY_BATCH_MAX;
+    if (count == 0) return;
+    
+    uint8_t packet[TELEMETRY_PACKET_OVERHEAD + TELEMETRY_BATCH_MAX * sizeof(TelemetrySample)];
+    uint16_t first = (uint16_t)telemetry.nextSeq;
+    uint16_t length = count * sizeof(TelemetrySample);
+    packet[0] = STREAM_SYNC0;
+    packet[1] = STREAM_SYNC1;
+    packet[2] = STREAM_TELEMETRY;
+    packet[3] = 0;
+    packet[4] = first & 0xFF;
+    packet[5] = first >> 8;
+    packet[6] = length & 0xFF;
+    packet[7] = length >> 8;
+    
+    uint8_t flip = (isUpsideDown ? 0x80 : 0) | (flipCount & 0x03);
+    TelemetrySample* rec = (TelemetrySample*)(packet + 8);
+    for (uint32_t i = 0; i < count; i++, rec++) {
+        AccelSample s = {};
+        accelGetSample(telemetry.nextSeq++, &s);    // In the cache (checked above)
+        int16_t axes[3] = { s.x, s.y, s.z };
+        uint8_t best = 0;
+        for (uint8_t a = 1; a < 3; a++) {
+            if (abs(axes[a]) > abs(axes[best])) best = a;
+        }
+        rec->us = s.us;
+        rec->x = s.x;
+        rec->y = s.y;
+        rec->z = s.z;
+        rec->orientation = best * 2 + (axes[best] < 0 ? 1 : 0);
+        rec->flip = flip;
+    }
+    uint8_t* p = (uint8_t*)rec;
+    uint16_t crc = ~OneWire::crc16(packet + 2, 6 + length);
+    *p++ = crc & 0xFF;
+    *p++ = crc >> 8;
+    
+    Serial.write(packet, p - packet);
+    telemetry.samples += count;
+    telemetry.packets++;
+}
+
+void serviceTelemetry() {
+    if (!telemetry.active) return;
+    telemetrySend();
 }
 
 // =============================================================================
 // Hardware Initialization
 // =============================================================================
 
-void initializeHardware() {
+// resume: waking with the cube table restored from RTC memory. The strip is
+// already dark from enterDeepSleep(), so the clear and settle time are skipped.
+void initializeHardware(bool resume) {
+    // Known cubes can come up from NVS before their EEPROM is read
+    initCubeCache();
+    
     // Initialize LIS3DH
-    lis3dhFound = initLIS3DH();
-    
-    // Initialize FastLED with simple configuration
-    FastLED.addLeds<WS2812B, PIN_LED_DATA, GRB>(leds, MAX_TOTAL_LEDS);
-    FastLED.setBrightness(100);
-    FastLED.clear();
-    FastLED.show();
-    delay(100);  // Give FastLED time to stabilize
+    lis3dhFound = initLIS3DH(!resume);
+    
+    // WS2812 output through the RMT (FastLED is only used for color math)
+    ledOutputBegin();
+    if (!resume) {
+        fill_solid(leds, MAX_TOTAL_LEDS, CRGB::Black);
+        ledOutputClear();
+        delay(100);  // Let the strip settle
+    }
+    
+    // Hot-plugged 1-Wire devices pull the idle bus low with a presence pulse
+    attachInterrupt(digitalPinToInterrupt(PIN_ONEWIRE), onOneWireEdge, FALLING);
 }
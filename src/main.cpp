@@ -12,15 +12,27 @@
 // Forward Declarations
 // =============================================================================
 void processSerial();
-void programDevice(int deviceIdx, int cubeType, int ledCount);
+void programDevice(int deviceIdx, int cubeType, int ledCount, int output);
 void readDevice(int deviceIdx);
+void reportProgramResult();
+void resumeFromSleep();
 
 // =============================================================================
 // Setup
 // =============================================================================
 
 void setup() {
+    Serial.setRxBufferSize(SERIAL_RX_BUFFER);
     Serial.begin(115200);
+    
+    // Check wake reason (the ESP32-C3 wakes through GPIO, not EXT0)
+    esp_sleep_wakeup_cause_t wakeup_reason = esp_sleep_get_wakeup_cause();
+    bool wokeFromSleep = (wakeup_reason == ESP_SLEEP_WAKEUP_GPIO || wakeup_reason == ESP_SLEEP_WAKEUP_EXT0);
+    if (wokeFromSleep && restoreRetainedState()) {
+        resumeFromSleep();
+        return;
+    }
+    
     delay(2000);
     
     Serial.println(F("\n============================="));
@@ -30,14 +42,12 @@ void setup() {
     Serial.println(FIRMWARE_VERSION);
     Serial.println(F("=============================\n"));
     
-    // Check wake reason
-    esp_sleep_wakeup_cause_t wakeup_reason = esp_sleep_get_wakeup_cause();
-    if (wakeup_reason == ESP_SLEEP_WAKEUP_EXT0) {
+    if (wokeFromSleep) {
         Serial.println(F("*** Woke from deep sleep via double-tap! ***\n"));
     }
     
     // Initialize all hardware
-    initializeHardware();
+    initializeHardware(false);
     
     Serial.println(F("LED pin: D3 (GPIO4)"));
     Serial.println(F("1-Wire pin: D10 (GPIO21)"));
@@ -52,6 +62,7 @@ void setup() {
     
     Serial.println(F("\nScanning for cubes..."));
     scanOneWireBus();
+    startRenderTask();
     
     Serial.println(F("\nType 'help' for commands"));
     Serial.println(F("Gestures:"));
@@ -60,286 +71,602 @@ void setup() {
     Serial.println(F("  - Double-tap while asleep to wake\n"));
 }
 
+// Fast wake: the cube table came back from RTC memory, so skip the boot
+// delay and banner, show the first frame now and let the incremental scan
+// confirm the bus (and pick up cubes plugged in while asleep) from loop()
+void resumeFromSleep() {
+    initializeHardware(true);
+    beginOneWireScan();
+    startRenderTask();
+    
+    Serial.print(F("\n*** Woke from deep sleep via double-tap: "));
+    Serial.print(activeCubeCount());
+    Serial.print(F(" cubes restored, first frame at "));
+    Serial.print(millis());
+    Serial.println(F(" ms ***"));
+}
+
 // =============================================================================
 // Main Loop
 // =============================================================================
 
+// Each step is timed into its perf histogram ("perf"); the timings include
+// any render-task frame that preempts the step
 void loop() {
     uint32_t now = millis();
+    uint32_t loopStart = perfStart();
+    uint32_t t;
     
-    // Check for sleep request
-    if (sleepRequested) {
+    // Check for sleep request; a cube being programmed is finished first
+    // (below) so no page is left half-written or unpowered during tPROG
+    if (sleepRequested && !ds2431WriteBusy()) {
         enterDeepSleep();
         // Never returns from here
     }
     
-    handleDoubleTap();
-    
-    processSerial();
+    // Interrupt edges queued since the last pass (INT1, 1-Wire presence)
+    serviceIsrEvents();
     
+    // Accelerometer samples arrive in FIFO bursts; consumers use the cache
+    t = perfStart();
+    serviceAccelFifo();
     if (now - lastAccel >= ACCEL_UPDATE_MS) {
         lastAccel = now;
         updateAccelerometer();
     }
+    serviceTelemetry();
+    perfEnd(PERF_ACCEL, t);
     
-    if (now - lastOrientationCheck >= ORIENTATION_CHECK_MS) {
-        lastOrientationCheck = now;
-        checkOrientation();
+    t = perfStart();
+    handleDoubleTap();
+    perfEnd(PERF_DOUBLE_TAP, t);
+    
+    t = perfStart();
+    processSerial();
+    perfEnd(PERF_SERIAL, t);
+    
+    t = perfStart();
+    checkOrientation();
+    perfEnd(PERF_ORIENTATION, t);
+    
+    t = perfStart();
+    
+    // Cube programming advances one bus step per pass (scan waits for it)
+    if (ds2431WriteBusy() && stepDs2431Write()) {
+        reportProgramResult();
     }
     
     if (now - lastPoll >= ONEWIRE_POLL_MS) {
         lastPoll = now;
-        scanOneWireBus();
+        if (!oneWireScanBusy()) beginOneWirePoll();
     }
+    stepOneWireScan(ONEWIRE_SCAN_BUDGET_US);
+    serviceCubeCache();
+    perfEnd(PERF_ONEWIRE, t);
     
-    if (now - lastAnim >= ANIMATION_MS) {
-        lastAnim = now;
-        if (totalLeds > 0) {
-            runAnimation();
-            FastLED.show();
-        }
-    }
+    // Frames are rendered and shown by the render task
+    perfEnd(PERF_LOOP, loopStart);
 }
 
 // =============================================================================
 // Serial Command Handler
 // =============================================================================
+// Bytes are gathered into a fixed line buffer as they arrive, so a slow host
+// or a half-typed command never holds up loop(). A complete line is split into
+// its command word and arguments and looked up in a sorted table.
 
-void processSerial() {
-    if (!Serial.available()) return;
-    
-    String cmd = Serial.readStringUntil('\n');
-    cmd.trim();
-    
-    if (cmd == "help" || cmd == "?") {
-        Serial.println(F("\n=== LED Cube Hub (ESP32-C3 + LIS3DH) ==="));
-        Serial.print(F("Firmware v")); Serial.println(FIRMWARE_VERSION);
-        Serial.println(F("Commands:"));
-        Serial.println(F("  status    - Show system status"));
-        Serial.println(F("  scan      - Rescan 1-Wire bus"));
-        Serial.println(F("  list      - List detected DS2431 devices"));
-        Serial.println(F("  next      - Next animation"));
-        Serial.println(F("  on        - Resume animation"));
-        Serial.println(F("  off       - LEDs off"));
-        Serial.println(F("  accel     - Toggle accelerometer mode (XYZ->RGB)"));
-        Serial.println(F("  xyz       - Print current accelerometer data"));
-        Serial.println(F("  tap       - Read CLICK_SRC register (debug)"));
-        Serial.println(F("  sleep     - Enter deep sleep immediately"));
-        Serial.println(F("  prog <idx> <type> <leds> - Program device"));
-        Serial.println(F("  read <idx> - Read device config"));
-        Serial.println(F("\nGestures:"));
-        Serial.println(F("  Double-tap: Toggle LEDs on/off"));
-        Serial.println(F("  Flip upside down 2x (within 2s): Enter sleep mode"));
-        Serial.println(F("  Double-tap while sleeping: Wake up"));
-    }
-    else if (cmd == "status") {
-        Serial.println(F("\n=== Status ==="));
-        Serial.print(F("Firmware: v")); Serial.println(FIRMWARE_VERSION);
-        Serial.print(F("Built: ")); Serial.print(BUILD_DATE); 
-        Serial.print(F(" ")); Serial.println(BUILD_TIME);
-        Serial.println(F("Board: XIAO ESP32-C3"));
-        Serial.print(F("LIS3DH: "));
-        Serial.println(lis3dhFound ? F("Found") : F("Not found"));
-        Serial.print(F("LEDs enabled: "));
-        Serial.println(ledsEnabled ? F("ON") : F("OFF"));
-        Serial.print(F("Accel mode: "));
-        Serial.println(accelMode ? F("ON") : F("OFF"));
-        Serial.print(F("Cubes: "));
-        Serial.println(cubeCount);
-        Serial.print(F("Total LEDs: "));
-        Serial.println(totalLeds);
-        Serial.print(F("Animation: "));
-        Serial.print(currentAnimation);
-        Serial.println(animationRunning ? F(" (running)") : F(" (stopped)"));
-        Serial.print(F("Free RAM: "));
-        Serial.println(freeRam());
-        Serial.print(F("Upside down: "));
-        Serial.println(isUpsideDown ? F("YES") : F("NO"));
-        Serial.print(F("Flip count: "));
-        Serial.println(flipCount);
-        Serial.print(F("INT1 pin state: "));
-        Serial.println(digitalRead(PIN_LIS3DH_INT) ? F("HIGH") : F("LOW"));
-        
-        for (int i = 0; i < cubeCount; i++) {
-            if (!cubes[i].active) continue;
-            Serial.print(F("  Cube "));
-            Serial.print(i);
-            Serial.print(F(": Type="));
-            Serial.print(cubes[i].config.cubeType);
-            Serial.print(F(" LEDs="));
-            Serial.print(cubes[i].ledStart);
-            Serial.print(F("-"));
-            Serial.println(cubes[i].ledStart + cubes[i].ledCount - 1);
-        }
+#define SERIAL_LINE_MAX 64
+
+typedef void (*CommandHandler)(const char* args);
+
+struct SerialCommand {
+    const char* name;
+    const char* args;           // For help
+    const char* help;
+    CommandHandler handler;
+};
+
+static char serialLine[SERIAL_LINE_MAX];
+static uint8_t serialLineLen = 0;
+static bool serialLineOverflow = false;     // Dropping the rest of a long line
+
+static void cmdHelp(const char* args);
+
+static void cmdStatus(const char* args) {
+    Serial.println(F("\n=== Status ==="));
+    Serial.print(F("Firmware: v")); Serial.println(FIRMWARE_VERSION);
+    Serial.print(F("Built: ")); Serial.print(BUILD_DATE); 
+    Serial.print(F(" ")); Serial.println(BUILD_TIME);
+    Serial.println(F("Board: XIAO ESP32-C3"));
+    Serial.print(F("LIS3DH: "));
+    Serial.println(lis3dhFound ? F("Found") : F("Not found"));
+    Serial.print(F("LEDs enabled: "));
+    Serial.println(ledsEnabled ? F("ON") : F("OFF"));
+    Serial.print(F("Accel mode: "));
+    Serial.println(accelMode ? F("ON") : F("OFF"));
+    Serial.print(F("Cubes: "));
+    Serial.println(activeCubeCount());
+    Serial.print(F("Total LEDs: "));
+    Serial.print(totalLeds);
+    Serial.print(F(" of "));
+    Serial.print(MAX_TOTAL_LEDS);
+    Serial.print(F(" on "));
+    Serial.print(LED_CHANNEL_COUNT);
+    Serial.println(F(" output(s)"));
+    Serial.print(F("Animation: "));
+    Serial.print(currentAnimation);
+    Serial.print(' ');
+    Serial.print(effectAt(currentAnimation) ? effectAt(currentAnimation)->name : "?");
+    Serial.println(animationRunning ? F(" (running)") : F(" (stopped)"));
+    Serial.print(F("Effects: "));
+    Serial.print(effectCount());
+    Serial.print(F(", state arena "));
+    Serial.print(effectArenaUsed());
+    Serial.print(F(" of "));
+    Serial.print(EFFECT_ARENA_BYTES);
+    Serial.println(F(" bytes"));
+    Serial.print(F("Free RAM: "));
+    Serial.println(freeRam());
+    Serial.print(F("Upside down: "));
+    Serial.println(isUpsideDown ? F("YES") : F("NO"));
+    Serial.print(F("Flip count: "));
+    Serial.println(flipCount);
+    Serial.print(F("INT1 pin state: "));
+    Serial.println(digitalRead(PIN_LIS3DH_INT) ? F("HIGH") : F("LOW"));
+    Serial.print(F("ISR events: peak "));
+    Serial.print(isrEventPeak);
+    Serial.print(F(" of "));
+    Serial.print(ISR_EVENT_QUEUE_SIZE);
+    Serial.print(F(" queued, "));
+    Serial.print(isrEventsDropped);
+    Serial.println(F(" dropped"));
+    Serial.print(F("LED frames: "));
+    Serial.print(renderStats.framesSent);
+    Serial.print(F(" sent, "));
+    Serial.print(renderStats.framesSkipped);
+    Serial.print(F(" unchanged; "));
+    Serial.print(renderStats.ledsSkipped);
+    Serial.print(F(" of "));
+    Serial.print(renderStats.ledsSent + renderStats.ledsSkipped);
+    Serial.print(F(" LED updates skipped (~"));
+    Serial.print((uint32_t)((uint64_t)renderStats.ledsSkipped * WS2812_LED_US / 1000));
+    Serial.println(F(" ms of transfer)"));
+    
+    for (int i = 0; i < cubeCount; i++) {
+        if (!cubes[i].active) continue;
+        Serial.print(F("  Cube "));
+        Serial.print(i);
+        Serial.print(F(": Type="));
+        Serial.print(cubes[i].config.cubeType);
+        Serial.print(F(" LEDs="));
+        Serial.print(cubes[i].ledStart);
+        Serial.print(F("-"));
+        Serial.print(cubes[i].ledStart + cubes[i].ledCount - 1);
+        Serial.print(F(" Out="));
+        Serial.println(cubes[i].output);
+    }
+}
+
+static void cmdScan(const char* args) {
+    if (ds2431WriteBusy()) {
+        Serial.println(F("Busy - programming in progress"));
+        return;
+    }
+    Serial.println(F("Scanning..."));
+    scanOneWireBus();
+    Serial.println(F("Done"));
+}
+
+static void cmdList(const char* args) {
+    if (ds2431WriteBusy()) {
+        Serial.println(F("Busy - programming in progress"));
+        return;
     }
-    else if (cmd == "scan") {
-        Serial.println(F("Scanning..."));
-        scanOneWireBus();
-        Serial.println(F("Done"));
-    }
-    else if (cmd == "list") {
-        Serial.println(F("\nDS2431 devices on bus:"));
-        uint8_t addr[8];
-        int count = 0;
-        oneWire.reset_search();
-        while (oneWire.search(addr)) {
-            if (isDS2431(addr)) {
-                Serial.print(F("  ["));
-                Serial.print(count);
-                Serial.print(F("] "));
-                for (int i = 0; i < 8; i++) {
-                    if (addr[i] < 16) Serial.print('0');
-                    Serial.print(addr[i], HEX);
-                    if (i < 7) Serial.print(':');
-                }
-                Serial.println();
-                count++;
+    
+    Serial.println(F("\nDS2431 devices on bus:"));
+    uint8_t addr[8];
+    int count = 0;
+    cancelOneWireScan();
+    owResetSearch();
+    while (owSearch(addr)) {
+        if (isDS2431(addr)) {
+            Serial.print(F("  ["));
+            Serial.print(count);
+            Serial.print(F("] "));
+            for (int i = 0; i < 8; i++) {
+                if (addr[i] < 16) Serial.print('0');
+                Serial.print(addr[i], HEX);
+                if (i < 7) Serial.print(':');
             }
-        }
-        if (count == 0) {
-            Serial.println(F("  None found"));
+            Serial.println();
+            count++;
         }
     }
-    else if (cmd == "next") {
-        accelMode = false;
-        currentAnimation = (currentAnimation + 1) % 5;
-        animationRunning = true;
-        ledsEnabled = true;
-        Serial.print(F("Animation: "));
-        Serial.println(currentAnimation);
+    if (count == 0) {
+        Serial.println(F("  None found"));
     }
-    else if (cmd == "on") {
+}
+
+static void cmdNext(const char* args) {
+    accelMode = false;
+    currentAnimation = (currentAnimation + 1) % effectCount();
+    animationRunning = true;
+    ledsEnabled = true;
+    Serial.print(F("Animation: "));
+    Serial.print(currentAnimation);
+    Serial.print(' ');
+    Serial.println(effectAt(currentAnimation)->name);
+}
+
+static void cmdOn(const char* args) {
+    animationRunning = true;
+    ledsEnabled = true;
+    Serial.println(F("Animation resumed"));
+}
+
+static void cmdOff(const char* args) {
+    animationRunning = false;
+    accelMode = false;
+    ledsEnabled = false;
+    Serial.println(F("LEDs off"));
+}
+
+static void cmdAccel(const char* args) {
+    if (!lis3dhFound) {
+        Serial.println(F("LIS3DH not available!"));
+    } else {
+        accelMode = !accelMode;
         animationRunning = true;
         ledsEnabled = true;
-        Serial.println(F("Animation resumed"));
-    }
-    else if (cmd == "off") {
-        animationRunning = false;
-        accelMode = false;
-        ledsEnabled = false;
-        fill_solid(leds, MAX_TOTAL_LEDS, CRGB::Black);
-        FastLED.show();
-        Serial.println(F("LEDs off"));
-    }
-    else if (cmd == "accel") {
-        if (!lis3dhFound) {
-            Serial.println(F("LIS3DH not available!"));
-        } else {
-            accelMode = !accelMode;
-            animationRunning = true;
-            ledsEnabled = true;
-            Serial.print(F("Accelerometer mode: "));
-            Serial.println(accelMode ? F("ON (X=R, Y=G, Z=B)") : F("OFF"));
-        }
+        Serial.print(F("Accelerometer mode: "));
+        Serial.println(accelMode ? F("ON (X=R, Y=G, Z=B)") : F("OFF"));
     }
-    else if (cmd == "xyz") {
-        printAccelData();
-    }
-    else if (cmd == "tap") {
-        // Debug: manually read click source register
-        uint8_t clickSrc = readReg(0x39);
-        Serial.print(F("CLICK_SRC: 0x"));
-        Serial.print(clickSrc, HEX);
-        Serial.print(F(" ("));
-        if (clickSrc & 0x40) Serial.print(F("IA "));
-        if (clickSrc & 0x20) Serial.print(F("DCLICK "));
-        if (clickSrc & 0x10) Serial.print(F("SCLICK "));
-        if (clickSrc & 0x04) Serial.print(F("Z "));
-        if (clickSrc & 0x02) Serial.print(F("Y "));
-        if (clickSrc & 0x01) Serial.print(F("X "));
-        Serial.println(F(")"));
-        Serial.print(F("INT1 pin: "));
-        Serial.println(digitalRead(PIN_LIS3DH_INT) ? F("HIGH") : F("LOW"));
+}
+
+static void cmdXyz(const char* args) {
+    printAccelData();
+}
+
+static void cmdTap(const char* args) {
+    // Debug: manually read click source register
+    uint8_t clickSrc = readReg(0x39);
+    Serial.print(F("CLICK_SRC: 0x"));
+    Serial.print(clickSrc, HEX);
+    Serial.print(F(" ("));
+    if (clickSrc & 0x40) Serial.print(F("IA "));
+    if (clickSrc & 0x20) Serial.print(F("DCLICK "));
+    if (clickSrc & 0x10) Serial.print(F("SCLICK "));
+    if (clickSrc & 0x04) Serial.print(F("Z "));
+    if (clickSrc & 0x02) Serial.print(F("Y "));
+    if (clickSrc & 0x01) Serial.print(F("X "));
+    Serial.println(F(")"));
+    Serial.print(F("INT1 pin: "));
+    Serial.println(digitalRead(PIN_LIS3DH_INT) ? F("HIGH") : F("LOW"));
+}
+
+static void cmdSleep(const char* args) {
+    Serial.println(F("Entering sleep mode via command..."));
+    sleepRequested = true;
+}
+
+static void cmdProg(const char* args) {
+    int idx, type, ledCount, output = 0;
+    int n = sscanf(args, "%d %d %d %d", &idx, &type, &ledCount, &output);
+    if (n >= 3 && output >= 0 && output < LED_CHANNEL_COUNT) {
+        programDevice(idx, type, ledCount, output);
+    } else {
+        Serial.println(F("Usage: prog <idx> <type> <leds> [out]"));
+        Serial.println(F("Types: 1=Corner 2=Edge 3=Center 4=Hub"));
+        Serial.print(F("Out: LED output the cube is chained on, 0-"));
+        Serial.println(LED_CHANNEL_COUNT - 1);
     }
-    else if (cmd == "sleep") {
-        Serial.println(F("Entering sleep mode via command..."));
-        sleepRequested = true;
+}
+
+static void cmdRead(const char* args) {
+    readDevice(atoi(args));
+}
+
+static void cmdPerf(const char* args) {
+    if (!*args) {
+        perfPrint();
+    } else if (!strcmp(args, "reset")) {
+        perfReset();
+        Serial.println(F("Perf counters cleared"));
+    } else if (!strcmp(args, "dump")) {
+        perfDump();
+    } else {
+        Serial.println(F("Usage: perf [reset|dump]"));
     }
-    else if (cmd.startsWith("prog ")) {
-        int idx, type, ledCount;
-        if (sscanf(cmd.c_str(), "prog %d %d %d", &idx, &type, &ledCount) == 3) {
-            programDevice(idx, type, ledCount);
-        } else {
-            Serial.println(F("Usage: prog <idx> <type> <leds>"));
-            Serial.println(F("Types: 1=Corner 2=Edge 3=Center 4=Hub"));
-        }
+}
+
+static void cmdStream(const char* args) {
+    Serial.println(F("Streaming - send frame packets; END or 2 s idle returns to the console"));
+    beginFrameStream();
+}
+
+static void cmdTelem(const char* args) {
+    if (!strcmp(args, "off")) {
+        if (!telemetryActive()) Serial.println(F("Telemetry not running"));
+        endTelemetry();
+        return;
+    }
+    int hz = *args ? atoi(args) : ACCEL_DATA_RATE_HZ;
+    if (!lis3dhFound) {
+        Serial.println(F("LIS3DH not available"));
+    } else if (beginTelemetry(hz)) {
+        Serial.print(F("Telemetry at "));
+        Serial.print(hz);
+        Serial.println(F(" Hz (binary packets; telem off to stop)"));
+    } else {
+        Serial.println(F("Usage: telem [100|200|400|off]"));
+    }
+}
+
+static void cmdCache(const char* args) {
+    if (!*args) {
+        Serial.println(F("\nCached cube configs:"));
+        printCubeCache();
+    } else if (!strcmp(args, "clear")) {
+        cubeCacheClear();
+        Serial.println(F("Cube config cache cleared"));
+    } else {
+        Serial.println(F("Usage: cache [clear]"));
+    }
+}
+
+// Sorted by name (checked at compile time) for the binary search
+static constexpr SerialCommand serialCommands[] = {
+    { "?",      "",                          "Same as help",                      cmdHelp },
+    { "accel",  "",                          "Toggle accelerometer mode (XYZ->RGB)", cmdAccel },
+    { "cache",  "[clear]",                   "List / forget cached cube configs", cmdCache },
+    { "help",   "",                          "Show this list",                    cmdHelp },
+    { "list",   "",                          "List detected DS2431 devices",      cmdList },
+    { "next",   "",                          "Next animation",                    cmdNext },
+    { "off",    "",                          "LEDs off",                          cmdOff },
+    { "on",     "",                          "Resume animation",                  cmdOn },
+    { "perf",   "[reset|dump]",              "Hot-path timings (min/avg/max/p99 us)", cmdPerf },
+    { "prog",   "<idx> <type> <leds> [out]", "Program device",                    cmdProg },
+    { "read",   "<idx>",                     "Read device config",                cmdRead },
+    { "scan",   "",                          "Rescan 1-Wire bus",                 cmdScan },
+    { "sleep",  "",                          "Enter deep sleep immediately",      cmdSleep },
+    { "status", "",                          "Show system status",                cmdStatus },
+    { "stream", "",                          "Binary frame streaming mode",       cmdStream },
+    { "tap",    "",                          "Read CLICK_SRC register (debug)",   cmdTap },
+    { "telem",  "[hz|off]",                  "Binary accel telemetry (100/200/400 Hz)", cmdTelem },
+    { "xyz",    "",                          "Print current accelerometer data",  cmdXyz },
+};
+
+#define SERIAL_COMMAND_COUNT (sizeof(serialCommands) / sizeof(serialCommands[0]))
+
+static constexpr int commandNameCompare(const char* a, const char* b) {
+    while (*a && *a == *b) {
+        a++;
+        b++;
     }
-    else if (cmd.startsWith("read ")) {
-        int idx = cmd.substring(5).toInt();
-        readDevice(idx);
+    return (unsigned char)*a - (unsigned char)*b;
+}
+
+static constexpr bool serialCommandsSorted() {
+    for (size_t i = 1; i < SERIAL_COMMAND_COUNT; i++) {
+        if (commandNameCompare(serialCommands[i - 1].name, serialCommands[i].name) >= 0) return false;
     }
-    else if (cmd.length() > 0) {
+    return true;
+}
+
+static_assert(serialCommandsSorted(), "serialCommands must be sorted by name");
+
+static const SerialCommand* findCommand(const char* name) {
+    int lo = 0;
+    int hi = SERIAL_COMMAND_COUNT - 1;
+    while (lo <= hi) {
+        int mid = (lo + hi) / 2;
+        int cmp = strcmp(name, serialCommands[mid].name);
+        if (cmp == 0) return &serialCommands[mid];
+        if (cmp < 0) hi = mid - 1;
+        else lo = mid + 1;
+    }
+    return nullptr;
+}
+
+static void cmdHelp(const char* args) {
+    Serial.println(F("\n=== LED Cube Hub (ESP32-C3 + LIS3DH) ==="));
+    Serial.print(F("Firmware v")); Serial.println(FIRMWARE_VERSION);
+    Serial.println(F("Commands:"));
+    for (size_t i = 0; i < SERIAL_COMMAND_COUNT; i++) {
+        const SerialCommand* c = &serialCommands[i];
+        if (c->handler == cmdHelp && strcmp(c->name, "help")) continue;   // Aliases
+        char usage[40];
+        snprintf(usage, sizeof(usage), "%s %s", c->name, c->args);
+        char line[96];
+        snprintf(line, sizeof(line), "  %-9s - %s", usage, c->help);
+        Serial.println(line);
+    }
+    Serial.println(F("\nGestures:"));
+    Serial.println(F("  Double-tap: Toggle LEDs on/off"));
+    Serial.println(F("  Flip upside down 2x (within 2s): Enter sleep mode"));
+    Serial.println(F("  Double-tap while sleeping: Wake up"));
+}
+
+// Splits "word args" in place and runs the command
+static void dispatchLine(char* line) {
+    // Trim both ends, like String::trim()
+    while (isspace((unsigned char)*line)) line++;
+    char* end = line + strlen(line);
+    while (end > line && isspace((unsigned char)end[-1])) *--end = '\0';
+    if (!*line) return;
+    
+    char* args = line;
+    while (*args && !isspace((unsigned char)*args)) args++;
+    if (*args) {
+        *args++ = '\0';
+        while (isspace((unsigned char)*args)) args++;
+    }
+    
+    const SerialCommand* cmd = findCommand(line);
+    if (cmd) {
+        cmd->handler(args);
+    } else {
         Serial.print(F("Unknown: "));
-        Serial.println(cmd);
+        Serial.println(line);
     }
 }
 
-void programDevice(int deviceIdx, int cubeType, int ledCount) {
-    uint8_t addr[8];
-    int count = 0;
+// Takes only the bytes already received; runs at most one command per pass
+void processSerial() {
+    if (frameStreamActive()) {
+        pollFrameStream();
+        return;
+    }
     
-    oneWire.reset_search();
-    while (oneWire.search(addr)) {
-        if (isDS2431(addr)) {
-            if (count == deviceIdx) {
-                CubeConfig config;
-                memset(&config, 0, sizeof(config));
-                config.cubeType = cubeType;
-                config.ledCount = ledCount;
-                config.colorOrder = 0;
-                config.brightness = 128;
-                
-                Serial.print(F("Programming device "));
-                Serial.print(deviceIdx);
-                Serial.print(F(" as type "));
-                Serial.print(cubeType);
-                Serial.print(F(" with "));
-                Serial.print(ledCount);
-                Serial.println(F(" LEDs..."));
-                
-                if (ds2431WritePage(addr, 0, (uint8_t*)&config)) {
-                    Serial.println(F("SUCCESS!"));
-                    scanOneWireBus();
-                } else {
-                    Serial.println(F("FAILED!"));
-                }
-                return;
+    int pending = Serial.available();
+    while (pending-- > 0) {
+        int c = Serial.read();
+        if (c < 0) break;
+        
+        if (c == '\n' || c == '\r') {
+            bool overflow = serialLineOverflow;
+            serialLine[serialLineLen] = '\0';
+            serialLineLen = 0;
+            serialLineOverflow = false;
+            if (overflow) {
+                Serial.println(F("Line too long - ignored"));
+            } else {
+                dispatchLine(serialLine);
             }
-            count++;
+            return;
         }
+        
+        if (serialLineLen < SERIAL_LINE_MAX - 1) {
+            serialLine[serialLineLen++] = (char)c;
+        } else {
+            serialLineOverflow = true;
+        }
+    }
+}
+
+void programDevice(int deviceIdx, int cubeType, int ledCount, int output) {
+    uint8_t addr[8];
+    
+    if (ds2431WriteBusy()) {
+        Serial.println(F("Busy - programming in progress"));
+        return;
+    }
+    
+    cancelOneWireScan();
+    if (!findOneWireDevice(deviceIdx, addr)) {
+        Serial.println(F("Device not found"));
+        return;
+    }
+    
+    // Only the config fields change; calibration pages stay as they are
+    CubeMemory mem;
+    CubeMemoryStatus status = readCubeMemory(addr, &mem);
+    if (status == CUBE_MEM_ABSENT) {
+        Serial.println(F("Read failed!"));
+        return;
+    }
+    cubeMemoryReprogram(&mem, status, cubeType, ledCount);
+    mem.config.output = output;
+    cubeMemorySeal(&mem);
+    
+    Serial.print(F("Programming device "));
+    Serial.print(deviceIdx);
+    Serial.print(F(" as type "));
+    Serial.print(cubeType);
+    Serial.print(F(" with "));
+    Serial.print(ledCount);
+    Serial.print(F(" LEDs on output "));
+    Serial.print(output);
+    Serial.println(F("..."));
+    
+    // Runs from loop(); unchanged rows are skipped and the config page is
+    // written last, so an interrupted write never leaves a half-written config
+    beginDs2431Write(addr, 0, (uint8_t*)&mem, sizeof(mem));
+}
+
+void reportProgramResult() {
+    const Ds2431WriteResult& result = ds2431LastWrite();
+    if (!result.ok) {
+        Serial.print(F("FAILED! ("));
+        Serial.print(result.error);
+        Serial.println(F(")"));
+        return;
+    }
+    
+    Serial.print(F("SUCCESS! "));
+    Serial.print(result.rowsWritten);
+    Serial.print(F(" rows written, "));
+    Serial.print(result.rowsSkipped);
+    Serial.print(F(" unchanged, "));
+    Serial.print(result.elapsedMs);
+    Serial.println(F(" ms"));
+    
+    // Re-read the cube so a changed config takes effect
+    if (result.rowsWritten > 0) {
+        removeCube(result.romId);
+        beginOneWireScan();
     }
-    Serial.println(F("Device not found"));
 }
 
 void readDevice(int deviceIdx) {
     uint8_t addr[8];
-    int count = 0;
     
-    oneWire.reset_search();
-    while (oneWire.search(addr)) {
-        if (isDS2431(addr)) {
-            if (count == deviceIdx) {
-                Serial.print(F("\nDevice "));
-                Serial.print(deviceIdx);
-                Serial.println(F(" config:"));
-                
-                CubeConfig config;
-                if (ds2431ReadPage(addr, 0, (uint8_t*)&config)) {
-                    Serial.print(F("  Type: "));
-                    Serial.println(config.cubeType);
-                    Serial.print(F("  LEDs: "));
-                    Serial.println(config.ledCount);
-                    Serial.print(F("  Color order: "));
-                    Serial.println(config.colorOrder);
-                    Serial.print(F("  Brightness: "));
-                    Serial.println(config.brightness);
-                } else {
-                    Serial.println(F("  Read failed!"));
-                }
-                return;
-            }
-            count++;
-        }
+    if (ds2431WriteBusy()) {
+        Serial.println(F("Busy - programming in progress"));
+        return;
+    }
+    
+    cancelOneWireScan();
+    if (!findOneWireDevice(deviceIdx, addr)) {
+        Serial.println(F("Device not found"));
+        return;
+    }
+    
+    Serial.print(F("\nDevice "));
+    Serial.print(deviceIdx);
+    Serial.println(F(" config:"));
+    
+    CubeMemory mem;
+    CubeMemoryStatus status = readCubeMemory(addr, &mem);
+    if (status == CUBE_MEM_ABSENT || status == CUBE_MEM_CORRUPT) {
+        Serial.println(status == CUBE_MEM_CORRUPT ? F("  CRC error!") : F("  Read failed!"));
+        return;
+    }
+    
+    Serial.print(F("  Type: "));
+    Serial.println(mem.config.cubeType);
+    Serial.print(F("  LEDs: "));
+    Serial.println(mem.config.ledCount);
+    Serial.print(F("  Color order: "));
+    Serial.println(mem.config.colorOrder);
+    Serial.print(F("  Brightness: "));
+    Serial.println(mem.config.brightness);
+    Serial.print(F("  Layout: "));
+    Serial.println(mem.config.layout);
+    Serial.print(F("  Output: "));
+    Serial.println(mem.config.output);
+    if (mem.config.layout < CUBE_LAYOUT_CRC) return;
+    
+    Serial.print(F("  LED map: flags 0x"));
+    Serial.print(mem.ledMap.flags, HEX);
+    Serial.print(F(", row "));
+    Serial.print(mem.ledMap.rowLength);
+    Serial.print(F(", rotation "));
+    Serial.println(mem.ledMap.rotation);
+    Serial.print(F("  Gamma x10: "));
+    for (int i = 0; i < 3; i++) {
+        Serial.print(mem.gamma.gamma[i]);
+        Serial.print(i < 2 ? '/' : ',');
+    }
+    Serial.print(F(" scale: "));
+    for (int i = 0; i < 3; i++) {
+        Serial.print(mem.gamma.scale[i]);
+        if (i < 2) Serial.print('/');
     }
-    Serial.println(F("Device not found"));
+    Serial.println();
+    Serial.print(F("  Current limit: "));
+    Serial.print(mem.power.maxMilliamps);
+    Serial.print(F(" mA ("));
+    Serial.print(mem.power.ledMilliamps);
+    Serial.println(F(" mA per channel)"));
 }
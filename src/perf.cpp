@@ -0,0 +1,162 @@
+// =============================================================================
+// perf.cpp - Hot-path timing histograms
+// =============================================================================
+
+#include "perf.h"
+
+#include <OneWire.h>
+
+#if PERF_ENABLED
+
+// Values below 4 cycles get a bucket each; above that every power of two is
+// split in 4, so a bucket is at most 25% wide. 124 buckets cover 32 bits.
+#define PERF_SUB_BITS     2
+#define PERF_SUB_BUCKETS  (1 << PERF_SUB_BITS)
+#define PERF_BUCKETS      ((32 - PERF_SUB_BITS + 1) * PERF_SUB_BUCKETS)
+
+struct PerfStats {
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    uint64_t sum;
+    uint16_t buckets[PERF_BUCKETS];     // Halved together when one would overflow
+};
+
+static PerfStats perfStats[PERF_POINT_COUNT];
+
+static const char* const perfNames[PERF_POINT_COUNT] = {
+    "loop", "doubletap", "serial", "accel", "orient", "onewire", "render", "show",
+    "tap_lat", "6d_lat", "fifo_lat", "calib"
+};
+
+static uint8_t perfBucket(uint32_t v) {
+    if (v < PERF_SUB_BUCKETS) return v;
+    uint8_t e = 31 - __builtin_clz(v);
+    return (e - PERF_SUB_BITS + 1) * PERF_SUB_BUCKETS + ((v >> (e - PERF_SUB_BITS)) & (PERF_SUB_BUCKETS - 1));
+}
+
+// Largest value that falls into bucket b
+static uint32_t perfBucketTop(uint8_t b) {
+    if (b < PERF_SUB_BUCKETS) return b;
+    uint8_t e = b / PERF_SUB_BUCKETS + PERF_SUB_BITS - 1;
+    uint64_t width = 1ULL << (e - PERF_SUB_BITS);
+    uint64_t low = (uint64_t)(PERF_SUB_BUCKETS + b % PERF_SUB_BUCKETS) << (e - PERF_SUB_BITS);
+    return (uint32_t)(low + width - 1);
+}
+
+void perfRecord(PerfPoint point, uint32_t cycles) {
+    PerfStats* p = &perfStats[point];
+    if (p->count == 0 || cycles < p->min) p->min = cycles;
+    if (cycles > p->max) p->max = cycles;
+    p->count++;
+    p->sum += cycles;
+    
+    uint16_t* bucket = &p->buckets[perfBucket(cycles)];
+    if (*bucket == UINT16_MAX) {
+        // Keeps the shape (and so the percentiles) of the distribution
+        for (int i = 0; i < PERF_BUCKETS; i++) p->buckets[i] = (p->buckets[i] + 1) / 2;
+    }
+    (*bucket)++;
+}
+
+// Upper edge of the bucket holding the 99th percentile, capped at max
+static uint32_t perfP99(const PerfStats* p) {
+    uint32_t total = 0;
+    for (int i = 0; i < PERF_BUCKETS; i++) total += p->buckets[i];
+    if (total == 0) return 0;
+    
+    uint32_t target = total - total / 100;
+    uint32_t seen = 0;
+    for (int i = 0; i < PERF_BUCKETS; i++) {
+        seen += p->buckets[i];
+        if (seen >= target) {
+            uint32_t top = perfBucketTop(i);
+            return top < p->max ? top : p->max;
+        }
+    }
+    return p->max;
+}
+
+void perfReset() {
+    memset(perfStats, 0, sizeof(perfStats));
+}
+
+// =============================================================================
+// Reports
+// =============================================================================
+static void perfPrintUs(uint32_t cycles, uint32_t mhz) {
+    char buf[16];
+    snprintf(buf, sizeof(buf), "%10.1f", (double)cycles / mhz);
+    Serial.print(buf);
+}
+
+void perfPrint() {
+    uint32_t mhz = ESP.getCpuFreqMHz();
+    Serial.println(F("\n=== Perf (us) ==="));
+    Serial.println(F("point          count       min       avg       max       p99"));
+    for (int i = 0; i < PERF_POINT_COUNT; i++) {
+        const PerfStats* p = &perfStats[i];
+        char buf[24];
+        snprintf(buf, sizeof(buf), "%-10s%10lu", perfNames[i], (unsigned long)p->count);
+        Serial.print(buf);
+        if (p->count == 0) {
+            Serial.println();
+            continue;
+        }
+        perfPrintUs(p->min, mhz);
+        perfPrintUs((uint32_t)(p->sum / p->count), mhz);
+        perfPrintUs(p->max, mhz);
+        perfPrintUs(perfP99(p), mhz);
+        Serial.println();
+    }
+}
+
+static void perfPut32(uint8_t* out, uint32_t v) {
+    for (int i = 0; i < 4; i++) out[i] = v >> (8 * i);
+}
+
+// 'P' 'F', version, point count, CPU MHz (u16), then per point count, min,
+// avg, max, p99 (u32 cycles), then the inverted CRC16 of all of it; all
+// little-endian
+void perfDump() {
+    uint8_t buf[6 + PERF_POINT_COUNT * 20 + 2];
+    uint32_t mhz = ESP.getCpuFreqMHz();
+    buf[0] = 'P';
+    buf[1] = 'F';
+    buf[2] = PERF_DUMP_VERSION;
+    buf[3] = PERF_POINT_COUNT;
+    buf[4] = mhz & 0xFF;
+    buf[5] = mhz >> 8;
+    
+    uint8_t* out = &buf[6];
+    for (int i = 0; i < PERF_POINT_COUNT; i++) {
+        const PerfStats* p = &perfStats[i];
+        perfPut32(out + 0, p->count);
+        perfPut32(out + 4, p->min);
+        perfPut32(out + 8, p->count ? (uint32_t)(p->sum / p->count) : 0);
+        perfPut32(out + 12, p->max);
+        perfPut32(out + 16, perfP99(p));
+        out += 20;
+    }
+    
+    uint16_t crc = ~OneWire::crc16(buf, out - buf);
+    out[0] = crc & 0xFF;
+    out[1] = crc >> 8;
+    Serial.write(buf, sizeof(buf));
+    Serial.flush();
+}
+
+#else
+
+void perfPrint() {
+    Serial.println(F("Perf counters not built in (PERF_ENABLED=0)"));
+}
+
+void perfDump() {
+    perfPrint();
+}
+
+void perfReset() {
+}
+
+#endif
@@ -0,0 +1,165 @@
+// =============================================================================
+// pixel_ops.cpp - Packed-pixel (SWAR) effect kernels
+// =============================================================================
+
+#include "pixel_ops.h"
+
+// Word access to CRGB arrays; may_alias keeps the compiler from assuming a
+// word store leaves the CRGB bytes alone
+typedef uint32_t __attribute__((__may_alias__)) PixelWord;
+
+#define PIXEL_LANES  0x00FF00FFu    // Even bytes, each in its own 16-bit lane
+#define PIXEL_LOW7   0x7F7F7F7Fu
+#define PIXEL_HIGH   0x80808080u
+
+// Bytes before the first word boundary, at most n
+static size_t headBytes(const uint8_t* p, size_t n) {
+    size_t head = (0 - (uintptr_t)p) & 3;
+    return head < n ? head : n;
+}
+
+// The color repeated over 12 bytes (three words), starting at channel phase
+static void colorPattern(CRGB color, size_t phase, uint32_t pattern[3]) {
+    uint8_t bytes[12];
+    for (int i = 0; i < 12; i++) bytes[i] = color.raw[(phase + i) % 3];
+    memcpy(pattern, bytes, sizeof(bytes));
+}
+
+// =============================================================================
+// Word Kernels
+// =============================================================================
+
+// scale8() on all four bytes; scale is the fixed scale (1-256). Each lane
+// holds at most 255 * 256, so products never carry into the next byte pair.
+static inline uint32_t scaleWord(uint32_t w, uint32_t scale) {
+    uint32_t even = (((w & PIXEL_LANES) * scale) >> 8) & PIXEL_LANES;
+    uint32_t odd = (((w >> 8) & PIXEL_LANES) * scale) & ~PIXEL_LANES;
+    return even | odd;
+}
+
+// qadd8() on all four bytes: add the low 7 bits, put bit 7 back and turn
+// every byte that carried out into 0xFF
+static inline uint32_t qaddWord(uint32_t a, uint32_t b) {
+    uint32_t low = (a & PIXEL_LOW7) + (b & PIXEL_LOW7);
+    uint32_t sum = low ^ ((a ^ b) & PIXEL_HIGH);
+    uint32_t carry = ((a & b) | ((a ^ b) & low)) & PIXEL_HIGH;
+    return sum | ((carry >> 7) * 0xFF);
+}
+
+// lerp8by8() on the two bytes of a PIXEL_LANES word. 256 + b - a has bit 8
+// set where b >= a; the low byte is then b - a, else its negation is a - b.
+static inline uint32_t lerpLanes(uint32_t a, uint32_t b, uint32_t frac) {
+    uint32_t x = (b | 0x01000100) - a;
+    uint32_t up = ((x >> 8) & 0x00010001) * 0xFF;
+    uint32_t delta = (x & up) | (((~x & PIXEL_LANES) + 0x00010001) & ~up & PIXEL_LANES);
+    uint32_t scaled = ((delta * frac) >> 8) & PIXEL_LANES;
+    return a + (scaled & up) - (scaled & ~up);
+}
+
+static inline uint32_t lerpWord(uint32_t a, uint32_t b, uint32_t frac) {
+    uint32_t even = lerpLanes(a & PIXEL_LANES, b & PIXEL_LANES, frac);
+    uint32_t odd = lerpLanes((a >> 8) & PIXEL_LANES, (b >> 8) & PIXEL_LANES, frac);
+    return even | (odd << 8);
+}
+
+// =============================================================================
+// Pixel Kernels
+// =============================================================================
+
+void pixelFill(CRGB* px, int count, CRGB color) {
+    if (count <= 0) return;
+    uint8_t* p = px->raw;
+    size_t n = (size_t)count * 3;
+    size_t head = headBytes(p, n);
+    size_t words = (n - head) / 4;
+    
+    for (size_t i = 0; i < head; i++) p[i] = color.raw[i % 3];
+    uint32_t pattern[3];
+    colorPattern(color, head % 3, pattern);
+    PixelWord* w = (PixelWord*)(p + head);
+    size_t i = 0;
+    for (; i + 3 <= words; i += 3) {
+        w[i] = pattern[0];
+        w[i + 1] = pattern[1];
+        w[i + 2] = pattern[2];
+    }
+    for (size_t k = 0; i < words; i++, k++) w[i] = pattern[k];
+    for (size_t j = head + words * 4; j < n; j++) p[j] = color.raw[j % 3];
+}
+
+void pixelScale(CRGB* px, int count, uint8_t scale) {
+    if (count <= 0) return;
+    uint8_t* p = px->raw;
+    size_t n = (size_t)count * 3;
+    size_t head = headBytes(p, n);
+    size_t words = (n - head) / 4;
+    uint32_t fixed = scale + 1;
+    
+    for (size_t i = 0; i < head; i++) p[i] = (p[i] * fixed) >> 8;
+    PixelWord* w = (PixelWord*)(p + head);
+    for (size_t i = 0; i < words; i++) w[i] = scaleWord(w[i], fixed);
+    for (size_t j = head + words * 4; j < n; j++) p[j] = (p[j] * fixed) >> 8;
+}
+
+void pixelFade(CRGB* px, int count, uint8_t fadeBy) {
+    pixelScale(px, count, 255 - fadeBy);
+}
+
+void pixelAdd(CRGB* px, int count, CRGB color) {
+    if (count <= 0) return;
+    uint8_t* p = px->raw;
+    size_t n = (size_t)count * 3;
+    size_t head = headBytes(p, n);
+    size_t words = (n - head) / 4;
+    
+    for (size_t i = 0; i < head; i++) p[i] = qadd8(p[i], color.raw[i % 3]);
+    uint32_t pattern[3];
+    colorPattern(color, head % 3, pattern);
+    PixelWord* w = (PixelWord*)(p + head);
+    for (size_t i = 0, k = 0; i < words; i++) {
+        w[i] = qaddWord(w[i], pattern[k]);
+        if (++k == 3) k = 0;
+    }
+    for (size_t j = head + words * 4; j < n; j++) p[j] = qadd8(p[j], color.raw[j % 3]);
+}
+
+// Word lanes need both arrays equally aligned; otherwise it is all bytes
+void pixelLerp(CRGB* px, const CRGB* to, int count, fract8 frac) {
+    if (count <= 0) return;
+    uint8_t* p = px->raw;
+    const uint8_t* q = to->raw;
+    size_t n = (size_t)count * 3;
+    size_t head = (((uintptr_t)p ^ (uintptr_t)q) & 3) ? n : headBytes(p, n);
+    size_t words = (n - head) / 4;
+    
+    for (size_t i = 0; i < head; i++) p[i] = lerp8by8(p[i], q[i], frac);
+    PixelWord* w = (PixelWord*)(p + head);
+    const PixelWord* v = (const PixelWord*)(q + head);
+    for (size_t i = 0; i < words; i++) w[i] = lerpWord(w[i], v[i], frac + 1);
+    for (size_t j = head + words * 4; j < n; j++) p[j] = lerp8by8(p[j], q[j], frac);
+}
+
+// =============================================================================
+// Hue Ramp
+// =============================================================================
+// A ramp at fixed saturation and value only ever needs 256 distinct colors,
+// so hsv2rgb_rainbow() runs per table entry instead of per pixel. Render
+// context only (the task, or runAnimation() while it is stopped).
+
+static CRGB hueTable[256];
+static uint8_t hueTableSat;
+static uint8_t hueTableVal;
+static bool hueTableValid = false;
+
+void pixelFillHue(CRGB* px, int count, uint8_t hue, uint8_t step, uint8_t sat, uint8_t val) {
+    if (!hueTableValid || hueTableSat != sat || hueTableVal != val) {
+        for (int h = 0; h < 256; h++) hsv2rgb_rainbow(CHSV(h, sat, val), hueTable[h]);
+        hueTableSat = sat;
+        hueTableVal = val;
+        hueTableValid = true;
+    }
+    for (int i = 0; i < count; i++) {
+        px[i] = hueTable[hue];
+        hue += step;
+    }
+}
@@ -0,0 +1,153 @@
+#!/usr/bin/env python3
+"""Stream test frames to the LED Cube Hub over its serial port.
+
+Switches the hub into binary streaming mode ("stream" command), sends a
+rainbow at the requested frame rate, then ends the stream and prints the
+hub's summary next to what was sent. Works against the board's USB port or
+the native simulation's pseudo-terminal:
+
+    .pio/build/native/program --cubes 8 --leds 36 --pty --quiet &
+    tools/stream_frames.py /dev/pts/N --leds 288 --fps 60 --seconds 10
+
+Packet format (little-endian, CRC16 as OneWire::crc16, inverted, over type
+through payload):
+
+    A5 5A | type | flags | target u16 | length u16 | RGB payload | crc u16
+
+Standard library only.
+"""
+
+import argparse
+import os
+import select
+import struct
+import sys
+import termios
+import time
+import tty
+
+SYNC = b"\xa5\x5a"
+STREAM_PIXELS = 0x01
+STREAM_CUBE = 0x02
+STREAM_END = 0x03
+FLAG_SHOW = 0x01
+
+
+def crc16(data, crc=0):
+    for b in data:
+        crc ^= b
+        for _ in range(8):
+            crc = (crc >> 1) ^ 0xA001 if crc & 1 else crc >> 1
+    return crc
+
+
+def packet(ptype, flags, target, payload=b""):
+    body = struct.pack("<BBHH", ptype, flags, target, len(payload)) + payload
+    return SYNC + body + struct.pack("<H", ~crc16(body) & 0xFFFF)
+
+
+def rainbow(count, offset):
+    out = bytearray(count * 3)
+    for i in range(count):
+        h = (offset + i * 256 // max(count, 1)) & 0xFF
+        sector, f = divmod(h * 3, 256)
+        r, g, b = (255 - f, f, 0) if sector == 0 else (0, 255 - f, f) if sector == 1 else (f, 0, 255 - f)
+        out[i * 3:i * 3 + 3] = bytes((r, g, b))
+    return bytes(out)
+
+
+class Port:
+    def __init__(self, path):
+        self.fd = os.open(path, os.O_RDWR | os.O_NOCTTY)
+        if os.isatty(self.fd):
+            tty.setraw(self.fd)
+            termios.tcflush(self.fd, termios.TCIOFLUSH)
+        self.pending = b""
+
+    def write(self, data):
+        view = memoryview(data)
+        while view:
+            select.select([], [self.fd], [])
+            view = view[os.write(self.fd, view):]
+
+    def read_line(self, timeout):
+        deadline = time.monotonic() + timeout
+        while b"\n" not in self.pending:
+            left = deadline - time.monotonic()
+            if left <= 0 or not select.select([self.fd], [], [], left)[0]:
+                return None
+            self.pending += os.read(self.fd, 4096)
+        line, self.pending = self.pending.split(b"\n", 1)
+        return line.decode(errors="replace").strip()
+
+    def wait_for(self, prefix, timeout):
+        deadline = time.monotonic() + timeout
+        while time.monotonic() < deadline:
+            line = self.read_line(deadline - time.monotonic())
+            if line is None:
+                break
+            if line.startswith(prefix):
+                return line
+        return None
+
+    def drain(self):
+        while select.select([self.fd], [], [], 0)[0]:
+            self.pending += os.read(self.fd, 4096)
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("port", help="serial device or simulator pty")
+    ap.add_argument("--leds", type=int, default=0, help="LEDs per frame in pixel mode")
+    ap.add_argument("--cubes", default="", help="cube mode: slot:leds list, e.g. 0:36,1:36")
+    ap.add_argument("--fps", type=float, default=60)
+    ap.add_argument("--seconds", type=float, default=5)
+    ap.add_argument("--corrupt", type=int, default=0, help="corrupt every Nth frame")
+    args = ap.parse_args()
+
+    cubes = [tuple(int(v) for v in c.split(":")) for c in args.cubes.split(",") if c]
+    if not cubes and args.leds <= 0:
+        ap.error("give --leds or --cubes")
+
+    port = Port(args.port)
+    port.write(b"\nstream\n")
+    if not port.wait_for("Streaming", 5):
+        sys.exit("no answer to the stream command")
+
+    frames = int(args.fps * args.seconds)
+    sent = 0
+    corrupted = 0
+    start = time.monotonic()
+    for n in range(frames):
+        offset = n * 4
+        if cubes:
+            data = b"".join(packet(STREAM_CUBE, FLAG_SHOW if i == len(cubes) - 1 else 0,
+                                   slot, rainbow(count, offset + slot * 32))
+                            for i, (slot, count) in enumerate(cubes))
+        else:
+            data = packet(STREAM_PIXELS, FLAG_SHOW, 0, rainbow(args.leds, offset))
+        if args.corrupt and n % args.corrupt == args.corrupt - 1:
+            data = bytearray(data)
+            data[len(data) // 2] ^= 0xFF
+            data = bytes(data)
+            corrupted += 1
+        port.write(data)
+        sent += len(data)
+        port.drain()
+        delay = start + (n + 1) / args.fps - time.monotonic()
+        if delay > 0:
+            time.sleep(delay)
+    elapsed = time.monotonic() - start
+
+    port.write(packet(STREAM_END, 0, 0))
+    summary = port.wait_for("Stream ended", 5)
+    print(f"Sent {frames} frames ({corrupted} corrupted) in {elapsed:.2f} s: "
+          f"{frames / elapsed:.1f} fps, {sent / elapsed / 1024:.1f} KiB/s")
+    print(f"Hub: {summary or 'no summary received'}")
+    expected = frames - corrupted
+    if summary and f"{expected} frames" not in summary:
+        sys.exit(f"expected {expected} frames shown")
+
+
+if __name__ == "__main__":
+    main()
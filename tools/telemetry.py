@@ -0,0 +1,121 @@
+#!/usr/bin/env python3
+"""Record accelerometer telemetry from the LED Cube Hub.
+
+Starts "telem <hz>", decodes the STREAM_TELEMETRY packets for the given time
+and writes one CSV row per sample (seq, timestamp us, x, y, z, orientation,
+upside down, flip count). Text the hub prints meanwhile goes to stderr.
+At the end it stops telemetry and prints the hub's counters next to the
+sequence gaps seen here:
+
+    tools/telemetry.py /dev/ttyACM0 --hz 400 --seconds 10 --out tap.csv
+
+Packets use the frame streaming layout (see stream_frames.py); each record is
+u32 us, i16 x, y, z, u8 orientation, u8 flip state, little-endian.
+"""
+
+import argparse
+import struct
+import sys
+import time
+
+from stream_frames import SYNC, Port, crc16
+
+STREAM_TELEMETRY = 0x10
+RECORD = struct.Struct("<IhhhBB")
+AXES = ("+X", "-X", "+Y", "-Y", "+Z", "-Z")
+
+
+class Decoder:
+    def __init__(self):
+        self.buf = bytearray()
+        self.text = bytearray()
+        self.crc_errors = 0
+
+    def feed(self, data):
+        """Yields (seq, record) for every sample in data; collects text lines."""
+        self.buf += data
+        while True:
+            i = self.buf.find(SYNC)
+            if i < 0:
+                keep = 1 if self.buf.endswith(SYNC[:1]) else 0
+                self.text += self.buf[:len(self.buf) - keep]
+                del self.buf[:len(self.buf) - keep]
+                return
+            self.text += self.buf[:i]
+            del self.buf[:i]
+            if len(self.buf) < 8:
+                return
+            ptype, _, first, length = struct.unpack_from("<BBHH", self.buf, 2)
+            if ptype != STREAM_TELEMETRY or length % RECORD.size:
+                self.text += self.buf[:1]
+                del self.buf[:1]
+                continue
+            if len(self.buf) < 10 + length:
+                return
+            body = bytes(self.buf[2:8 + length])
+            (crc,) = struct.unpack_from("<H", self.buf, 8 + length)
+            del self.buf[:10 + length]
+            if crc != ~crc16(body) & 0xFFFF:
+                self.crc_errors += 1
+                continue
+            for n in range(length // RECORD.size):
+                yield (first + n) & 0xFFFF, RECORD.unpack_from(body, 6 + n * RECORD.size)
+
+    def lines(self):
+        while b"\n" in self.text:
+            line, _, rest = bytes(self.text).partition(b"\n")
+            self.text = bytearray(rest)
+            yield line.decode(errors="replace").strip()
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("port", help="serial device or simulator pty")
+    ap.add_argument("--hz", type=int, default=100, choices=(100, 200, 400))
+    ap.add_argument("--seconds", type=float, default=5)
+    ap.add_argument("--out", help="CSV file (default: stdout)")
+    args = ap.parse_args()
+
+    out = open(args.out, "w") if args.out else sys.stdout
+    out.write("seq,us,x,y,z,orientation,upside_down,flips\n")
+
+    port = Port(args.port)
+    port.write(f"\ntelem {args.hz}\n".encode())
+    dec = Decoder()
+    samples = gaps = missing = 0
+    last_seq = first_us = last_us = None
+    summary = None
+    stop_at = time.monotonic() + args.seconds
+    stopping = False
+    deadline = stop_at + 5
+    while time.monotonic() < deadline and not summary:
+        if not stopping and time.monotonic() >= stop_at:
+            port.write(b"telem off\n")
+            stopping = True
+        port.drain()
+        data, port.pending = port.pending, b""
+        for seq, (us, x, y, z, orient, flip) in dec.feed(data):
+            if last_seq is not None and seq != (last_seq + 1) & 0xFFFF:
+                gaps += 1
+                missing += (seq - last_seq - 1) & 0xFFFF
+            last_seq = seq
+            first_us = us if first_us is None else first_us
+            last_us = us
+            samples += 1
+            out.write(f"{seq},{us},{x},{y},{z},{AXES[orient]},{flip >> 7},{flip & 3}\n")
+        for line in dec.lines():
+            if line.startswith("Telemetry stopped"):
+                summary = line
+            elif line:
+                print(line, file=sys.stderr)
+        time.sleep(0.005)
+
+    span = ((last_us - first_us) & 0xFFFFFFFF) / 1e6 if samples > 1 else 0
+    rate = (samples - 1) / span if span else 0
+    print(f"Received {samples} samples ({rate:.1f} Hz), {gaps} gaps / {missing} missing, "
+          f"{dec.crc_errors} CRC errors", file=sys.stderr)
+    print(f"Hub: {summary or 'no summary received'}", file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()